@@ -0,0 +1,97 @@
+#include "Benchmark.h"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace ArchMaths {
+
+namespace {
+
+volatile double benchSink = 0.0;
+
+std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+BenchRunner::BenchRunner(double minSeconds, std::string filter)
+    : minSeconds_(minSeconds)
+    , filter_(std::move(filter))
+{
+}
+
+void BenchRunner::consume(double value) {
+    benchSink = benchSink + value;
+}
+
+void BenchRunner::run(const std::string& name, const std::string& expression, const Body& body) {
+    if (!filter_.empty() && name.find(filter_) == std::string::npos &&
+        expression.find(filter_) == std::string::npos) {
+        return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    body();  // warm-up: caches, allocator, lazy initialization
+
+    BenchResult result;
+    result.name = name;
+    result.expression = expression;
+    Clock::time_point start = Clock::now();
+    do {
+        result.samples += body();
+        ++result.iterations;
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (result.seconds < minSeconds_);
+    results_.push_back(result);
+}
+
+void BenchRunner::writeJson(std::ostream& out) const {
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    out << "{\n  \"threads\": " << threads << ",\n  \"minSeconds\": " << minSeconds_
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results_.size(); ++i) {
+        const BenchResult& r = results_[i];
+        out << "    {\"name\": " << jsonString(r.name) << ", \"expression\": " << jsonString(r.expression)
+            << ", \"iterations\": " << r.iterations << ", \"samples\": " << r.samples
+            << ", \"seconds\": " << std::setprecision(6) << r.seconds
+            << ", \"samplesPerSec\": " << std::setprecision(6) << r.samplesPerSecond()
+            << ", \"nsPerSample\": " << std::setprecision(6) << r.nsPerSample() << "}"
+            << (i + 1 < results_.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+void BenchRunner::writeTable(std::ostream& out) const {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-24s %-44s %14s %12s\n", "case", "expression", "samples/s", "ns/sample");
+    out << line;
+    for (const BenchResult& r : results_) {
+        std::string expression = r.expression.size() > 44 ? r.expression.substr(0, 41) + "..." : r.expression;
+        std::snprintf(line, sizeof(line), "%-24s %-44s %14.4g %12.2f\n", r.name.c_str(), expression.c_str(),
+                      r.samplesPerSecond(), r.nsPerSample());
+        out << line;
+    }
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ArchMaths {
+
+// 一个用例的测量结果
+struct BenchResult {
+    std::string name;
+    std::string expression;   // empty for cases without an expression
+    size_t iterations = 0;
+    size_t samples = 0;       // over all iterations
+    double seconds = 0.0;
+
+    double samplesPerSecond() const { return seconds > 0.0 ? samples / seconds : 0.0; }
+    double nsPerSample() const { return samples > 0 ? seconds * 1e9 / samples : 0.0; }
+};
+
+// 微基准运行器: 每个用例先预热一次, 然后重复运行直到累计时间达到 minSeconds.
+// The body runs one iteration and returns how many samples it processed
+// (points evaluated, grid cells, expressions tokenized, ...), so results
+// are comparable across problem sizes and evaluator backends.
+class BenchRunner {
+public:
+    using Body = std::function<size_t()>;
+
+    BenchRunner(double minSeconds, std::string filter);
+
+    // Skipped unless the name or expression contains the filter
+    void run(const std::string& name, const std::string& expression, const Body& body);
+
+    // Keeps a result alive so the optimizer cannot drop the work
+    static void consume(double value);
+
+    const std::vector<BenchResult>& results() const { return results_; }
+    void writeJson(std::ostream& out) const;
+    void writeTable(std::ostream& out) const;
+
+private:
+    double minSeconds_;
+    std::string filter_;
+    std::vector<BenchResult> results_;
+};
+
+} // namespace ArchMaths
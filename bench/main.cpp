@@ -0,0 +1,316 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "Benchmark.h"
+#include "math/ExpressionEvaluator.h"
+#include "math/ExpressionParser.h"
+#include "math/PlotCompiler.h"
+#include "math/PlotSampler.h"
+#include "math/Tokenizer.h"
+#include "mesh/MarchingSquares.h"
+#include "mesh/MeshSimplifier.h"
+#include "mesh/OctreeMesher.h"
+#include "mesh/SurfaceMesh.h"
+
+using namespace ArchMaths;
+
+namespace {
+
+// 代表性的表达式: 多项式、三角、指数/对数混合、带参数
+const std::vector<std::string> kCorpus2D = {
+    "x^2 + y^2",
+    "sin(x) * cos(y)",
+    "exp(-(x^2 + y^2) / 4) * cos(3 * x)",
+    "sqrt(abs(x * y)) + log(1 + x^2)",
+    "a * x^3 + b * x^2 * y + c",
+    "tanh(x - y) + floor(x) * 0.1 + max(x, y)",
+};
+
+// f(x, y, z) = 0 surfaces: sphere, gyroid, torus
+const std::vector<std::string> kCorpus3D = {
+    "x^2 + y^2 + z^2 - 4",
+    "sin(x) * cos(y) + sin(y) * cos(z) + sin(z) * cos(x)",
+    "(sqrt(x^2 + y^2) - 2)^2 + z^2 - 0.5",
+};
+
+// Each level calls the previous one twice, so parsing q(x) substitutes
+// 2^8 function bodies
+const std::vector<std::string> kDeepFunctions = {
+    "f(x) = x^2 + 1",
+    "g(x) = sin(f(x)) + f(x) / 2",
+    "h(x) = sin(g(x)) + g(x) / 2",
+    "k(x) = sin(h(x)) + h(x) / 2",
+    "m(x) = sin(k(x)) + k(x) / 2",
+    "n(x) = sin(m(x)) + m(x) / 2",
+    "p(x) = sin(n(x)) + n(x) / 2",
+    "q(x) = sin(p(x)) + p(x) / 2",
+};
+const char* kDeepExpression = "q(x) * y";
+
+VariableContext baseVariables() {
+    return {{"a", 0.5}, {"b", -1.25}, {"c", 2.0}, {"x", 0.0}, {"y", 0.0}, {"z", 0.0}};
+}
+
+std::vector<double> linspace(double lo, double hi, int count) {
+    std::vector<double> values(count);
+    for (int i = 0; i < count; ++i) values[i] = lo + (hi - lo) * i / (count - 1);
+    return values;
+}
+
+ExprNodePtr parseOrDie(ExpressionParser& parser, const std::string& expression) {
+    ExprNodePtr node = parser.parse(expression);
+    if (!node || parser.hasError()) {
+        std::cerr << "cannot parse " << expression << ": " << parser.getError() << std::endl;
+        std::exit(1);
+    }
+    return node;
+}
+
+void benchFrontEnd(BenchRunner& runner) {
+    Tokenizer tokenizer;
+    ExpressionParser parser;
+    for (const std::string& expression : kCorpus2D) {
+        runner.run("tokenize", expression, [&] {
+            BenchRunner::consume(static_cast<double>(tokenizer.tokenize(expression).size()));
+            return size_t(1);
+        });
+        runner.run("parse", expression, [&] {
+            BenchRunner::consume(parser.parse(expression) ? 1.0 : 0.0);
+            return size_t(1);
+        });
+    }
+
+    // 用户函数嵌套替换
+    std::vector<PlotEntry> entries(kDeepFunctions.size() + 1);
+    for (size_t i = 0; i < kDeepFunctions.size(); ++i) entries[i].expression = kDeepFunctions[i];
+    entries.back().expression = kDeepExpression;
+    PlotCompiler compiler;
+    compiler.defineFunctions(entries);
+    UserFunctionRegistry registry = compiler.userFunctions();
+    ExpressionParser userParser;
+    userParser.setUserFunctions(&registry);
+    parseOrDie(userParser, kDeepExpression);
+    runner.run("parseUserFunctions", kDeepExpression, [&] {
+        BenchRunner::consume(userParser.parse(kDeepExpression) ? 1.0 : 0.0);
+        return size_t(1);
+    });
+}
+
+void benchEvaluation(BenchRunner& runner) {
+    ExpressionParser parser;
+    ExpressionEvaluator evaluator;
+    VariableContext vars = baseVariables();
+
+    for (const std::string& expression : kCorpus2D) {
+        ExprNodePtr node = parseOrDie(parser, expression);
+
+        const int pointCount = 1000;
+        runner.run("evaluate", expression, [&] {
+            VariableContext point = vars;
+            double sum = 0.0;
+            for (int i = 0; i < pointCount; ++i) {
+                point["x"] = -5.0 + 0.01 * i;
+                point["y"] = 0.3;
+                sum += evaluator.evaluate(node, point);
+            }
+            BenchRunner::consume(sum);
+            return size_t(pointCount);
+        });
+
+        // 与画布一样, 每个像素列一个样本
+        std::vector<double> xValues = linspace(-10.0, 10.0, 4096);
+        std::vector<double> results;
+        VariableContext row = vars;
+        row["y"] = 0.3;
+        runner.run("evaluateBatch", expression, [&] {
+            evaluator.evaluateBatch(node, xValues, results, row, "x");
+            BenchRunner::consume(results[results.size() / 2]);
+            return xValues.size();
+        });
+
+        std::vector<double> gridValues = linspace(-5.0, 5.0, 256);
+        std::vector<std::vector<double>> grid;
+        runner.run("evaluateGrid", expression, [&] {
+            evaluator.evaluateGrid(node, gridValues, gridValues, grid, vars);
+            BenchRunner::consume(grid[128][128]);
+            return gridValues.size() * gridValues.size();
+        });
+    }
+
+    for (const std::string& expression : kCorpus3D) {
+        ExprNodePtr node = parseOrDie(parser, expression);
+        std::vector<double> axis = linspace(-3.0, 3.0, 64);
+        std::vector<double> volume;
+        runner.run("evaluateVolume", expression, [&] {
+            evaluator.evaluateVolume(node, axis, axis, axis, volume, vars);
+            BenchRunner::consume(volume[volume.size() / 2]);
+            return volume.size();
+        });
+    }
+}
+
+void benchMeshing(BenchRunner& runner) {
+    ExpressionParser parser;
+    ExpressionEvaluator evaluator;
+    VariableContext vars = baseVariables();
+
+    // Marching squares on a precomputed 1000 x 1000 field (the canvas maximum)
+    {
+        const std::string expression = "sin(x) * cos(y) - 0.2";
+        ExprNodePtr node = parseOrDie(parser, expression);
+        std::vector<double> axis = linspace(-10.0, 10.0, 1001);
+        std::vector<std::vector<double>> field;
+        evaluator.evaluateGrid(node, axis, axis, field, vars);
+        std::vector<double> segments;
+        runner.run("marchingSquares", expression, [&] {
+            segments.clear();
+            MarchingSquares::extract(field, axis, axis, segments);
+            BenchRunner::consume(static_cast<double>(segments.size()));
+            return size_t(1000) * 1000;
+        });
+    }
+
+    // 隐式2D的完整路径: 网格求值 + 等值线 + 屏幕坐标
+    {
+        PlotCompiler compiler;
+        ExpressionEvaluator sampleEvaluator;
+        PlotSampler sampler(sampleEvaluator);
+        PlotEntry entry;
+        entry.expression = "x^2 + y^2 = 4 + sin(3 * x)";
+        compiler.compile(entry);
+        PlotView view;
+        view.width = 1280;
+        view.height = 800;
+        view.offsetX = 640;
+        view.offsetY = 400;
+        const size_t cells = 320 * 320;  // gridSize = max(width, height) / 4
+        runner.run("implicit2D", entry.expression, [&] {
+            sampler.samplePolyline(entry, view, vars);
+            BenchRunner::consume(static_cast<double>(entry.vertices.size()));
+            return cells;
+        });
+    }
+
+    for (const std::string& expression : kCorpus3D) {
+        ExprNodePtr node = parseOrDie(parser, expression);
+
+        // 与界面相同的隐式3D网格化: 八叉树 + 区间剪枝, 每次从空缓存开始.
+        // Samples are all function evaluations of the build (lattice
+        // corners and gradient stencils).
+        auto sample = [&](const std::vector<double>& points, std::vector<double>& values) {
+            evaluator.evaluatePoints(node, points, values, vars);
+        };
+        auto bound = [&](const double lo[3], const double hi[3]) {
+            IntervalContext ranges = {{"x", Interval(lo[0], hi[0])},
+                                      {"y", Interval(lo[1], hi[1])},
+                                      {"z", Interval(lo[2], hi[2])}};
+            Interval r = evaluator.evaluateInterval(node, ranges, vars);
+            return std::make_pair(r.lo, r.hi);
+        };
+        const double eye[3] = {5.0, 4.0, 5.0};
+        const double target[3] = {0.0, 0.0, 0.0};
+        OctreeMeshSettings settings = cameraMeshSettings(eye, target, 1.0);
+        OctreeMesher mesher;
+        mesher.setFunction(sample, bound, expression);
+        IndexedMesh mesh;
+        runner.run("implicit3DMesh", expression, [&] {
+            mesher.clearCache();
+            mesh.clear();
+            mesher.build(settings, mesh);
+            BenchRunner::consume(static_cast<double>(mesh.indices.size()));
+            return mesher.evaluations();
+        });
+    }
+
+    // 曲面 z = f(x, y) 的一个分块: 网格求值 + 三角化 + 打包
+    for (const std::string& expression : {kCorpus2D[1], kCorpus2D[2]}) {
+        ExprNodePtr node = parseOrDie(parser, expression);
+        const int resolution = 50;
+        std::vector<double> tileAxis = linspace(-0.1, 5.1, resolution + 3);  // with a one-node apron
+        std::vector<std::vector<double>> zGrid;
+        runner.run("surfaceMesh", expression, [&] {
+            evaluator.evaluateGrid(node, tileAxis, tileAxis, zGrid, vars);
+            auto packed = SurfaceMesh::build(zGrid, tileAxis, tileAxis, true, 1);
+            BenchRunner::consume(static_cast<double>(packed->indexCount()));
+            return tileAxis.size() * tileAxis.size();
+        });
+    }
+
+    // 分块简化, 预算与界面相同 (远大于分块的三角形数), 误差界决定结果.
+    // A planar tile must collapse to a few triangles whatever the budget.
+    for (const std::string& expression : {std::string("0.5 * x - 0.25 * y"), kCorpus2D[1]}) {
+        ExprNodePtr node = parseOrDie(parser, expression);
+        const int resolution = 50;
+        std::vector<double> tileAxis = linspace(-0.1, 5.1, resolution + 3);
+        std::vector<std::vector<double>> zGrid;
+        evaluator.evaluateGrid(node, tileAxis, tileAxis, zGrid, vars);
+        IndexedMesh tile;
+        SurfaceMesh::triangulate(zGrid, tileAxis, tileAxis, 1, tile);
+        SimplifySettings settings;
+        settings.targetTriangles = 1 << 14;
+        settings.maxError = 1e-3;
+        IndexedMesh mesh = tile;
+        MeshSimplifier::simplify(mesh, settings);
+        if (expression == "0.5 * x - 0.25 * y" && mesh.indices.size() * 4 > tile.indices.size()) {
+            std::cerr << "planar tile not simplified: " << tile.indices.size() / 3 << " -> "
+                      << mesh.indices.size() / 3 << " triangles" << std::endl;
+            std::exit(1);
+        }
+        runner.run("simplifyTile", expression, [&] {
+            mesh = tile;
+            MeshSimplifier::simplify(mesh, settings);
+            BenchRunner::consume(static_cast<double>(mesh.indices.size()));
+            return tile.indices.size() / 3;
+        });
+    }
+}
+
+void usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--min-time SECONDS] [--filter TEXT] [--out FILE] [--quiet]\n"
+              << "Runs the engine microbenchmarks and writes the results as JSON\n"
+              << "(to FILE, or stdout); a readable table goes to stderr." << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    double minSeconds = 0.5;
+    std::string filter;
+    std::string outPath;
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            minSeconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+            outPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            usage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    BenchRunner runner(minSeconds, filter);
+    benchFrontEnd(runner);
+    benchEvaluation(runner);
+    benchMeshing(runner);
+
+    if (!quiet) runner.writeTable(std::cerr);
+    if (outPath.empty()) {
+        runner.writeJson(std::cout);
+    } else {
+        std::ofstream out(outPath);
+        runner.writeJson(out);
+        if (!out) {
+            std::cerr << "cannot write " << outPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "ReplayDriver.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMouseEvent>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QThread>
+#include <QWheelEvent>
+#include <cmath>
+#include "rendering/GLCanvas.h"
+#include "ui/AnimationScheduler.h"
+#include "ui/MainWindow.h"
+
+namespace ArchMaths {
+
+ReplayDriver::ReplayDriver(MainWindow& window)
+    : window_(window)
+    , canvas_(*window.canvas_)
+{
+}
+
+bool ReplayDriver::loadScene(const Scene& scene, QString& error) {
+    // The hidden window never lays out, so the canvas keeps this size.
+    // Grabbing once creates the context, the FBO and the GL resources.
+    canvas_.resize(scene.width, scene.height);
+    canvas_.grabFramebuffer();
+    if (!canvas_.isValid()) {
+        error = "the canvas could not create an OpenGL context";
+        return false;
+    }
+    canvas_.makeCurrent();
+    canvas_.resizeGL(scene.width, scene.height);
+    canvas_.doneCurrent();
+
+    window_.setPrecisionMultiplier(scene.precision);
+    if (scene.mode3D) {
+        canvas_.cameraYaw_ = static_cast<float>(scene.yaw);
+        canvas_.cameraPitch_ = static_cast<float>(scene.pitch);
+        canvas_.cameraDistance_ = static_cast<float>(scene.distance);
+        canvas_.cameraTarget_ = QVector3D(scene.target[0], scene.target[1], scene.target[2]);
+        canvas_.set3DMode(true);
+    } else {
+        PlotView view = scene.plotView();
+        canvas_.setScale(scene.scale);
+        canvas_.setOffset(QPointF(view.offsetX, view.offsetY));
+    }
+
+    // 参数是全局的: 先给出初值, 解析时新参数取这些值
+    for (const SceneEntry& entry : scene.entries) {
+        for (const auto& [name, value] : entry.parameters) window_.variables_[name] = value;
+    }
+    for (size_t i = 0; i < scene.entries.size(); ++i) {
+        const SceneEntry& entry = scene.entries[i];
+        int index = static_cast<int>(i);
+        window_.onAddEntry();
+        window_.entries_[i].thickness = entry.thickness;
+        window_.onEntryColorChanged(index, entry.color);
+        if (!entry.visible) window_.onEntryVisibilityChanged(index, false);
+        window_.onEntryChanged(index, QString::fromStdString(entry.expression));
+    }
+
+    QCoreApplication::processEvents();
+    render();
+    return true;
+}
+
+std::vector<ReplayFrame> ReplayDriver::run(const Trace& trace) {
+    std::vector<ReplayFrame> frames;
+    double end = (trace.events.empty() ? 0.0 : trace.events.back().time) + trace.settle;
+    uint64_t evaluationMark = evaluationCount();
+    uint64_t uploadMark = canvas_.uploadedBytes();
+    size_t next = 0;
+
+    QElapsedTimer clock;
+    clock.start();
+    for (double tick = 0.0; tick <= end;) {
+        double now = clock.nsecsElapsed() / 1e6;
+        if (now < tick) QThread::usleep(static_cast<unsigned long>((tick - now) * 1000.0));
+
+        QElapsedTimer work;
+        work.start();
+        ReplayFrame frame;
+        frame.time = clock.nsecsElapsed() / 1e6;
+        while (next < trace.events.size() && trace.events[next].time <= frame.time) {
+            dispatch(trace.events[next++]);
+            ++frame.events;
+        }
+        // Timers (remesh, animation clock) and queued signals, as the event
+        // loop runs them before a repaint
+        QCoreApplication::processEvents();
+
+        if (frame.events > 0 || animating() || evaluationCount() != evaluationMark) {
+            render();
+            frame.milliseconds = work.nsecsElapsed() / 1e6;
+            uint64_t evaluations = evaluationCount();
+            uint64_t uploaded = canvas_.uploadedBytes();
+            frame.evaluations = evaluations - evaluationMark;
+            frame.uploadedBytes = uploaded - uploadMark;
+            evaluationMark = evaluations;
+            uploadMark = uploaded;
+            frames.push_back(frame);
+        }
+
+        // Next vsync; ticks missed while working are dropped
+        tick += trace.frameInterval;
+        double after = clock.nsecsElapsed() / 1e6;
+        if (tick < after) tick = std::ceil(after / trace.frameInterval) * trace.frameInterval;
+    }
+    return frames;
+}
+
+void ReplayDriver::dispatch(const TraceEvent& event) {
+    int count = static_cast<int>(window_.entries_.size());
+    switch (event.type) {
+        case TraceEvent::Type::Press:
+        case TraceEvent::Type::Move:
+        case TraceEvent::Type::Release:
+        case TraceEvent::Type::Wheel:
+            sendMouse(event);
+            break;
+        case TraceEvent::Type::Slider:
+            window_.onParameterChanged(event.entry, event.name, event.value);
+            break;
+        case TraceEvent::Type::Play:
+        case TraceEvent::Type::Stop:
+            window_.onParameterPlayToggled(event.entry, event.name, event.type == TraceEvent::Type::Play,
+                                           event.minValue, event.maxValue);
+            break;
+        case TraceEvent::Type::Edit:
+            if (event.entry >= count) {
+                window_.onAddEntry();
+                window_.onEntryChanged(count, event.expression);
+            } else {
+                window_.onEntryChanged(event.entry, event.expression);
+            }
+            break;
+        case TraceEvent::Type::Delete:
+            window_.onEntryDeleted(event.entry);
+            break;
+        case TraceEvent::Type::Visible:
+            window_.onEntryVisibilityChanged(event.entry, event.enabled);
+            break;
+        case TraceEvent::Type::Precision:
+            window_.setPrecisionMultiplier(event.value);
+            break;
+        case TraceEvent::Type::Mode3D:
+            // As the toolbar toggle does
+            canvas_.set3DMode(event.enabled);
+            window_.refreshPlotData();
+            break;
+    }
+}
+
+void ReplayDriver::sendMouse(const TraceEvent& event) {
+    QPointF pos(event.x, event.y);
+    Qt::MouseButton button = event.rightButton ? Qt::RightButton : Qt::LeftButton;
+    if (event.type == TraceEvent::Type::Press) (event.rightButton ? rightDown_ : leftDown_) = true;
+    if (event.type == TraceEvent::Type::Release) (event.rightButton ? rightDown_ : leftDown_) = false;
+    Qt::MouseButtons buttons = Qt::NoButton;
+    if (leftDown_) buttons |= Qt::LeftButton;
+    if (rightDown_) buttons |= Qt::RightButton;
+
+    if (event.type == TraceEvent::Type::Wheel) {
+        QWheelEvent wheel(pos, pos, QPoint(), QPoint(0, event.wheelDelta), buttons, Qt::NoModifier,
+                          Qt::NoScrollPhase, false);
+        QCoreApplication::sendEvent(&canvas_, &wheel);
+        return;
+    }
+    QEvent::Type type = event.type == TraceEvent::Type::Press ? QEvent::MouseButtonPress
+                      : event.type == TraceEvent::Type::Release ? QEvent::MouseButtonRelease
+                      : QEvent::MouseMove;
+    QMouseEvent mouse(type, pos, pos, type == QEvent::MouseMove ? Qt::NoButton : button, buttons,
+                      Qt::NoModifier);
+    QCoreApplication::sendEvent(&canvas_, &mouse);
+}
+
+void ReplayDriver::render() {
+    // What QOpenGLWidget does around paintGL, plus glFinish so the GPU work
+    // lands in this frame
+    canvas_.makeCurrent();
+    QOpenGLFunctions* gl = canvas_.context()->functions();
+    qreal ratio = canvas_.devicePixelRatioF();
+    gl->glViewport(0, 0, static_cast<int>(canvas_.width() * ratio), static_cast<int>(canvas_.height() * ratio));
+    canvas_.paintGL();
+    gl->glFinish();
+    canvas_.doneCurrent();
+}
+
+bool ReplayDriver::animating() const {
+    return !window_.animator_->animatedEntries().empty();
+}
+
+uint64_t ReplayDriver::evaluationCount() const {
+    return window_.evaluator_->evaluationCount();
+}
+
+} // namespace ArchMaths
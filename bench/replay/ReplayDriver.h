@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Trace.h"
+#include "headless/Scene.h"
+
+namespace ArchMaths {
+
+class MainWindow;
+class GLCanvas;
+
+// 一帧的开销: 分发输入、处理事件循环 (定时器、排队的信号) 与绘制
+struct ReplayFrame {
+    double time = 0.0;           // ms from the start of the replay
+    double milliseconds = 0.0;   // work in the frame, including glFinish
+    uint64_t evaluations = 0;    // on any thread, including look-ahead frames
+    uint64_t uploadedBytes = 0;
+    int events = 0;              // trace events dispatched in the frame
+};
+
+// 驱动真实的界面管线回放记录的交互. The window is never shown: the driver
+// calls the same MainWindow slots the side panel and toolbar signals reach,
+// sends synthesized mouse and wheel events to the canvas, and paints the
+// canvas itself once per display frame.
+//
+// Frames tick at the trace's frame interval in real time, so the remesh
+// timer, the animation clock and background look-ahead behave as they do
+// interactively. A tick paints when it dispatched events, an animation is
+// playing, or timers and queued work evaluated something; idle ticks are
+// skipped, as the canvas would not repaint. A tick whose work overruns the
+// interval delays the next one, as a missed vsync would.
+class ReplayDriver {
+public:
+    explicit ReplayDriver(MainWindow& window);
+
+    // Sizes the canvas, creates its GL resources and loads the scene's view,
+    // precision, parameters and entries. Returns false with `error` set if
+    // the canvas has no GL context.
+    bool loadScene(const Scene& scene, QString& error);
+
+    std::vector<ReplayFrame> run(const Trace& trace);
+
+private:
+    void dispatch(const TraceEvent& event);
+    void sendMouse(const TraceEvent& event);
+    void render();
+    bool animating() const;
+    uint64_t evaluationCount() const;
+
+    MainWindow& window_;
+    GLCanvas& canvas_;
+    bool leftDown_ = false;
+    bool rightDown_ = false;
+};
+
+} // namespace ArchMaths
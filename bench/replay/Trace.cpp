@@ -0,0 +1,152 @@
+#include "Trace.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <algorithm>
+#include <cmath>
+
+namespace ArchMaths {
+
+namespace {
+
+bool pointValue(const QJsonValue& value, double& x, double& y) {
+    QJsonArray point = value.toArray();
+    if (point.size() != 2) return false;
+    x = point.at(0).toDouble();
+    y = point.at(1).toDouble();
+    return true;
+}
+
+// Event times of an interpolated gesture: one per frame, both ends included
+int stepCount(double duration, double frameInterval) {
+    return std::max(1, static_cast<int>(std::ceil(duration / frameInterval)));
+}
+
+bool parseEvent(const QJsonObject& object, int index, const Trace& trace, std::vector<TraceEvent>& out,
+                QString& error) {
+    TraceEvent event;
+    event.time = object.value("t").toDouble();
+    event.entry = object.value("entry").toInt();
+    event.name = object.value("name").toString();
+    QString type = object.value("type").toString();
+
+    if (type == "press" || type == "move" || type == "release" || type == "wheel") {
+        event.type = type == "press" ? TraceEvent::Type::Press
+                   : type == "move" ? TraceEvent::Type::Move
+                   : type == "release" ? TraceEvent::Type::Release
+                   : TraceEvent::Type::Wheel;
+        event.x = object.value("x").toDouble();
+        event.y = object.value("y").toDouble();
+        event.rightButton = object.value("button").toString() == "right";
+        event.wheelDelta = object.value("delta").toInt(event.wheelDelta);
+        out.push_back(event);
+    } else if (type == "drag") {
+        double x0, y0, x1, y1;
+        if (!pointValue(object.value("from"), x0, y0) || !pointValue(object.value("to"), x1, y1)) {
+            error = QString("event %1: drag needs from [x, y] and to [x, y]").arg(index);
+            return false;
+        }
+        double duration = object.value("duration").toDouble(500.0);
+        int steps = stepCount(duration, trace.frameInterval);
+        event.rightButton = object.value("button").toString() == "right";
+        event.type = TraceEvent::Type::Press;
+        event.x = x0;
+        event.y = y0;
+        out.push_back(event);
+        event.type = TraceEvent::Type::Move;
+        double start = event.time;
+        for (int s = 1; s <= steps; ++s) {
+            double f = static_cast<double>(s) / steps;
+            event.time = start + f * duration;
+            event.x = x0 + f * (x1 - x0);
+            event.y = y0 + f * (y1 - y0);
+            out.push_back(event);
+        }
+        event.type = TraceEvent::Type::Release;
+        out.push_back(event);
+    } else if (type == "slider") {
+        event.type = TraceEvent::Type::Slider;
+        if (object.contains("from")) {
+            double from = object.value("from").toDouble();
+            double to = object.value("to").toDouble(from);
+            double duration = object.value("duration").toDouble(1000.0);
+            int steps = stepCount(duration, trace.frameInterval);
+            double start = event.time;
+            for (int s = 0; s <= steps; ++s) {
+                double f = static_cast<double>(s) / steps;
+                event.time = start + f * duration;
+                event.value = from + f * (to - from);
+                out.push_back(event);
+            }
+        } else {
+            event.value = object.value("value").toDouble();
+            out.push_back(event);
+        }
+    } else if (type == "play" || type == "stop") {
+        event.type = type == "play" ? TraceEvent::Type::Play : TraceEvent::Type::Stop;
+        event.minValue = object.value("min").toDouble(event.minValue);
+        event.maxValue = object.value("max").toDouble(event.maxValue);
+        out.push_back(event);
+    } else if (type == "edit") {
+        event.type = TraceEvent::Type::Edit;
+        event.expression = object.value("expression").toString();
+        out.push_back(event);
+    } else if (type == "delete") {
+        event.type = TraceEvent::Type::Delete;
+        out.push_back(event);
+    } else if (type == "visible") {
+        event.type = TraceEvent::Type::Visible;
+        event.enabled = object.value("visible").toBool(true);
+        out.push_back(event);
+    } else if (type == "precision") {
+        event.type = TraceEvent::Type::Precision;
+        event.value = object.value("value").toDouble(1.0);
+        out.push_back(event);
+    } else if (type == "mode3d") {
+        event.type = TraceEvent::Type::Mode3D;
+        event.enabled = object.value("enabled").toBool(true);
+        out.push_back(event);
+    } else {
+        error = QString("event %1: unknown type \"%2\"").arg(index).arg(type);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool loadTrace(const QString& path, Trace& trace, QString& error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        error = document.isNull() ? parseError.errorString() : QString("expected an object");
+        return false;
+    }
+
+    QJsonObject object = document.object();
+    trace = Trace();
+    trace.frameInterval = object.value("frameInterval").toDouble(trace.frameInterval);
+    trace.settle = object.value("settle").toDouble(trace.settle);
+    if (!(trace.frameInterval > 0.0)) {
+        error = "frameInterval must be positive";
+        return false;
+    }
+
+    QJsonArray events = object.value("events").toArray();
+    for (int i = 0; i < events.size(); ++i) {
+        if (!parseEvent(events.at(i).toObject(), i, trace, trace.events, error)) return false;
+    }
+    // Expanded gestures may overlap later events; stable keeps same-time order
+    std::stable_sort(trace.events.begin(), trace.events.end(),
+                     [](const TraceEvent& a, const TraceEvent& b) { return a.time < b.time; });
+    return true;
+}
+
+} // namespace ArchMaths
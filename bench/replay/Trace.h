@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+#include <vector>
+
+namespace ArchMaths {
+
+// 记录的一次交互. Pointer positions are canvas pixels; entries are indices
+// into the scene's entry list.
+struct TraceEvent {
+    enum class Type {
+        Press, Move, Release, Wheel,   // raw pointer input to the canvas
+        Slider,                        // a parameter slider moved to `value`
+        Play, Stop,                    // parameter animation between min and max
+        Edit,                          // entry text replaced (appends at the end)
+        Delete, Visible, Precision, Mode3D
+    };
+
+    double time = 0.0;  // ms from the start of the replay
+    Type type = Type::Move;
+    double x = 0.0, y = 0.0;
+    bool rightButton = false;
+    int wheelDelta = 120;        // angle delta, 120 per notch
+    int entry = 0;
+    QString name;                // parameter
+    double value = 0.0;          // slider value or precision
+    double minValue = -10.0, maxValue = 10.0;
+    QString expression;
+    bool enabled = true;         // Visible, Mode3D
+};
+
+struct Trace {
+    double frameInterval = 1000.0 / 60.0;  // ms between display frames
+    double settle = 500.0;                 // ms replayed after the last event
+    std::vector<TraceEvent> events;        // sorted by time
+};
+
+// Reads a JSON trace {frameInterval, settle, events [...]}. Each event has
+// "t" (ms) and "type": press/move/release {x, y, button "left"/"right"},
+// wheel {x, y, delta}, slider {entry, name, value}, play {entry, name, min,
+// max}, stop {entry, name}, edit {entry, expression}, delete {entry},
+// visible {entry, visible}, precision {value} or mode3d {enabled}.
+// Two shorthands are expanded into one event per frame:
+//   drag {from [x, y], to [x, y], duration, button} - press, moves, release
+//   slider {entry, name, from, to, duration}        - a slider sweep
+bool loadTrace(const QString& path, Trace& trace, QString& error);
+
+} // namespace ArchMaths
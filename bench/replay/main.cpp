@@ -0,0 +1,165 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "ReplayDriver.h"
+#include "Trace.h"
+#include "headless/Scene.h"
+#include "profile/Profiler.h"
+#include "ui/MainWindow.h"
+
+using namespace ArchMaths;
+
+namespace {
+
+// 最近秩百分位
+template <typename T>
+T percentile(std::vector<T> values, double p) {
+    if (values.empty()) return T();
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+template <typename T>
+double sum(const std::vector<T>& values) {
+    double total = 0.0;
+    for (T v : values) total += static_cast<double>(v);
+    return total;
+}
+
+template <typename T>
+double mean(const std::vector<T>& values) {
+    return values.empty() ? 0.0 : sum(values) / values.size();
+}
+
+template <typename T>
+void writeDistribution(std::ostream& out, const char* name, const std::vector<T>& values) {
+    out << "  \"" << name << "\": {\"p50\": " << percentile(values, 50) << ", \"p95\": " << percentile(values, 95)
+        << ", \"p99\": " << percentile(values, 99) << ", \"max\": " << percentile(values, 100)
+        << ", \"mean\": " << mean(values) << ", \"total\": " << sum(values) << "}";
+}
+
+// Debug output from Qt and the GL driver; keep warnings only
+void quietMessages(QtMsgType type, const QMessageLogContext&, const QString& message) {
+    if (type == QtDebugMsg || type == QtInfoMsg) return;
+    std::cerr << message.toLocal8Bit().constData() << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("archmaths_replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays recorded interaction through the Arch Maths pipeline and reports "
+                                     "frame times, evaluations and uploads per frame as JSON.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("scene", "JSON scene (as for ArchMathsRender; the first scene is used).");
+    parser.addPositionalArgument("trace", "JSON trace of pointer, slider and edit events.");
+    QCommandLineOption outOption("out", "Write the JSON report to FILE instead of stdout.", "FILE");
+    QCommandLineOption perFrameOption("per-frame", "Include every frame in the report.");
+    QCommandLineOption traceOption("trace", "Write a Chrome trace of the pipeline stages to FILE.", "FILE");
+    QCommandLineOption verboseOption("verbose", "Keep debug output.");
+    parser.addOption(outOption);
+    parser.addOption(perFrameOption);
+    parser.addOption(traceOption);
+    parser.addOption(verboseOption);
+    parser.process(app);
+    if (parser.positionalArguments().size() != 2) parser.showHelp(1);
+    if (!parser.isSet(verboseOption)) qInstallMessageHandler(quietMessages);
+
+    QString scenePath = parser.positionalArguments().at(0);
+    QString tracePath = parser.positionalArguments().at(1);
+    std::vector<Scene> scenes;
+    Trace trace;
+    QString error;
+    if (!loadScenes(scenePath, scenes, error) || scenes.empty()) {
+        std::cerr << scenePath.toLocal8Bit().constData() << ": "
+                  << (scenes.empty() && error.isEmpty() ? "no scene" : error.toLocal8Bit().constData()) << std::endl;
+        return 1;
+    }
+    if (!loadTrace(tracePath, trace, error)) {
+        std::cerr << tracePath.toLocal8Bit().constData() << ": " << error.toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    // From the scene load on, so the trace shows the first parse too
+    if (parser.isSet(traceOption)) Profiler::instance().setEnabled(true);
+
+    MainWindow window;
+    ReplayDriver driver(window);
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+    if (!driver.loadScene(scenes.front(), error)) {
+        std::cerr << error.toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+    double loadMs = loadTimer.nsecsElapsed() / 1e6;
+
+    std::vector<ReplayFrame> frames = driver.run(trace);
+    std::vector<double> frameMs;
+    std::vector<uint64_t> evaluations, uploads;
+    for (const ReplayFrame& frame : frames) {
+        frameMs.push_back(frame.milliseconds);
+        evaluations.push_back(frame.evaluations);
+        uploads.push_back(frame.uploadedBytes);
+    }
+
+    std::ostringstream out;
+    out << "{\n  \"scene\": \"" << QFileInfo(scenePath).fileName().toUtf8().constData() << "\",\n"
+        << "  \"trace\": \"" << QFileInfo(tracePath).fileName().toUtf8().constData() << "\",\n"
+        << "  \"events\": " << trace.events.size() << ",\n"
+        << "  \"frameInterval\": " << trace.frameInterval << ",\n"
+        << "  \"loadMs\": " << loadMs << ",\n"
+        << "  \"frames\": " << frames.size() << ",\n";
+    writeDistribution(out, "frameMs", frameMs);
+    out << ",\n";
+    writeDistribution(out, "evaluationsPerFrame", evaluations);
+    out << ",\n";
+    writeDistribution(out, "uploadBytesPerFrame", uploads);
+    if (parser.isSet(perFrameOption)) {
+        out << ",\n  \"perFrame\": [\n";
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const ReplayFrame& f = frames[i];
+            out << "    {\"t\": " << f.time << ", \"ms\": " << f.milliseconds << ", \"events\": " << f.events
+                << ", \"evaluations\": " << f.evaluations << ", \"uploadBytes\": " << f.uploadedBytes << "}"
+                << (i + 1 < frames.size() ? ",\n" : "\n");
+        }
+        out << "  ]";
+    }
+    out << "\n}\n";
+
+    char summary[256];
+    std::snprintf(summary, sizeof(summary),
+                  "%zu frames: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms; %.0f evaluations, %.0f bytes uploaded per frame\n",
+                  frames.size(), percentile(frameMs, 50), percentile(frameMs, 95), percentile(frameMs, 99),
+                  mean(evaluations), mean(uploads));
+    std::cerr << summary;
+
+    if (parser.isSet(traceOption) &&
+        !Profiler::instance().writeChromeTrace(parser.value(traceOption).toLocal8Bit().constData())) {
+        std::cerr << "cannot write " << parser.value(traceOption).toLocal8Bit().constData() << std::endl;
+        return 1;
+    }
+
+    if (parser.isSet(outOption)) {
+        std::ofstream file(parser.value(outOption).toLocal8Bit().constData());
+        file << out.str();
+        if (!file) {
+            std::cerr << "cannot write " << parser.value(outOption).toLocal8Bit().constData() << std::endl;
+            return 1;
+        }
+    } else {
+        std::cout << out.str();
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QImage>
+#include <QMatrix4x4>
+#include <QOffscreenSurface>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QSurfaceFormat>
+#include <QVector4D>
+#include <memory>
+#include <vector>
+#include "headless/Scene.h"
+#include "math/MathTypes.h"
+
+namespace ArchMaths {
+
+// 离屏OpenGL渲染 (Mesa/llvmpipe 亦可): 与画布相同的网格、坐标轴、折线与
+// 光照网格, 绘制到多重采样的帧缓冲后读回为图像.
+// The surface must be created on the GUI thread; the context is created and
+// used on whichever thread calls initialize() and render(), so one renderer
+// per worker thread renders in parallel where the platform supports
+// threaded OpenGL. Images larger than kMaxTileSize are rendered in tiles.
+class OffscreenRenderer {
+public:
+    static constexpr int kSamples = 4;
+    static constexpr int kMaxTileSize = 4096;
+
+    // Format for the QOffscreenSurface and the context (depth buffer for 3D)
+    static QSurfaceFormat surfaceFormat();
+
+    explicit OffscreenRenderer(QOffscreenSurface* surface);
+    ~OffscreenRenderer();
+    OffscreenRenderer(const OffscreenRenderer&) = delete;
+    OffscreenRenderer& operator=(const OffscreenRenderer&) = delete;
+
+    bool initialize(QString& error);
+
+    // Entries as produced by SceneBuilder for the same scene
+    QImage render(const Scene& scene, const std::vector<PlotEntry>& entries);
+
+private:
+    void initShaders();
+    void drawTile(const Scene& scene, const std::vector<PlotEntry>& entries, const QMatrix4x4& tileMatrix);
+    void drawGrid(const Scene& scene);
+    // NaN vertices split the strip; GL_LINES draws pairs
+    void drawLines(const std::vector<float>& vertices, int components, const QVector4D& color,
+                   float width, GLenum mode);
+    void drawMesh(const PlotEntry& entry);
+    static void drawAxisLabels(QImage& image, const Scene& scene);
+
+    QOffscreenSurface* surface_;
+    std::unique_ptr<QOpenGLContext> context_;
+    QOpenGLFunctions* gl_ = nullptr;
+    std::unique_ptr<QOpenGLShaderProgram> lineShader_;
+    std::unique_ptr<QOpenGLShaderProgram> meshShader_;
+    std::unique_ptr<QOpenGLFramebufferObject> fbo_;
+    QOpenGLVertexArrayObject vao_;
+    QOpenGLBuffer vertexBuffer_{QOpenGLBuffer::VertexBuffer};
+    QOpenGLBuffer indexBuffer_{QOpenGLBuffer::IndexBuffer};
+    QMatrix4x4 projection_;  // of the current tile
+};
+
+} // namespace ArchMaths
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QMatrix4x4>
+#include <QString>
+#include <map>
+#include <string>
+#include <vector>
+#include "math/MathTypes.h"
+#include "math/PlotSampler.h"
+
+namespace ArchMaths {
+
+// 场景中的一个表达式
+struct SceneEntry {
+    std::string expression;
+    Color color;
+    float thickness = 3.0f;
+    bool visible = true;
+    // 参数初值; 未列出的参数取1 (与界面新建条目一致)
+    std::map<std::string, double> parameters;
+};
+
+// 一张图: 表达式列表、视图与输出
+struct Scene {
+    QString output;              // .png or .svg; relative to the scene file
+    int width = 800;
+    int height = 600;
+    bool mode3D = false;
+    double precision = 1.0;
+
+    // 2D: math point at the image centre and pixels per unit
+    double center[2] = {0.0, 0.0};
+    double scale = 50.0;
+
+    // 3D: orbit camera, as in the canvas (degrees)
+    double yaw = 45.0;
+    double pitch = 30.0;
+    double distance = 8.0;
+    double target[3] = {0.0, 0.0, 0.0};
+
+    std::vector<SceneEntry> entries;
+
+    // 2D screen mapping of the image
+    PlotView plotView() const;
+    // Grid spacing in math units, 50-200 pixels apart as in the canvas
+    double gridStep() const;
+
+    // Camera position in world (GL) coordinates
+    void cameraEye(double eye[3]) const;
+    // Same projection as the canvas: 45° perspective, near 0.1, far 100
+    QMatrix4x4 viewProjection() const;
+};
+
+// Reads a JSON scene file: one scene object, or an array of them for batch
+// mode. Keys: output, width, height, mode ("2d"/"3d"), precision, center
+// [x, y], scale, camera {yaw, pitch, distance, target [x, y, z]} and
+// entries [{expression, color "#rrggbb", thickness, visible, parameters
+// {name: value}}]; a bare string entry is just the expression.
+// Entries without a colour get the canvas palette. Returns false with
+// `error` set if the file cannot be read or is malformed.
+bool loadScenes(const QString& path, std::vector<Scene>& scenes, QString& error);
+
+} // namespace ArchMaths
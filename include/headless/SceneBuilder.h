@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include "headless/Scene.h"
+#include "math/ExpressionEvaluator.h"
+#include "math/MathTypes.h"
+#include "math/PlotCompiler.h"
+#include "math/PlotSampler.h"
+
+namespace ArchMaths {
+
+// 场景的CPU数据: 与界面相同的解析、求值与网格化代码, 但全部在CPU上
+// (不使用着色器求值). 每个工作线程一个实例.
+class SceneBuilder {
+public:
+    SceneBuilder();
+
+    // One PlotEntry per scene entry, with the data its mode draws:
+    //   2D: vertices (screen pixels; Implicit3D as its z = 0 slice)
+    //   Surface3D: vertices3D/indices3D in GL coordinates (x, z, y)
+    //   Implicit3D: vertices3D/indices3D in math coordinates
+    //   Parametric3D: vertices3D as x,y,z runs separated by NaN triples
+    // Entries that fail to parse keep hasError/errorMessage.
+    std::vector<PlotEntry> build(const Scene& scene);
+
+private:
+    void buildSurface(PlotEntry& entry, const Scene& scene, const VariableContext& vars);
+    void buildImplicit3D(PlotEntry& entry, const Scene& scene, const VariableContext& vars);
+
+    PlotCompiler compiler_;
+    ExpressionEvaluator evaluator_;
+    PlotSampler sampler_;
+};
+
+} // namespace ArchMaths
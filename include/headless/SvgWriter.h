@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "headless/Scene.h"
+#include "math/MathTypes.h"
+
+namespace ArchMaths {
+
+// 矢量输出. 2D: grid, axes, labels and one path per curve, split at NaN
+// breaks. 3D: triangles projected with the scene camera, flat shaded as in
+// the canvas and drawn back to front (painter's algorithm); curves and axes
+// are drawn over the surfaces.
+class SvgWriter {
+public:
+    // Entries as produced by SceneBuilder for the same scene
+    static bool write(const std::string& path, const Scene& scene, const std::vector<PlotEntry>& entries);
+};
+
+} // namespace ArchMaths
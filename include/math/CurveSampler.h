@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace ArchMaths {
+
+// 平面参数曲线的自适应采样设置 (屏幕像素)
+struct CurveSamplerSettings {
+    double tMin = 0.0;
+    double tMax = 1.0;
+    int initialSamples = 256;
+    // Segments longer than this are split
+    double maxSegmentLength = 4.0;
+    // Segments longer than minSegmentLength are split where the curve turns
+    // by more than acos(minTurnCos) against a neighbouring segment
+    double minSegmentLength = 0.5;
+    double minTurnCos = 0.985;
+    int maxPasses = 10;
+    size_t maxSamples = size_t(1) << 18;
+    // Screen rectangle; refinement is skipped for segments well outside it
+    double viewMin[2] = {0.0, 0.0};
+    double viewMax[2] = {0.0, 0.0};
+};
+
+// Samples p(t) densely enough that consecutive points are at most
+// maxSegmentLength apart on screen and the polyline does not visibly bend,
+// starting from a uniform grid and bisecting only the segments that fail.
+// Every pass evaluates all of its new parameters in one batch call.
+// Non-finite samples are kept (they mark gaps); the boundary of a gap is
+// narrowed by bisection too.
+class CurveSampler {
+public:
+    // Maps parameters to screen positions; x and y are resized by the callee
+    using Batch = std::function<void(const std::vector<double>& t, std::vector<double>& x, std::vector<double>& y)>;
+
+    static void sample(const Batch& evaluate, const CurveSamplerSettings& settings,
+                       std::vector<double>& t, std::vector<double>& x, std::vector<double>& y);
+};
+
+} // namespace ArchMaths
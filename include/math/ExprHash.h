@@ -0,0 +1,51 @@
+#pragma once
+
+#include "math/MathTypes.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace ArchMaths {
+
+// 增量64位哈希 (FNV-1a, 最后做splitmix64混合)
+class HashBuilder {
+public:
+    HashBuilder& add(const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            state_ ^= bytes[i];
+            state_ *= 0x100000001B3ull;
+        }
+        return *this;
+    }
+    HashBuilder& add(uint64_t v) { return add(&v, sizeof(v)); }
+    HashBuilder& add(int v) { return add(static_cast<uint64_t>(static_cast<int64_t>(v))); }
+    HashBuilder& add(bool v) { return add(static_cast<uint64_t>(v)); }
+    HashBuilder& add(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return add(bits);
+    }
+    HashBuilder& add(const std::string& s) {
+        add(static_cast<uint64_t>(s.size()));
+        return add(s.data(), s.size());
+    }
+
+    uint64_t value() const {
+        uint64_t z = state_ + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    uint64_t state_ = 0xCBF29CE484222325ull;
+};
+
+// Structural hash of an expression tree. Formatting and redundant
+// parentheses never reach the tree, and operands of + and * are combined
+// order-independently (both commute exactly in floating point), so
+// "a*x + y" and "y+x*a" hash the same.
+uint64_t hashExpression(const ExprNodePtr& node);
+
+} // namespace ArchMaths
@@ -1,11 +1,25 @@
 #pragma once
 
 #include "math/MathTypes.h"
+#include <atomic>
+#include <cstdint>
 #include <unordered_map>
 #include <functional>
+#include <cmath>
 
 namespace ArchMaths {
 
+// 闭区间 [lo, hi] (区间算术用), 默认为整个实数轴
+struct Interval {
+    double lo = -INFINITY;
+    double hi = INFINITY;
+
+    Interval() = default;
+    Interval(double l, double h) : lo(l), hi(h) {}
+    bool excludesZero() const { return lo > 0.0 || hi < 0.0; }
+};
+using IntervalContext = std::unordered_map<std::string, Interval>;
+
 class ExpressionEvaluator {
 public:
     ExpressionEvaluator();
@@ -20,6 +34,15 @@ public:
                        const VariableContext& baseVars,
                        const std::string& varName = "x");
 
+    // 参数曲线的两个分量一次批量求值, 共用每个样本的变量上下文
+    void evaluateBatchPair(const ExprNodePtr& first,
+                           const ExprNodePtr& second,
+                           const std::vector<double>& tValues,
+                           std::vector<double>& firstResults,
+                           std::vector<double>& secondResults,
+                           const VariableContext& baseVars,
+                           const std::string& varName = "t");
+
     // 2D网格求值（用于3D曲面 z=f(x,y)）
     void evaluateGrid(const ExprNodePtr& node,
                       const std::vector<double>& xValues,
@@ -35,13 +58,33 @@ public:
                         std::vector<double>& results,
                         const VariableContext& baseVars);
 
+    // 散点求值: points 为 (x, y, z) 三元组, 每点一个结果 (用于八叉树网格化,
+    // 一次求值整层格点或整批梯度采样)
+    void evaluatePoints(const ExprNodePtr& node,
+                        const std::vector<double>& points,
+                        std::vector<double>& results,
+                        const VariableContext& baseVars);
+
+    // 区间求值: 变量在 ranges 中取区间, 其余取 baseVars 的值.
+    // 结果保守地包含表达式在定义域内的所有取值
+    Interval evaluateInterval(const ExprNodePtr& node,
+                              const IntervalContext& ranges,
+                              const VariableContext& baseVars);
+
     // 注册自定义函数
     void registerFunction(const std::string& name, MathFunction func);
 
+    // 累计的逐点求值次数 (批量接口每个样本计一次, 区间求值不计).
+    // Relaxed counter, safe to read while other threads evaluate.
+    uint64_t evaluationCount() const { return evaluations_.load(std::memory_order_relaxed); }
+
 private:
+    double evaluateNode(const ExprNodePtr& node, const VariableContext& vars);
     double evaluateFunction(const std::string& name, const std::vector<double>& args);
+    Interval evaluateFunctionInterval(const std::string& name, const std::vector<Interval>& args);
 
     FunctionRegistry functions_;
+    std::atomic<uint64_t> evaluations_{0};
     void initBuiltinFunctions();
 };
 
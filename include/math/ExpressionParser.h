@@ -22,6 +22,9 @@ public:
     void setUserFunctions(UserFunctionRegistry* registry) { userFunctions_ = registry; }
     bool isUserFunctionDefinition(const std::string& expression) const;
 
+    // 用户函数体内调用用户函数的最大嵌套层数
+    static constexpr int kMaxSubstitutionDepth = 32;
+
 private:
     ExprNodePtr parseExpression();
     ExprNodePtr parseComparison();
@@ -47,6 +50,7 @@ private:
     bool hasError_ = false;
     std::string errorMessage_;
     UserFunctionRegistry* userFunctions_ = nullptr;
+    int substitutionDepth_ = 0;
 };
 
 } // namespace ArchMaths
@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include <cmath>
 #include <memory>
+#include <cstdint>
 
 namespace ArchMaths {
 
@@ -120,6 +121,9 @@ using FunctionRegistry = std::unordered_map<std::string, MathFunction>;
 struct UserFunction {
     std::vector<std::string> params;  // 参数名列表
     std::string bodyStr;               // 函数体字符串
+    // bodyStr的AST, 其中的用户函数调用已替换; 首次调用时由解析器填入,
+    // 注册表变化时需清空
+    ExprNodePtr body;
 };
 using UserFunctionRegistry = std::unordered_map<std::string, UserFunction>;
 
@@ -135,6 +139,14 @@ enum class PlotType {
     Polar           // r = f(θ)
 };
 
+// 渲染器实际使用的数据表示
+enum class Representation {
+    None,      // not drawn (hidden, or not shown in the current mode)
+    GPU,       // evaluated in shaders; no CPU data
+    Polyline,  // 2D screen-space vertices (PlotEntry::vertices)
+    Mesh       // 3D geometry (vertices3D/indices3D or packed meshes)
+};
+
 // 颜色结构 (HSB)
 struct Color {
     float h = 0.0f;   // 色相 0-360
@@ -198,6 +210,9 @@ struct ParameterInfo {
     double maxValue = 10.0;
 };
 
+struct PackedMesh;    // mesh/SurfaceMesh.h
+class OctreeMesher;   // mesh/OctreeMesher.h
+
 // 绘图条目
 struct PlotEntry {
     std::string expression;
@@ -217,6 +232,9 @@ struct PlotEntry {
     // 参数列表 (非x,y,t,θ的变量)
     std::vector<ParameterInfo> parameters;
 
+    // 当前有效的CPU数据; 表达式、参数或视图改变后重置为None
+    Representation computedData = Representation::None;
+
     // 缓存的绘图数据
     std::vector<Point2D> plotPoints;
     std::vector<float> vertices; // OpenGL顶点数据
@@ -225,6 +243,12 @@ struct PlotEntry {
     std::vector<Point3D> plotPoints3D;
     std::vector<float> vertices3D;    // x,y,z,nx,ny,nz per vertex
     std::vector<unsigned int> indices3D;  // Triangle indices
+    // 紧凑曲面网格 (Surface3D), 每个可见分块一个; 共享指针, 复制条目时不复制网格
+    std::vector<std::shared_ptr<const PackedMesh>> packedMeshes3D;
+    // 上面3D数据在几何缓存中的键 (保存会话时随几何一起写出)
+    std::vector<uint64_t> geometryKeys;
+    // 隐式曲面的自适应八叉树 (Implicit3D); 保留采样缓存, 相机移动时增量重建
+    std::shared_ptr<OctreeMesher> octreeMesher;
 };
 
 } // namespace ArchMaths
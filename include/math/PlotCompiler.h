@@ -0,0 +1,45 @@
+#pragma once
+
+#include "math/MathTypes.h"
+#include "math/ExpressionParser.h"
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ArchMaths {
+
+// 把条目的表达式文本编译为AST并确定绘图类型.
+// 用户函数定义在所有条目间共享, 由 defineFunctions 从整个条目列表重建;
+// 不依赖Qt, 界面与无界面渲染器共用
+class PlotCompiler {
+public:
+    PlotCompiler();
+    PlotCompiler(const PlotCompiler&) = delete;
+    PlotCompiler& operator=(const PlotCompiler&) = delete;
+
+    // 重新注册所有条目中的函数定义 name(params) = body (先出现的定义优先)
+    void defineFunctions(const std::vector<PlotEntry>& entries);
+    const UserFunctionRegistry& userFunctions() const { return userFunctions_; }
+
+    // 解析条目, 设置 plotType 与 compiledExpr(X/Y/Z); 失败时设置 hasError
+    void compile(PlotEntry& entry);
+
+    // 表达式中的自由变量 (x, y, t, θ, r 以外) 作为条目参数.
+    // 已有参数保留其值, 新参数取 vars 中的值 (没有则为1并写入 vars)
+    static void extractParameters(PlotEntry& entry, VariableContext& vars);
+    static void collectVariables(const ExprNodePtr& node, std::set<std::string>& vars);
+    static bool containsVariable(const ExprNodePtr& node, const std::string& varName);
+
+    // 拆分 "(a, b, ...)" 形式的元组, 只在最外层括号内的逗号处拆分
+    static bool splitTuple(const std::string& expr, std::vector<std::string>& parts);
+    // 识别 name(params) = body 形式的函数定义; 名称与参数转为小写
+    static bool parseFunctionDefinition(const std::string& expr, std::string& funcName,
+                                        std::vector<std::string>& params, std::string& body);
+
+private:
+    std::unique_ptr<ExpressionParser> parser_;
+    UserFunctionRegistry userFunctions_;
+};
+
+} // namespace ArchMaths
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "math/MathTypes.h"
+#include "math/ExpressionEvaluator.h"
+#include <cmath>
+#include <vector>
+
+namespace ArchMaths {
+
+// 2D视图快照: 数学坐标 (x, y) 映射到屏幕像素 (offsetX + x*scale, offsetY - y*scale).
+// 后台计算的帧与无界面渲染使用提交时的视图
+struct PlotView {
+    double scale = 50.0;
+    double offsetX = 0.0;
+    double offsetY = 0.0;
+    int width = 0;
+    int height = 0;
+    double precision = 1.0;
+};
+
+// CPU采样: 2D条目生成屏幕空间折线, 3D参数曲线生成数学坐标下的点列.
+// 只读取参数, 不修改自身状态, 可在任意线程上使用
+// (ExpressionEvaluator 初始化后只读)
+class PlotSampler {
+public:
+    // 参数曲线的参数范围: t ∈ [0, 2π], 极坐标 θ ∈ [0, 12π] (多圈螺线与玫瑰线)
+    static constexpr double kParametricTMax = 2.0 * M_PI;
+    static constexpr double kPolarThetaMax = 12.0 * M_PI;
+    // 3D参数曲线的采样数 (乘以精度)
+    static constexpr int kParametric3DSamples = 20000;
+
+    explicit PlotSampler(ExpressionEvaluator& evaluator) : evaluator_(evaluator) {}
+
+    // Screen-space curve of a CPU-evaluated 2D entry into entry.vertices
+    // (and plotPoints for y = f(x)); NaN pairs break the line
+    void samplePolyline(PlotEntry& entry, const PlotView& view, const VariableContext& vars) const;
+
+    // x,y,z triples of a Parametric3D entry over [0, kParametricTMax] with
+    // `samples` uniform steps; NaN triples separate the runs
+    void sampleCurve3D(const PlotEntry& entry, int samples, const VariableContext& vars,
+                       std::vector<float>& out) const;
+
+private:
+    ExpressionEvaluator& evaluator_;
+};
+
+} // namespace ArchMaths
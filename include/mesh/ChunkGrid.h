@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace ArchMaths {
+
+// Surface3D tiles cover [i, i+1] x [j, j+1] * kSurfaceChunkSize in math x/y
+// (GL x/z); one tile is as large as the old fixed ±5 domain
+constexpr double kSurfaceChunkSize = 10.0;
+constexpr size_t kMaxSurfaceChunks = 64;
+
+struct ChunkCoord {
+    int i = 0;
+    int j = 0;
+    int lod = 0;  // simplification level the mesh was built for; 0 = full grid
+
+    bool operator==(const ChunkCoord& other) const { return i == other.i && j == other.j && lod == other.lod; }
+};
+
+// 3D视图 (GL世界坐标)
+struct ChunkView {
+    double viewProj[16];   // row-major: clip = viewProj * (x, y, z, 1)
+    double target[3];      // camera look-at point
+    double radius = 10.0;  // tiles farther than this from the target on the ground plane are skipped
+};
+
+// Tiles of the ground plane around the target that intersect the view
+// frustum, nearest first, at most maxChunks. Tiles are treated as columns
+// of height ±radius around the target since their surface is not known yet.
+std::vector<ChunkCoord> visibleChunks(const ChunkView& view, double chunkSize, size_t maxChunks);
+
+} // namespace ArchMaths
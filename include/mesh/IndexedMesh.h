@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace ArchMaths {
+
+// Indexed triangle mesh, vertices interleaved as position + normal (6 floats)
+struct IndexedMesh {
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+
+    size_t vertexCount() const { return vertices.size() / 6; }
+    void clear() { vertices.clear(); indices.clear(); }
+};
+
+// Reorders triangles for the post-transform vertex cache (Forsyth's
+// linear-speed algorithm) and renumbers vertices in first-use order so
+// vertex fetch is sequential too.
+void optimizeVertexCache(IndexedMesh& mesh);
+
+} // namespace ArchMaths
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+namespace ArchMaths {
+
+// Marching squares for the f = 0 contour.
+// field[j][i] = f(xVals[i], yVals[j]) (the layout of evaluateGrid). Cells
+// touching a non-finite sample are skipped; crossings are placed by linear
+// interpolation along the cell edges.
+class MarchingSquares {
+public:
+    // Appends each segment as x0, y0, x1, y1 in the coordinates of xVals/yVals
+    static void extract(const std::vector<std::vector<double>>& field,
+                        const std::vector<double>& xVals,
+                        const std::vector<double>& yVals,
+                        std::vector<double>& segments);
+};
+
+} // namespace ArchMaths
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ArchMaths {
+
+struct PackedMesh;
+
+// 缓存的几何数据: 顶点/索引 (Implicit3D, Parametric3D) 或紧凑网格 (Surface3D分块)
+struct CachedGeometry {
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::shared_ptr<const PackedMesh> packed;
+
+    size_t byteSize() const;
+};
+
+// Content-addressed geometry shared by all plots. The key hashes everything
+// the geometry depends on: canonical expression, parameter values, domain
+// and resolution. Returning to a state seen before (3D toggle, precision,
+// a re-entered expression, an earlier parameter value) is a lookup instead
+// of a rebuild. Least recently used geometry is evicted past the byte budget.
+class MeshCache {
+public:
+    explicit MeshCache(size_t budgetBytes) : budgetBytes_(budgetBytes) {}
+
+    // Marks the geometry as most recently used; null if not cached
+    std::shared_ptr<const CachedGeometry> find(uint64_t key);
+    void insert(uint64_t key, std::shared_ptr<const CachedGeometry> geometry);
+    void clear();
+
+    size_t size() const { return index_.size(); }
+    size_t byteSize() const { return bytes_; }
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    using Item = std::pair<uint64_t, std::shared_ptr<const CachedGeometry>>;
+
+    std::list<Item> lru_;  // front = most recent
+    std::unordered_map<uint64_t, std::list<Item>::iterator> index_;
+    size_t bytes_ = 0;
+    size_t budgetBytes_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+};
+
+} // namespace ArchMaths
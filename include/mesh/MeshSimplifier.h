@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include "mesh/IndexedMesh.h"
+
+namespace ArchMaths {
+
+// 网格简化目标
+struct SimplifySettings {
+    // At most this many triangles (0 = no budget). With an error bound the
+    // mesh is still reduced below the budget while the bound holds; only a
+    // mesh the bound leaves over budget is reduced further, past the bound.
+    size_t targetTriangles = 0;
+
+    // Allowed geometric error at p: maxError + errorPerDistance * |p - eye|.
+    // errorPerDistance is the world size of the tolerated screen error at
+    // unit distance, which makes the bound screen-space. All 0 = no bound.
+    double maxError = 0.0;
+    double errorPerDistance = 0.0;
+    double eye[3] = {0.0, 0.0, 0.0};
+};
+
+// Quadric error metric simplification (Garland & Heckbert 1997) by
+// half-edge collapses: a vertex merges into a neighbour, so every kept
+// vertex keeps its exact position and normal. Vertices on open boundaries
+// never move, which keeps hole outlines and lets tiles simplified
+// separately still meet exactly. Collapses that would flip a triangle or
+// pinch the surface into a non-manifold edge are rejected.
+// With an error bound, collapses continue while it holds, whatever the
+// triangle budget; the budget only decides whether to go on past the bound.
+// The result is reordered for the vertex cache.
+class MeshSimplifier {
+public:
+    static void simplify(IndexedMesh& mesh, const SimplifySettings& settings);
+};
+
+} // namespace ArchMaths
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "mesh/IndexedMesh.h"
+
+namespace ArchMaths {
+
+// 八叉树网格化的视图与分辨率设置
+struct OctreeMeshSettings {
+    double center[3] = {0.0, 0.0, 0.0};
+    double halfSize = 3.0;       // root cube is center ± halfSize
+    int maxDepth = 6;            // finest cell = 2 * halfSize / 2^maxDepth
+    int minDepth = 3;
+
+    double eye[3] = {0.0, 0.0, 8.0};
+    double viewDir[3] = {0.0, 0.0, -1.0};  // normalized
+    // Target cell size per unit of distance from the eye
+    double detail = 0.02;
+    // Cells at their distance target still split while the surface normals
+    // inside them disagree by more than this (cosine), up to kCurvatureLevels
+    double curvatureCos = 0.9;
+};
+
+// Settings for a camera at `eye` looking at `target` (math coordinates):
+// ±3 around the target at the default zoom, doubling as the camera backs
+// off; the finest level gains one step per doubling of `precision`
+OctreeMeshSettings cameraMeshSettings(const double eye[3], const double target[3], double precision);
+
+// Adaptive dual contouring (Ju et al. 2002) of f = 0 on an octree.
+// Cells are refined towards the camera and where the surface bends, so a
+// detailed surface no longer needs a uniformly dense grid. Because the mesh
+// is dual to the octree (one vertex per leaf, one quad per minimal edge),
+// leaves of different sizes always share their connecting polygons and
+// LOD transitions are crack-free without stitching.
+//
+// The tree is built a level at a time: the new corner samples of a whole
+// level, and the gradient samples of all cells solved together, go to the
+// sampler as one batch, and the per-cell work runs in parallel. Corner
+// samples and vertices are cached per cell across builds, so remeshing after
+// a camera move only evaluates the cells whose level actually changed.
+//
+// When the function changes a little per frame (an animated parameter), the
+// next build only visits a band of blocks around the previous surface. If
+// the new surface reaches the edge of the band it may continue outside, and
+// the build falls back to a full pass; a full pass also runs periodically
+// so surfaces born outside the band are found.
+class OctreeMesher {
+public:
+    // f at each point of `points` ((x, y, z) triples in math coordinates),
+    // one value per point; inside is f < 0. Batches hold up to a whole
+    // octree level, so the sampler should evaluate them in parallel.
+    using Sampler = std::function<void(const std::vector<double>& points, std::vector<double>& values)>;
+    // Conservative bounds (lo, hi) of f inside the box, e.g. by interval
+    // arithmetic: a box whose bounds exclude 0 is not refined. (-inf, inf)
+    // means f cannot be bounded there; past kUnboundedDepth such boxes are
+    // only refined where their corners change sign. Called from several
+    // threads at once.
+    using BoxBound = std::function<std::pair<double, double>(const double lo[3], const double hi[3])>;
+
+    // key identifies the function (expression and parameter values); the
+    // caches are kept only while it stays the same. coherent: f is a small
+    // change of the previous function, so its surface is near the old one.
+    void setFunction(Sampler f, BoxBound bound, const std::string& key, bool coherent = false);
+
+    // true if the camera moved enough since the last build to change the LOD
+    bool needsRebuild(const OctreeMeshSettings& settings) const;
+
+    void build(const OctreeMeshSettings& settings, IndexedMesh& mesh);
+
+    // Points the last build passed to the sampler (corners and gradients)
+    size_t evaluations() const { return evaluations_; }
+    size_t leafCount() const { return leafCount_; }
+    // The last build stopped refining at kMaxNodes, so it is coarser than
+    // the settings ask for
+    bool lastBuildTruncated() const { return lastBuildTruncated_; }
+    // The last build only visited the band around the previous surface
+    bool lastBuildIncremental() const { return lastBuildIncremental_; }
+    void clearCache();
+
+    static constexpr int kMaxDepth = 19;
+    static constexpr int kCurvatureLevels = 2;
+    // Band blocks are 2^kBandLevels finest cells wide; the band reaches
+    // kBandRadius blocks around every block the surface passed through
+    static constexpr int kBandLevels = 2;
+    static constexpr int kBandRadius = 2;
+    static constexpr int kMaxIncrementalBuilds = 60;
+    // Cells f cannot be bounded in and whose corners agree in sign stop at
+    // this depth (32 cells per axis), or at minDepth if that is deeper
+    static constexpr int kUnboundedDepth = 5;
+    // A level that would take the tree past this many nodes is not split
+    // (about 170 MB of nodes and their cells)
+    static constexpr size_t kMaxNodes = size_t(1) << 20;
+
+private:
+    // Per-cell results kept across builds, keyed by cell position and depth
+    struct CellInfo {
+        // 1: surface may pass through; 2: f unbounded here; 0: no surface;
+        // -1: not tested
+        signed char active = -1;
+        bool sampled = false;
+        bool solved = false;      // position and curved
+        bool shaded = false;      // normal
+        bool curved = false;
+        double corner[8] = {};    // f at corner c, offset (c>>2 & 1, c>>1 & 1, c & 1)
+        float position[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+    };
+
+    struct Node {
+        int x = 0, y = 0, z = 0;  // min corner on the finest lattice
+        int depth = 0;
+        int parent = -1;
+        int firstChild = -1;      // 8 consecutive nodes, or -1 for a leaf
+        int leaf = -1;            // index into leaves_ if the leaf has a vertex
+        unsigned char inside = 0; // corner c inside (f < 0) -> bit c
+        unsigned char invalid = 0;
+        CellInfo* info = nullptr; // in cells_ (stable); null outside the band
+    };
+
+    struct LeafVertex {
+        int node = -1;
+        int outputIndex = -1;  // assigned when a quad first uses the leaf
+    };
+
+    // The quad around one minimal sign-change edge
+    struct EdgeQuad {
+        int leaf[4];           // into leaves_
+        bool firstInside;      // the edge's first corner has f < 0
+    };
+
+    uint64_t cellKey(int x, int y, int z, int depth) const;
+    bool inBand(const Node& node) const;
+    // Rebuilds the band from this build's surface leaves; false if the
+    // surface touched the edge of the band it was built in
+    bool updateBand(bool builtInBand);
+    void buildTree(IndexedMesh& mesh);
+    // Examines one depth of the tree; the children it creates go to `next`
+    void buildLevel(const std::vector<int>& level, std::vector<int>& next);
+
+    void evaluate(const std::vector<double>& points, std::vector<double>& values);
+    void worldPosition(double ix, double iy, double iz, double p[3]) const;
+    CellInfo& cell(const Node& node);
+    // Corner samples of the nodes' cells that are not cached yet
+    void sampleCorners(const std::vector<int>& indices);
+    // Vertex position and curvature of the nodes' cells not solved yet; the
+    // curvature test needs only these
+    void solveCells(const std::vector<int>& indices);
+    // Vertex normals, for the cells that become leaves
+    void shadeCells(const std::vector<int>& indices);
+    double targetSize(const Node& node) const;
+
+    void cellProc(int n, std::vector<EdgeQuad>& quads);
+    void faceProc(int n0, int n1, int dir, std::vector<EdgeQuad>& quads);
+    void edgeProc(const int n[4], int dir, std::vector<EdgeQuad>& quads);
+    void processEdge(const int n[4], int dir, std::vector<EdgeQuad>& quads);
+
+    Sampler f_;
+    BoxBound bound_;
+    std::string key_;
+
+    OctreeMeshSettings settings_;
+    bool built_ = false;
+    double spacing_ = 0.0;
+
+    std::unordered_map<uint64_t, CellInfo> cells_;
+    size_t evaluations_ = 0;
+    std::vector<Node> nodes_;
+    std::vector<LeafVertex> leaves_;
+    size_t leafCount_ = 0;
+
+    // Temporal coherence: band blocks (and their ancestors) around the last
+    // surface, valid for the lattice it was built on
+    std::unordered_set<uint64_t> band_;
+    int bandDepth_ = 0;
+    double bandLattice_[5] = {0.0, 0.0, 0.0, 0.0, 0.0};  // center, halfSize, maxDepth
+    std::vector<int> surfaceLeaves_;  // leaves with a sign change, this build
+    bool coherent_ = false;
+    bool useBand_ = false;
+    bool lastBuildIncremental_ = false;
+    bool lastBuildTruncated_ = false;
+    int incrementalBuilds_ = 0;
+};
+
+} // namespace ArchMaths
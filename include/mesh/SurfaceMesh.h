@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "mesh/IndexedMesh.h"
+
+namespace ArchMaths {
+
+// Compact indexed mesh for z = f(x,y) surfaces.
+// Vertex layout (stride bytes): position as 3 floats, or 3 x int16 snorm
+// relative to the mesh bounds plus 2 bytes padding; then the normal as an
+// octahedral-encoded 2 x int16 snorm. 16 or 12 bytes instead of 24.
+struct PackedMesh {
+    std::vector<unsigned char> vertices;
+    std::vector<uint16_t> indices16;  // used when every index fits
+    std::vector<uint32_t> indices32;
+    size_t vertexCount = 0;
+    int stride = 0;
+    int normalOffset = 0;
+
+    bool positions16 = false;
+    float center[3] = {0.0f, 0.0f, 0.0f};  // positions16: pos = center + extent * snorm
+    float extent[3] = {1.0f, 1.0f, 1.0f};
+
+    // Unique per build, so the canvas re-uploads only when it changes
+    uint64_t revision = 0;
+
+    size_t indexCount() const { return indices16.empty() ? indices32.size() : indices16.size(); }
+    size_t byteSize() const {
+        return vertices.size() + indices16.size() * sizeof(uint16_t) + indices32.size() * sizeof(uint32_t);
+    }
+};
+
+class SurfaceMesh {
+public:
+    // zGrid[j][i] = f(xVals[i], yVals[j]). Math (x, y, z) maps to GL (x, z, y).
+    // Only cells touching a non-finite sample are dropped.
+    // The outer `apron` rows and columns only feed the normals, so tiles
+    // built side by side shade continuously across their shared edge.
+    static void triangulate(const std::vector<std::vector<double>>& zGrid,
+                            const std::vector<double>& xVals,
+                            const std::vector<double>& yVals,
+                            int apron,
+                            IndexedMesh& mesh);
+
+    // Packs a height-field mesh (GL y up) into the compact layout.
+    // positions16 falls back to floats when the height spans too many orders
+    // of magnitude for 16-bit quantization.
+    static std::shared_ptr<PackedMesh> pack(const IndexedMesh& mesh, bool positions16);
+
+    // triangulate + pack
+    static std::shared_ptr<PackedMesh> build(const std::vector<std::vector<double>>& zGrid,
+                                             const std::vector<double>& xVals,
+                                             const std::vector<double>& yVals,
+                                             bool positions16,
+                                             int apron = 0);
+
+    // A fresh PackedMesh::revision, for meshes not made by pack()
+    static uint64_t newRevision();
+};
+
+// Octahedral normal encoding into two snorm16 values
+void encodeOctahedral(float nx, float ny, float nz, int16_t out[2]);
+
+} // namespace ArchMaths
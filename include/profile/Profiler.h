@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ArchMaths {
+
+// 一帧的工作阶段: 解析、着色器编译、求值、网格化、上传、绘制
+enum class ProfileStage {
+    Parse,
+    Compile,
+    Evaluate,
+    Mesh,
+    Upload,
+    Draw,
+    Count
+};
+
+const char* stageName(ProfileStage stage);
+
+// Work done for one plot entry
+struct EntryCounters {
+    uint64_t samples = 0;   // function evaluations
+    uint64_t vertices = 0;  // vertices produced
+    uint64_t bytes = 0;     // bytes uploaded to the GPU
+};
+
+// Work since the previous frame. Stage times are exclusive: an upload inside
+// a draw counts as upload only.
+struct FrameProfile {
+    double stageMs[static_cast<int>(ProfileStage::Count)] = {};
+    double intervalMs = 0.0;  // since the previous frame ended
+    std::map<int, EntryCounters> entries;
+
+    double totalMs() const;
+};
+
+// Process-wide scoped-timer profiler. Disabled, a scope costs one relaxed
+// atomic load; enabled, a scope records one trace event under a mutex, so
+// scopes belong around whole stages per entry, not per sample.
+class Profiler {
+public:
+    static constexpr size_t kMaxFrames = 240;
+    static constexpr size_t kMaxTraceEvents = size_t(1) << 18;
+
+    static Profiler& instance();
+
+    void setEnabled(bool enabled);
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // entry < 0 is work not tied to one plot
+    void record(ProfileStage stage, int entry, int64_t startNs, int64_t durationNs, int64_t exclusiveNs);
+    void count(int entry, uint64_t samples, uint64_t vertices, uint64_t bytes);
+    // Closes the current frame and starts the next
+    void endFrame();
+
+    // Oldest first
+    std::vector<FrameProfile> recentFrames() const;
+    void clear();
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto)
+    bool writeChromeTrace(const std::string& path) const;
+
+    // Nanoseconds on a monotonic clock since the profiler was created
+    int64_t nowNs() const;
+
+private:
+    Profiler();
+
+    struct TraceEvent {
+        char phase;  // 'X' complete, 'C' counter
+        int stage;   // -1 for a frame
+        int entry;
+        int thread;
+        int64_t startNs;
+        int64_t durationNs;
+        EntryCounters counters;
+    };
+
+    int threadIndex();  // caller holds mutex_
+    void pushEvent(const TraceEvent& event);
+
+    std::atomic<bool> enabled_{false};
+    int64_t epochNs_;
+
+    mutable std::mutex mutex_;
+    std::deque<TraceEvent> events_;
+    std::map<std::thread::id, int> threads_;
+    std::deque<FrameProfile> frames_;
+    FrameProfile current_;
+    int64_t frameStartNs_ = 0;
+};
+
+// 作用域计时: 构造时开始, 析构时记录. 嵌套作用域从外层扣除自身时间
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileStage stage, int entry = -1);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileStage stage_;
+    int entry_;
+    bool active_;
+    int64_t startNs_ = 0;
+    int64_t childNs_ = 0;
+    ProfileScope* parent_ = nullptr;
+};
+
+} // namespace ArchMaths
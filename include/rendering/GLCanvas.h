@@ -3,6 +3,7 @@
 #include <cstring>
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLBuffer>
 #include <QOpenGLVertexArrayObject>
@@ -10,12 +11,13 @@
 #include <QPointF>
 #include <QVector3D>
 #include <memory>
+#include <unordered_map>
 #include "math/MathTypes.h"
+#include "mesh/ChunkGrid.h"
 
 namespace ArchMaths {
 
-// Compile expression tree to GLSL code
-std::string compileToGLSL(const ExprNodePtr& node);
+class ReplayDriver;
 
 class GLCanvas : public QOpenGLWidget, protected QOpenGLFunctions {
     Q_OBJECT
@@ -34,15 +36,44 @@ public:
 
     void setPlotEntries(const std::vector<PlotEntry>& entries);
     void updatePlotData(int index, const std::vector<float>& vertices);
+    void updateParameters(int index, const std::vector<ParameterInfo>& parameters);
     void requestRedraw();
+    // Bytes sent to vertex/index buffers since construction
+    uint64_t uploadedBytes() const { return uploadedBytes_; }
+    // Overlay of the profiler's recent frames; shows data only while the
+    // profiler is enabled
+    void setHudVisible(bool visible);
+    bool hudVisible() const { return hudVisible_; }
+
+    // Entries evaluated entirely in shaders need no CPU plot data
+    bool isGPUEvaluated(const PlotEntry& entry);
+    // What the current mode draws this entry from; only that is computed
+    Representation requiredRepresentation(const PlotEntry& entry);
+    void setPrecision(double multiplier);
 
     // 3D mode
     void set3DMode(bool enabled);
     bool is3DMode() const { return is3DMode_; }
+    // Camera position and look-at point in world space
+    QVector3D cameraEye() const;
+    QVector3D cameraTarget() const { return cameraTarget_; }
+    // Orbit camera: angles in degrees around the target
+    float cameraYaw() const { return cameraYaw_; }
+    float cameraPitch() const { return cameraPitch_; }
+    float cameraDistance() const { return cameraDistance_; }
+    void setCamera(float yaw, float pitch, float distance, const QVector3D& target);
+    QMatrix4x4 viewProjection3D() const;
+    // Frustum and streaming radius for picking the 3D tiles to generate
+    ChunkView chunkView() const;
 
 signals:
     void viewChanged(QPointF offset, double scale);
     void mousePositionChanged(QPointF mathPos);
+    // A generated shader failed to build; GPU-evaluated entries need CPU data
+    void gpuFallbackRequired();
+    // The 3D camera orbited, panned or zoomed; view-dependent meshes and
+    // streamed tiles may need updating
+    void cameraChanged();
 
 protected:
     void initializeGL() override;
@@ -55,14 +86,24 @@ protected:
     void wheelEvent(QWheelEvent* event) override;
 
 private:
+    // 回放工具直接驱动绘制 (无窗口)
+    friend class ReplayDriver;
+
+    // allocate() on a bound buffer, counted in uploadedBytes_ and profiled
+    // as the entry's upload
+    void uploadBuffer(QOpenGLBuffer& buffer, const void* data, int bytes, int entry = -1);
     void initShaders();
     void drawGrid();
     void drawAxes();
     void drawPlots();
-    void drawImplicitGPU(const PlotEntry& entry);
-    bool compileImplicitShader(const ExprNodePtr& expr, const Color& color,
-                               const std::vector<ParameterInfo>& parameters);
+    bool drawImplicitGPU(const std::vector<const PlotEntry*>& entries);
+    std::string buildImplicitFragmentSource(const std::vector<const PlotEntry*>& entries);
+    bool drawExplicitGPU(const PlotEntry& entry);
+    std::string buildExplicitVertexSource(const PlotEntry& entry);
+    QOpenGLShaderProgram* cachedProgram(const std::string& vertSrc, const std::string& fragSrc);
+    QOpenGLShaderProgram* cachedProgram(const std::string& key, const std::string& vertSrc, const std::string& fragSrc);
     void drawAxisLabels();
+    void drawProfilerHud();
 
     // 3D rendering methods
     void initShaders3D();
@@ -70,11 +111,26 @@ private:
     void draw3DAxes();
     void drawSurface3D(const PlotEntry& entry);
     void drawParametric3D(const PlotEntry& entry);
+    void drawPackedMeshes(const PlotEntry& entry);
+    void evictPackedBuffers();
+    void ensure3DBuffers(size_t idx);
+    bool drawSurfaceGPU(const PlotEntry& entry);
+    std::string buildSurfaceVertexSource(const PlotEntry& entry);
+    void ensureSurfaceGrid(int resolution);
+    bool drawImplicit3DGPU(const PlotEntry& entry);
+    std::string buildRaymarchFragmentSource(const PlotEntry& entry);
 
     std::unique_ptr<QOpenGLShaderProgram> lineShader_;
-    std::unique_ptr<QOpenGLShaderProgram> implicitShader_;
     std::unique_ptr<QOpenGLShaderProgram> surface3DShader_;
+    std::unique_ptr<QOpenGLShaderProgram> packedSurfaceShader_;
+    std::unique_ptr<QOpenGLShaderProgram> tubeShader_;
     QOpenGLBuffer quadVBO_;
+    QOpenGLBuffer explicitSampleVBO_;  // 0..kMaxExplicitSamples-1, uploaded once
+    QOpenGLBuffer tubeRingVBO_;        // one ring segment, instanced along curves
+    QOpenGLBuffer surfaceGridVBO_;     // [0,1]^2 grid shared by GPU surfaces
+    QOpenGLBuffer surfaceGridIBO_;
+    int surfaceGridResolution_ = 0;
+    int surfaceGridIndexCount_ = 0;
 
     QOpenGLBuffer gridVBO_;
     QOpenGLBuffer axesVBO_;
@@ -82,6 +138,22 @@ private:
     std::vector<QOpenGLBuffer> plotVBOs_;
     std::vector<QOpenGLBuffer> plot3DVBOs_;
     std::vector<QOpenGLBuffer> plot3DIBOs_;
+    // Set once a slot's vertex arrays are on the GPU; cleared by setPlotEntries
+    std::vector<char> raw3DUploaded_;
+    // Parametric curves: (first point, point count) of each NaN-free run in
+    // the slot's padded vertex buffer
+    std::vector<std::vector<std::pair<int, int>>> curveRuns_;
+    // Packed meshes (Surface3D tiles) by revision. A mesh not drawn in a
+    // frame has scrolled off-screen and its buffers are released.
+    struct PackedBuffers {
+        QOpenGLBuffer vbo{QOpenGLBuffer::VertexBuffer};
+        QOpenGLBuffer ibo{QOpenGLBuffer::IndexBuffer};
+        uint64_t lastFrame = 0;
+    };
+    std::unordered_map<uint64_t, PackedBuffers> packedBuffers_;
+    uint64_t frameCounter_ = 0;
+    uint64_t uploadedBytes_ = 0;
+    bool hudVisible_ = false;
 
     QMatrix4x4 projectionMatrix_;
 
@@ -91,11 +163,53 @@ private:
     double maxScale_ = 10000.0;
 
     bool isDragging_ = false;
+    bool isPanning_ = false;  // 3D: right-drag moves the camera target
     QPointF lastMousePos_;
 
     std::vector<PlotEntry> plotEntries_;
-    std::string lastImplicitGLSL_;
-    Color lastImplicitColor_;
+
+    double precisionMultiplier_ = 1.0;
+
+    // Generated shader programs keyed by their source, evicted LRU.
+    // Color/view/parameters are uniforms so each expression links once.
+    struct CachedProgram {
+        std::unique_ptr<QOpenGLShaderProgram> program; // null if compile failed
+        uint64_t lastUsed = 0;
+    };
+    static constexpr size_t kMaxGeneratedPrograms = 32;
+    // Program sources generated for one entry's expression tree. A recompile
+    // replaces the tree, so the sources are rebuilt only then (or when the
+    // plot type, parameter names or 2D/3D mode change), not on every paint.
+    struct EntryProgram {
+        ExprNodePtr expr;  // held so a freed tree's address is not reused
+        PlotType type = PlotType::ExplicitY;
+        bool is3D = false;
+        uint64_t parameterHash = 0;
+        std::string vertexSource;
+        std::string fragmentSource;
+        std::string key;   // generatedPrograms_ key: vertex + fragment source
+    };
+    const EntryProgram& entryProgram(const PlotEntry& entry);
+    QOpenGLShaderProgram* cachedProgram(const EntryProgram& sources);
+    // A cached null program means these sources already failed to build
+    bool programFailed(const EntryProgram& sources) const;
+    // Implicit functions fused into one full-screen pass (bounded by the
+    // GLES2 fragment uniform budget: one color plus parameters each)
+    static constexpr size_t kMaxFusedImplicit = 16;
+    static constexpr int kMaxExplicitSamples = 16384;
+    static constexpr int kSurfaceGridBase = 500;
+    static constexpr int kMaxSurfaceGrid = 1024;
+    // Vertex budget for all GPU surface tiles of one entry in a frame
+    static constexpr int kMaxSurfaceTileVertices = 4 << 20;
+    // Parametric curve tubes: ring sides and world radius per unit thickness
+    static constexpr int kTubeSides = 12;
+    static constexpr float kTubeRadiusPerThickness = 0.01f;
+    bool instancedTubes_ = false;
+    std::unordered_map<std::string, CachedProgram> generatedPrograms_;
+    // By tree; trees no longer plotted are dropped in setPlotEntries
+    std::unordered_map<const ExprNode*, EntryProgram> entryPrograms_;
+    uint64_t programUseCounter_ = 0;
+    bool fallbackRequested_ = false;
 
     // 3D state
     bool is3DMode_ = false;
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "math/MathTypes.h"
+#include "math/ExpressionEvaluator.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace ArchMaths {
+
+// GLSL语言版本
+enum class GLSLDialect {
+    GLSL100,    // OpenGL ES 2.0 / OpenGL 2.1 (no hyperbolic builtins, no trunc)
+    GLSL300ES   // WebGL 2.0 / OpenGL ES 3.0
+};
+
+// Compiles expression trees to GLSL functions.
+// Every ExpressionEvaluator builtin is covered; functions missing from the
+// target dialect (or with different semantics, e.g. fmod vs GLSL mod) are
+// emitted as am_* helpers. Constant subtrees are folded and repeated
+// subtrees are hoisted into temporaries.
+class GLSLCompiler {
+public:
+    explicit GLSLCompiler(GLSLDialect dialect = GLSLDialect::GLSL100);
+
+    // Emit "float name(float arg0, ...) { prelude; temporaries; return ...; }".
+    // Returns false (and sets the error) if the expression cannot run on the GPU.
+    bool compileFunction(const std::string& name, const ExprNodePtr& expr,
+                         const std::vector<std::string>& argNames,
+                         const std::string& prelude, std::string& out);
+
+    // Helper functions referenced so far; emit once, before the compiled functions
+    std::string helperSource() const;
+
+    const std::string& getError() const { return errorMessage_; }
+    bool hasError() const { return !errorMessage_.empty(); }
+
+    // Quick check: does every function in the tree have a GLSL mapping?
+    static bool isSupported(const ExprNodePtr& expr);
+
+private:
+    enum Helper {
+        HelperTrunc = 1 << 0,
+        HelperFmod  = 1 << 1,
+        HelperRound = 1 << 2,
+        HelperCbrt  = 1 << 3,
+        HelperPow   = 1 << 4,
+        HelperSinh  = 1 << 5,
+        HelperCosh  = 1 << 6,
+        HelperTanh  = 1 << 7,
+        HelperAsinh = 1 << 8,
+        HelperAcosh = 1 << 9,
+        HelperAtanh = 1 << 10
+    };
+
+    // Structurally identical subtrees share an id
+    int intern(const ExprNodePtr& node);
+    std::string emitNode(int id, std::string& statements);
+    std::string emitFunctionCall(const ExprNodePtr& node, const std::vector<std::string>& args);
+    std::string emitPower(int exponentId, const std::string& base,
+                          const std::string& exponent, std::string& statements);
+    bool isConstant(const ExprNodePtr& node) const;
+    void use(Helper helper);
+
+    static std::string formatFloat(double value);
+
+    struct Interned {
+        ExprNodePtr node;
+        std::vector<int> children;
+        int uses = 0;
+        std::string temp;  // assigned once emitted as a temporary
+    };
+
+    GLSLDialect dialect_;
+    unsigned usedHelpers_ = 0;
+    int tempCounter_ = 0;
+    std::string errorMessage_;
+
+    std::unordered_map<std::string, int> keyToId_;
+    std::vector<Interned> interned_;
+    ExpressionEvaluator folder_;
+};
+
+} // namespace ArchMaths
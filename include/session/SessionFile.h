@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "math/MathTypes.h"
+#include "mesh/MeshCache.h"
+
+namespace ArchMaths {
+
+// 保存的视图: 2D平移缩放、3D相机与精度
+struct SessionView {
+    double offsetX = 0.0;
+    double offsetY = 0.0;
+    double scale = 50.0;
+    double precision = 1.0;
+    bool mode3D = false;
+    float yaw = 45.0f;
+    float pitch = 30.0f;
+    float distance = 8.0f;
+    float target[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// An entry as the user wrote it; user functions ("f(x) = ...") are entries
+struct SessionEntry {
+    std::string expression;
+    Color color;
+    float thickness = 3.0f;
+    bool visible = true;
+    std::vector<ParameterInfo> parameters;
+};
+
+// Geometry under its MeshCache key, which hashes everything the geometry
+// was computed from
+struct SessionGeometry {
+    uint64_t key = 0;
+    std::shared_ptr<const CachedGeometry> geometry;
+};
+
+struct Session {
+    SessionView view;
+    std::vector<std::pair<std::string, double>> variables;
+    std::vector<SessionEntry> entries;
+    std::vector<SessionGeometry> geometry;
+};
+
+// Compact binary session file (.amss).
+//
+// A 16-byte header (magic "AMSS", version, section count) and tagged
+// sections, each a 16-byte header (tag, item count, byte length) and a
+// payload padded to 8 bytes: VIEW, VARS, ENTR and the optional GEOM.
+// Unknown sections are skipped. Every geometry record carries a checksum of
+// its bytes; a damaged record is dropped and recomputed instead. Values are
+// stored in host (little-endian) byte order.
+class SessionFile {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    static bool write(const std::string& path, const Session& session);
+
+    // Parses a file already in memory (typically mapped). Fails only if the
+    // header or a non-geometry section is malformed.
+    static bool read(const unsigned char* data, size_t size, Session& session, std::string& error);
+};
+
+} // namespace ArchMaths
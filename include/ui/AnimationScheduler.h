@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QString>
+#include <utility>
+#include <vector>
+
+class QTimer;
+
+namespace ArchMaths {
+
+// 参数动画调度: 所有正在播放的参数由同一个时钟驱动.
+// 时间量化为帧序号, 同一帧序号总是给出相同的参数值, 所以未来的帧可以提前计算
+class AnimationScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int kFrameIntervalMs = 33;  // ~30 FPS
+
+    explicit AnimationScheduler(QObject* parent = nullptr);
+
+    // Sweep a parameter over [minValue, maxValue], continuing from its current value
+    void play(int entry, const QString& name, double value, double minValue, double maxValue);
+    void stop(int entry, const QString& name);
+    // The entry was re-parsed; its sliders are rebuilt stopped
+    void stopEntry(int entry);
+    // The entry was deleted; later entries move down by one
+    void removeEntry(int entry);
+    void clear();
+
+    bool isAnimating(int entry) const;
+    // Entries with at least one playing parameter, ascending
+    std::vector<int> animatedEntries() const;
+    // Values of the entry's playing parameters at a frame
+    std::vector<std::pair<QString, double>> valuesAt(int entry, qint64 frame) const;
+
+signals:
+    // 时钟进入新的一帧 (程序卡顿时会跳过帧号)
+    void frame(qint64 frame);
+
+private slots:
+    void onTick();
+
+private:
+    struct Track {
+        int entry;
+        QString name;
+        double minValue;
+        double maxValue;
+        double phase;       // sine phase at startFrame
+        qint64 startFrame;
+    };
+
+    static double valueAt(const Track& track, qint64 frame);
+    void stopTimerIfIdle();
+
+    QTimer* timer_;
+    QElapsedTimer clock_;
+    std::vector<Track> tracks_;
+    qint64 frame_ = 0;
+};
+
+} // namespace ArchMaths
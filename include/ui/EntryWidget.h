@@ -22,6 +22,8 @@ public:
 
     void setEntry(const PlotEntry& entry);
     int getIndex() const { return index_; }
+    // Show an animated value without emitting parameterChanged
+    void setParameterValue(const QString& name, double value);
     void setIndex(int index) { index_ = index; }
 
 signals:
@@ -30,6 +32,7 @@ signals:
     void visibilityChanged(int index, bool visible);
     void colorClicked(int index, const Color& color);
     void parameterChanged(int index, const QString& name, double value);
+    void parameterPlayToggled(int index, const QString& name, bool playing, double minVal, double maxVal);
 
 private slots:
     void onExpressionEdited();
@@ -37,6 +40,7 @@ private slots:
     void onVisibilityToggled();
     void onColorClicked();
     void onParameterValueChanged(const QString& name, double value);
+    void onParameterPlayToggled(const QString& name, bool playing, double minVal, double maxVal);
 
 private:
     void setupUI();
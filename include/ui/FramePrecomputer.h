@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "math/MathTypes.h"
+
+namespace ArchMaths {
+
+// 一帧的CPU曲线数据 (屏幕坐标折线)
+struct PlotFrame {
+    std::vector<float> vertices;
+    std::vector<Point2D> plotPoints;
+};
+
+// 动画帧的后台预计算: 一个工作线程按提交顺序计算未来帧.
+// 条目的数据作废时 (视图、表达式或精度改变), 它排队中和已完成的帧一并丢弃
+class FramePrecomputer {
+public:
+    using Job = std::function<void(PlotFrame&)>;
+
+    FramePrecomputer();
+    ~FramePrecomputer();
+
+    FramePrecomputer(const FramePrecomputer&) = delete;
+    FramePrecomputer& operator=(const FramePrecomputer&) = delete;
+
+    // Queue a frame; the job runs on the worker thread and must only read
+    // state it captured or that is immutable
+    void request(int entry, int64_t frame, Job job);
+    // Queued, running or finished
+    bool isRequested(int entry, int64_t frame) const;
+    // Move a finished frame out; false if it is not ready
+    bool take(int entry, int64_t frame, PlotFrame& out);
+    // Drop the entry's frames before `frame` (shown or skipped)
+    void discardBefore(int entry, int64_t frame);
+    void discard(int entry);
+    void clear();
+
+private:
+    struct Task {
+        int entry;
+        int64_t frame;
+        uint64_t generation;
+        Job job;
+    };
+    struct EntryFrames {
+        uint64_t generation = 0;  // a discarded entry never matches old tasks
+        std::set<int64_t> pending;
+        std::map<int64_t, PlotFrame> done;
+    };
+
+    void run();
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Task> queue_;
+    std::map<int, EntryFrames> entries_;
+    uint64_t nextGeneration_ = 1;
+    bool quit_ = false;
+    std::thread worker_;
+};
+
+} // namespace ArchMaths
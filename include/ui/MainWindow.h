@@ -4,15 +4,23 @@
 #include <QMainWindow>
 #include <QSplitter>
 #include <memory>
-#include <set>
 #include "rendering/GLCanvas.h"
-#include "math/ExpressionParser.h"
 #include "math/ExpressionEvaluator.h"
 #include "math/MathTypes.h"
+#include "math/PlotCompiler.h"
+#include "math/PlotSampler.h"
+#include "mesh/OctreeMesher.h"
+#include "mesh/MeshCache.h"
+#include "ui/FramePrecomputer.h"
+
+class QAction;
+class QTimer;
 
 namespace ArchMaths {
 
 class SidePanel;
+class AnimationScheduler;
+class ReplayDriver;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -27,31 +35,43 @@ private slots:
     void onEntryDeleted(int index);
     void onViewChanged(QPointF offset, double scale);
     void onParameterChanged(int index, const QString& name, double value);
+    void onParameterPlayToggled(int index, const QString& name, bool playing, double minVal, double maxVal);
+    void onAnimationFrame(qint64 frame);
     void onEntryVisibilityChanged(int index, bool visible);
     void onEntryColorChanged(int index, const Color& color);
     void recalculateAll();
+    void refreshPlotData();
+    void onCameraSettled();
 
 private:
+    // 回放工具调用与界面信号相同的槽
+    friend class ReplayDriver;
+
     void setupUI();
     void setupMenuBar();
     void setupToolBar();
     void connectSignals();
 
-    void parseAndCompileEntry(PlotEntry& entry);
+    // 会话文件 (.amss)
+    void clearSession();
+    bool saveSession(const QString& path, QString& error);
+    bool loadSession(const QString& path, QString& error);
+
+    void ensurePlotData(PlotEntry& entry);
+    int entryIndex(const PlotEntry& entry) const { return static_cast<int>(&entry - entries_.data()); }
+    // Profiler counters for the entry's new plot data
+    void countPlotWork(const PlotEntry& entry, uint64_t evaluationsBefore);
     void calculatePlotData(PlotEntry& entry);
+    // 2D视图快照; 后台计算的帧使用提交时的视图
+    PlotView currentView() const;
+    void requestAnimationFrames(int index, qint64 frame);
     void calculatePlotData3D(PlotEntry& entry);
-    void extractParameters(PlotEntry& entry);
-    void collectVariables(const ExprNodePtr& node, std::set<std::string>& vars);
-    bool containsVariable(const ExprNodePtr& node, const std::string& varName);
-
-    // 3D mesh generation
-    void generateSurfaceMesh(PlotEntry& entry, const std::vector<std::vector<double>>& zGrid,
-                             const std::vector<double>& xVals, const std::vector<double>& yVals);
-    void generateImplicit3DMesh(PlotEntry& entry, const std::vector<double>& field,
-                                int nx, int ny, int nz,
-                                double xMin, double xMax,
-                                double yMin, double yMax,
-                                double zMin, double zMax);
+    uint64_t functionKey(const PlotEntry& entry) const;
+    uint64_t geometryKey(const PlotEntry& entry) const;
+    bool streamSurfaceChunks(PlotEntry& entry);
+    double simplifyErrorPerDistance() const;
+    void meshImplicit3D(PlotEntry& entry);
+    OctreeMeshSettings implicitMeshSettings() const;
 
     // UI components
     QSplitter* splitter_;
@@ -59,14 +79,29 @@ private:
     SidePanel* sidePanel_;
 
     // Math engine
-    std::unique_ptr<ExpressionParser> parser_;
+    PlotCompiler compiler_;
     std::unique_ptr<ExpressionEvaluator> evaluator_;
-    UserFunctionRegistry userFunctions_;
+    // Reads no mutable members, so animation frames run it on the precompute thread
+    PlotSampler sampler_;
 
     // Data
     std::vector<PlotEntry> entries_;
     VariableContext variables_;
     double precisionMultiplier_ = 1.0;
+    bool simplifyMeshes_ = true;
+    // Sessions carry the computed 3D geometry, so reopening skips the meshing
+    bool saveGeometry_ = true;
+    QString sessionPath_;
+    QAction* toggle3DAction_ = nullptr;
+    // 所有条目共享的几何缓存
+    MeshCache meshCache_;
+
+    // Coalesces camera moves before view-dependent meshes are rebuilt
+    QTimer* remeshTimer_ = nullptr;
+
+    // 参数动画: 统一时钟与CPU曲线的前瞻帧 (析构时先于 evaluator_ 停止)
+    AnimationScheduler* animator_ = nullptr;
+    FramePrecomputer framePrecomputer_;
 
 public slots:
     void setPrecisionMultiplier(double multiplier);
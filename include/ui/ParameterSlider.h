@@ -5,7 +5,6 @@
 #include <QLabel>
 #include <QDoubleSpinBox>
 #include <QPushButton>
-#include <QTimer>
 #include <QString>
 
 namespace ArchMaths {
@@ -25,12 +24,13 @@ public:
 
 signals:
     void valueChanged(const QString& name, double value);
+    // 播放/暂停; 动画由 AnimationScheduler 统一驱动, 数值经 setValue 回显
+    void playToggled(const QString& name, bool playing, double minVal, double maxVal);
 
 private slots:
     void onSliderChanged(int val);
     void onSpinBoxChanged(double val);
     void onPlayClicked();
-    void onAnimationTick();
 
 private:
     void setupUI();
@@ -41,13 +41,11 @@ private:
     double minVal_;
     double maxVal_;
     bool playing_ = false;
-    double animPhase_ = 0.0;
 
     QLabel* nameLabel_;
     QSlider* slider_;
     QDoubleSpinBox* spinBox_;
     QPushButton* playBtn_;
-    QTimer* animTimer_;
 };
 
 } // namespace ArchMaths
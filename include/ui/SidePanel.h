@@ -23,6 +23,10 @@ public:
     void addEntry(const PlotEntry& entry);
     void updateEntry(int index, const PlotEntry& entry);
     void removeEntry(int index);
+    // Show an animated parameter value on its slider
+    void setParameterValue(int index, const QString& name, double value);
+    // Show a precision set elsewhere (a loaded session) without emitting precisionChanged
+    void setPrecision(double multiplier);
     void clear();
 
 signals:
@@ -31,6 +35,7 @@ signals:
     void entryVisibilityChanged(int index, bool visible);
     void entryColorChanged(int index, const Color& color);
     void entryParameterChanged(int index, const QString& name, double value);
+    void entryParameterPlayToggled(int index, const QString& name, bool playing, double minVal, double maxVal);
     void addEntryRequested();
     void precisionChanged(double multiplier);
 
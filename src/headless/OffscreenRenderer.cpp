@@ -0,0 +1,349 @@
+#include "headless/OffscreenRenderer.h"
+#include <QFont>
+#include <QPainter>
+#include <QRectF>
+#include <algorithm>
+#include <cmath>
+
+namespace ArchMaths {
+
+QSurfaceFormat OffscreenRenderer::surfaceFormat() {
+    QSurfaceFormat format;
+    format.setDepthBufferSize(24);
+    return format;
+}
+
+OffscreenRenderer::OffscreenRenderer(QOffscreenSurface* surface)
+    : surface_(surface)
+{
+}
+
+OffscreenRenderer::~OffscreenRenderer() {
+    // GL objects belong to the context and are freed while it is current
+    if (context_ && context_->makeCurrent(surface_)) {
+        fbo_.reset();
+        lineShader_.reset();
+        meshShader_.reset();
+        vertexBuffer_.destroy();
+        indexBuffer_.destroy();
+        vao_.destroy();
+        context_->doneCurrent();
+    }
+}
+
+bool OffscreenRenderer::initialize(QString& error) {
+    context_ = std::make_unique<QOpenGLContext>();
+    context_->setFormat(surfaceFormat());
+    if (!context_->create()) {
+        error = "cannot create an OpenGL context";
+        return false;
+    }
+    if (!context_->makeCurrent(surface_)) {
+        error = "cannot make the OpenGL context current on the offscreen surface";
+        return false;
+    }
+    gl_ = context_->functions();
+
+    initShaders();
+    if (!lineShader_->isLinked() || !meshShader_->isLinked()) {
+        error = lineShader_->log() + meshShader_->log();
+        context_->doneCurrent();
+        return false;
+    }
+    vao_.create();
+    vertexBuffer_.create();
+    indexBuffer_.create();
+    context_->doneCurrent();
+    return true;
+}
+
+void OffscreenRenderer::initShaders() {
+    // Same shading as the canvas (OpenGL ES 2.0 / OpenGL 2.1 compatible)
+    const char* lineVertSrc = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+attribute vec3 aPos;
+uniform mat4 projection;
+void main() {
+    gl_Position = projection * vec4(aPos, 1.0);
+}
+)";
+
+    const char* lineFragSrc = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform vec4 color;
+void main() {
+    gl_FragColor = color;
+}
+)";
+
+    const char* meshVertSrc = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec3 aPos;
+attribute vec3 aNormal;
+uniform mat4 mvp;
+varying vec3 vNormal;
+void main() {
+    vNormal = aNormal;
+    gl_Position = mvp * vec4(aPos, 1.0);
+}
+)";
+
+    const char* meshFragSrc = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+uniform vec4 color;
+uniform vec3 lightDir;
+varying vec3 vNormal;
+void main() {
+    vec3 norm = normalize(vNormal);
+    float diff = abs(dot(norm, normalize(lightDir)));
+    float ambient = 0.3;
+    float lighting = ambient + (1.0 - ambient) * diff;
+    gl_FragColor = vec4(color.rgb * lighting, color.a);
+}
+)";
+
+    lineShader_ = std::make_unique<QOpenGLShaderProgram>();
+    lineShader_->addShaderFromSourceCode(QOpenGLShader::Vertex, lineVertSrc);
+    lineShader_->addShaderFromSourceCode(QOpenGLShader::Fragment, lineFragSrc);
+    lineShader_->bindAttributeLocation("aPos", 0);
+    lineShader_->link();
+
+    meshShader_ = std::make_unique<QOpenGLShaderProgram>();
+    meshShader_->addShaderFromSourceCode(QOpenGLShader::Vertex, meshVertSrc);
+    meshShader_->addShaderFromSourceCode(QOpenGLShader::Fragment, meshFragSrc);
+    meshShader_->bindAttributeLocation("aPos", 0);
+    meshShader_->bindAttributeLocation("aNormal", 1);
+    meshShader_->link();
+}
+
+QImage OffscreenRenderer::render(const Scene& scene, const std::vector<PlotEntry>& entries) {
+    if (!context_ || !context_->makeCurrent(surface_)) return QImage();
+
+    int tileWidth = std::min(scene.width, kMaxTileSize);
+    int tileHeight = std::min(scene.height, kMaxTileSize);
+    if (!fbo_ || fbo_->width() != tileWidth || fbo_->height() != tileHeight) {
+        QOpenGLFramebufferObjectFormat format;
+        format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+        format.setSamples(kSamples);
+        fbo_ = std::make_unique<QOpenGLFramebufferObject>(tileWidth, tileHeight, format);
+    }
+
+    QImage image(scene.width, scene.height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    for (int y0 = 0; y0 < scene.height; y0 += tileHeight) {
+        for (int x0 = 0; x0 < scene.width; x0 += tileWidth) {
+            // Stretches the tile's part of clip space over the whole viewport
+            QMatrix4x4 tile;
+            tile.scale(static_cast<float>(scene.width) / tileWidth, static_cast<float>(scene.height) / tileHeight, 1.0f);
+            tile.translate(1.0f - (2.0f * x0 + tileWidth) / scene.width,
+                           (2.0f * y0 + tileHeight) / scene.height - 1.0f, 0.0f);
+
+            fbo_->bind();
+            gl_->glViewport(0, 0, tileWidth, tileHeight);
+            drawTile(scene, entries, tile);
+            fbo_->release();
+            // Resolves the multisampled buffer
+            painter.drawImage(x0, y0, fbo_->toImage());
+        }
+    }
+    painter.end();
+    context_->doneCurrent();
+
+    if (!scene.mode3D) drawAxisLabels(image, scene);
+    return image;
+}
+
+void OffscreenRenderer::drawTile(const Scene& scene, const std::vector<PlotEntry>& entries, const QMatrix4x4& tileMatrix) {
+    gl_->glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    gl_->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gl_->glEnable(GL_BLEND);
+    gl_->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    vao_.bind();
+
+    if (!scene.mode3D) {
+        projection_ = tileMatrix;
+        projection_.ortho(0.0f, static_cast<float>(scene.width), static_cast<float>(scene.height), 0.0f, -1.0f, 1.0f);
+        drawGrid(scene);
+        for (const auto& entry : entries) {
+            if (!entry.visible || entry.hasError || entry.vertices.empty()) continue;
+            float r, g, b;
+            entry.color.toRGB(r, g, b);
+            drawLines(entry.vertices, 2, QVector4D(r, g, b, 1.0f), entry.thickness, GL_LINE_STRIP);
+        }
+    } else {
+        projection_ = tileMatrix * scene.viewProjection();
+        gl_->glEnable(GL_DEPTH_TEST);
+
+        const std::vector<float> axes[3] = {{-5, 0, 0, 5, 0, 0}, {0, -5, 0, 0, 5, 0}, {0, 0, -5, 0, 0, 5}};
+        const QVector4D axisColors[3] = {QVector4D(0.8f, 0.2f, 0.2f, 1.0f), QVector4D(0.2f, 0.8f, 0.2f, 1.0f),
+                                         QVector4D(0.2f, 0.2f, 0.8f, 1.0f)};
+        for (int a = 0; a < 3; ++a) drawLines(axes[a], 3, axisColors[a], 2.0f, GL_LINES);
+
+        for (const auto& entry : entries) {
+            if (!entry.visible || entry.hasError || entry.vertices3D.empty()) continue;
+            if (entry.plotType == PlotType::Parametric3D) {
+                float r, g, b;
+                entry.color.toRGB(r, g, b);
+                drawLines(entry.vertices3D, 3, QVector4D(r, g, b, 1.0f), entry.thickness, GL_LINE_STRIP);
+            } else if (!entry.indices3D.empty()) {
+                drawMesh(entry);
+            }
+        }
+        gl_->glDisable(GL_DEPTH_TEST);
+    }
+    vao_.release();
+}
+
+void OffscreenRenderer::drawGrid(const Scene& scene) {
+    PlotView view = scene.plotView();
+    float w = static_cast<float>(scene.width);
+    float h = static_cast<float>(scene.height);
+    double gridStep = scene.gridStep();
+
+    std::vector<float> grid;
+    double startX = std::floor((0 - view.offsetX) / view.scale / gridStep) * gridStep;
+    double endX = std::ceil((w - view.offsetX) / view.scale / gridStep) * gridStep;
+    for (double x = startX; x <= endX; x += gridStep) {
+        float screenX = static_cast<float>(view.offsetX + x * view.scale);
+        grid.insert(grid.end(), {screenX, 0.0f, screenX, h});
+    }
+    double startY = std::floor((view.offsetY - h) / view.scale / gridStep) * gridStep;
+    double endY = std::ceil(view.offsetY / view.scale / gridStep) * gridStep;
+    for (double y = startY; y <= endY; y += gridStep) {
+        float screenY = static_cast<float>(view.offsetY - y * view.scale);
+        grid.insert(grid.end(), {0.0f, screenY, w, screenY});
+    }
+    drawLines(grid, 2, QVector4D(0.9f, 0.9f, 0.9f, 1.0f), 1.0f, GL_LINES);
+
+    std::vector<float> axes;
+    float yAxis = static_cast<float>(view.offsetY);
+    if (yAxis >= 0 && yAxis <= h) axes.insert(axes.end(), {0.0f, yAxis, w, yAxis});
+    float xAxis = static_cast<float>(view.offsetX);
+    if (xAxis >= 0 && xAxis <= w) axes.insert(axes.end(), {xAxis, 0.0f, xAxis, h});
+    drawLines(axes, 2, QVector4D(0.3f, 0.3f, 0.3f, 1.0f), 2.0f, GL_LINES);
+}
+
+void OffscreenRenderer::drawLines(const std::vector<float>& vertices, int components, const QVector4D& color,
+                                  float width, GLenum mode) {
+    std::vector<float> clean;
+    std::vector<std::pair<int, int>> runs;
+    if (mode == GL_LINES) {
+        clean = vertices;
+        runs.emplace_back(0, static_cast<int>(vertices.size() / components));
+    } else {
+        // Filter out NaN values and split into strips
+        clean.reserve(vertices.size());
+        int runStart = 0;
+        for (size_t j = 0; j + components <= vertices.size(); j += components) {
+            bool finite = true;
+            for (int c = 0; c < components; ++c) finite = finite && std::isfinite(vertices[j + c]);
+            if (finite) {
+                clean.insert(clean.end(), vertices.begin() + j, vertices.begin() + j + components);
+                continue;
+            }
+            int end = static_cast<int>(clean.size()) / components;
+            if (end - runStart > 1) runs.emplace_back(runStart, end - runStart);
+            runStart = end;
+        }
+        int end = static_cast<int>(clean.size()) / components;
+        if (end - runStart > 1) runs.emplace_back(runStart, end - runStart);
+    }
+    if (runs.empty() || clean.empty()) return;
+
+    lineShader_->bind();
+    lineShader_->setUniformValue("projection", projection_);
+    lineShader_->setUniformValue("color", color);
+
+    vertexBuffer_.bind();
+    vertexBuffer_.allocate(clean.data(), static_cast<int>(clean.size() * sizeof(float)));
+    gl_->glEnableVertexAttribArray(0);
+    gl_->glVertexAttribPointer(0, components, GL_FLOAT, GL_FALSE, components * sizeof(float), nullptr);
+    gl_->glLineWidth(width);
+    for (const auto& run : runs) {
+        gl_->glDrawArrays(mode, run.first, run.second);
+    }
+    gl_->glDisableVertexAttribArray(0);
+    vertexBuffer_.release();
+    lineShader_->release();
+}
+
+void OffscreenRenderer::drawMesh(const PlotEntry& entry) {
+    float r, g, b;
+    entry.color.toRGB(r, g, b);
+    meshShader_->bind();
+    meshShader_->setUniformValue("mvp", projection_);
+    meshShader_->setUniformValue("lightDir", QVector3D(1.0f, 1.0f, 1.0f));
+    meshShader_->setUniformValue("color", QVector4D(r, g, b, 0.9f));
+
+    vertexBuffer_.bind();
+    vertexBuffer_.allocate(entry.vertices3D.data(), static_cast<int>(entry.vertices3D.size() * sizeof(float)));
+    gl_->glEnableVertexAttribArray(0);
+    gl_->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
+    gl_->glEnableVertexAttribArray(1);
+    gl_->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(float)));
+
+    indexBuffer_.bind();
+    indexBuffer_.allocate(entry.indices3D.data(), static_cast<int>(entry.indices3D.size() * sizeof(unsigned int)));
+    gl_->glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(entry.indices3D.size()), GL_UNSIGNED_INT, nullptr);
+    indexBuffer_.release();
+
+    gl_->glDisableVertexAttribArray(0);
+    gl_->glDisableVertexAttribArray(1);
+    vertexBuffer_.release();
+    meshShader_->release();
+}
+
+void OffscreenRenderer::drawAxisLabels(QImage& image, const Scene& scene) {
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QColor(80, 80, 80));
+    painter.setFont(QFont("Sans", 9));
+
+    PlotView view = scene.plotView();
+    float w = static_cast<float>(scene.width);
+    float h = static_cast<float>(scene.height);
+    double gridStep = scene.gridStep();
+    auto label = [](double v) {
+        if (std::abs(v - std::round(v)) < 0.0001) return QString::number(static_cast<int>(std::round(v)));
+        return QString::number(v, 'g', 4);
+    };
+
+    // X-axis labels
+    float yAxis = static_cast<float>(view.offsetY);
+    if (yAxis >= 0 && yAxis <= h) {
+        double startX = std::floor((0 - view.offsetX) / view.scale / gridStep) * gridStep;
+        double endX = std::ceil((w - view.offsetX) / view.scale / gridStep) * gridStep;
+        for (double x = startX; x <= endX; x += gridStep) {
+            if (std::abs(x) < gridStep * 0.01) continue; // Skip origin
+            float screenX = static_cast<float>(view.offsetX + x * view.scale);
+            painter.drawLine(QPointF(screenX, yAxis - 3), QPointF(screenX, yAxis + 3));
+            painter.drawText(QRectF(screenX - 20, yAxis + 5, 40, 15), Qt::AlignCenter, label(x));
+        }
+    }
+
+    // Y-axis labels
+    float xAxis = static_cast<float>(view.offsetX);
+    if (xAxis >= 0 && xAxis <= w) {
+        double startY = std::floor((view.offsetY - h) / view.scale / gridStep) * gridStep;
+        double endY = std::ceil(view.offsetY / view.scale / gridStep) * gridStep;
+        for (double y = startY; y <= endY; y += gridStep) {
+            if (std::abs(y) < gridStep * 0.01) continue; // Skip origin
+            float screenY = static_cast<float>(view.offsetY - y * view.scale);
+            painter.drawLine(QPointF(xAxis - 3, screenY), QPointF(xAxis + 3, screenY));
+            painter.drawText(QRectF(xAxis - 35, screenY - 8, 30, 16), Qt::AlignRight | Qt::AlignVCenter, label(y));
+        }
+    }
+
+    painter.end();
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,167 @@
+#include "headless/Scene.h"
+#include <QColor>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <algorithm>
+#include <cmath>
+
+namespace ArchMaths {
+
+PlotView Scene::plotView() const {
+    PlotView view;
+    view.scale = scale;
+    view.offsetX = 0.5 * width - center[0] * scale;
+    view.offsetY = 0.5 * height + center[1] * scale;
+    view.width = width;
+    view.height = height;
+    view.precision = precision;
+    return view;
+}
+
+double Scene::gridStep() const {
+    double step = 1.0;
+    while (step * scale < 50) step *= 2;
+    while (step * scale > 200) step /= 2;
+    return step;
+}
+
+void Scene::cameraEye(double eye[3]) const {
+    double yawRad = yaw * M_PI / 180.0;
+    double pitchRad = pitch * M_PI / 180.0;
+    eye[0] = target[0] + distance * std::cos(pitchRad) * std::sin(yawRad);
+    eye[1] = target[1] + distance * std::sin(pitchRad);
+    eye[2] = target[2] + distance * std::cos(pitchRad) * std::cos(yawRad);
+}
+
+QMatrix4x4 Scene::viewProjection() const {
+    double eye[3];
+    cameraEye(eye);
+    QMatrix4x4 projection;
+    projection.perspective(45.0f, static_cast<float>(width) / static_cast<float>(height), 0.1f, 100.0f);
+    QMatrix4x4 view;
+    view.lookAt(QVector3D(eye[0], eye[1], eye[2]), QVector3D(target[0], target[1], target[2]), QVector3D(0, 1, 0));
+    return projection * view;
+}
+
+namespace {
+
+// 与界面新建条目相同的调色板
+Color paletteColor(size_t index) {
+    return Color{static_cast<float>(std::fmod(index * 137.5, 360.0)), 100.0f, 85.0f, 1.0f};
+}
+
+bool parseEntry(const QJsonValue& value, size_t index, SceneEntry& entry, QString& error) {
+    entry.color = paletteColor(index);
+    if (value.isString()) {
+        entry.expression = value.toString().toUtf8().constData();
+        return true;
+    }
+    if (!value.isObject()) {
+        error = QString("entry %1: expected a string or an object").arg(static_cast<int>(index));
+        return false;
+    }
+
+    QJsonObject object = value.toObject();
+    entry.expression = object.value("expression").toString().toUtf8().constData();
+    entry.thickness = static_cast<float>(object.value("thickness").toDouble(entry.thickness));
+    entry.visible = object.value("visible").toBool(entry.visible);
+    if (object.contains("color")) {
+        QColor color(object.value("color").toString());
+        if (!color.isValid()) {
+            error = QString("entry %1: invalid color").arg(static_cast<int>(index));
+            return false;
+        }
+        int h, s, v;
+        color.getHsv(&h, &s, &v);
+        entry.color.h = static_cast<float>(std::max(h, 0));
+        entry.color.s = static_cast<float>(s) / 255.0f * 100.0f;
+        entry.color.b = static_cast<float>(v) / 255.0f * 100.0f;
+    }
+    QJsonObject parameters = object.value("parameters").toObject();
+    for (auto it = parameters.begin(); it != parameters.end(); ++it) {
+        entry.parameters[it.key().toUtf8().constData()] = it.value().toDouble(1.0);
+    }
+    return true;
+}
+
+bool parseScene(const QJsonObject& object, const QDir& base, size_t index, Scene& scene, QString& error) {
+    QString output = object.value("output").toString();
+    if (output.isEmpty()) output = QString("figure_%1.png").arg(static_cast<int>(index));
+    scene.output = base.filePath(output);
+
+    scene.width = object.value("width").toInt(scene.width);
+    scene.height = object.value("height").toInt(scene.height);
+    if (scene.width < 1 || scene.height < 1) {
+        error = QString("scene %1: invalid size").arg(static_cast<int>(index));
+        return false;
+    }
+    scene.mode3D = object.value("mode").toString() == "3d";
+    scene.precision = std::clamp(object.value("precision").toDouble(scene.precision), 0.1, 4.0);
+
+    QJsonArray center = object.value("center").toArray();
+    for (int a = 0; a < 2 && a < center.size(); ++a) scene.center[a] = center.at(a).toDouble();
+    scene.scale = object.value("scale").toDouble(scene.scale);
+    if (!(scene.scale > 0.0)) {
+        error = QString("scene %1: scale must be positive").arg(static_cast<int>(index));
+        return false;
+    }
+
+    QJsonObject camera = object.value("camera").toObject();
+    scene.yaw = camera.value("yaw").toDouble(scene.yaw);
+    scene.pitch = std::clamp(camera.value("pitch").toDouble(scene.pitch), -89.0, 89.0);
+    scene.distance = std::clamp(camera.value("distance").toDouble(scene.distance), 2.0, 50.0);
+    QJsonArray target = camera.value("target").toArray();
+    for (int a = 0; a < 3 && a < target.size(); ++a) scene.target[a] = target.at(a).toDouble();
+
+    QJsonArray entries = object.value("entries").toArray();
+    scene.entries.resize(entries.size());
+    for (int i = 0; i < entries.size(); ++i) {
+        if (!parseEntry(entries.at(i), i, scene.entries[i], error)) {
+            error = QString("scene %1, %2").arg(static_cast<int>(index)).arg(error);
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool loadScenes(const QString& path, std::vector<Scene>& scenes, QString& error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (document.isNull()) {
+        error = parseError.errorString();
+        return false;
+    }
+
+    QDir base = QFileInfo(path).absoluteDir();
+    QJsonArray list;
+    if (document.isArray()) {
+        list = document.array();
+    } else {
+        list.append(document.object());
+    }
+
+    scenes.clear();
+    scenes.resize(list.size());
+    for (int i = 0; i < list.size(); ++i) {
+        if (!list.at(i).isObject()) {
+            error = QString("scene %1: expected an object").arg(i);
+            return false;
+        }
+        if (!parseScene(list.at(i).toObject(), base, i, scenes[i], error)) return false;
+    }
+    return true;
+}
+
+} // namespace ArchMaths
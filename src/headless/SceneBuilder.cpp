@@ -0,0 +1,125 @@
+#include "headless/SceneBuilder.h"
+#include "mesh/ChunkGrid.h"
+#include "mesh/OctreeMesher.h"
+#include "mesh/SurfaceMesh.h"
+#include <algorithm>
+
+namespace ArchMaths {
+
+SceneBuilder::SceneBuilder()
+    : sampler_(evaluator_)
+{
+}
+
+std::vector<PlotEntry> SceneBuilder::build(const Scene& scene) {
+    std::vector<PlotEntry> entries(scene.entries.size());
+    VariableContext vars;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const SceneEntry& source = scene.entries[i];
+        entries[i].expression = source.expression;
+        entries[i].color = source.color;
+        entries[i].thickness = source.thickness;
+        entries[i].visible = source.visible;
+        // 参数与界面一样是全局的
+        for (const auto& [name, value] : source.parameters) vars[name] = value;
+    }
+
+    // All entries are parsed first, so every parameter has its value
+    // before anything is evaluated
+    compiler_.defineFunctions(entries);
+    for (auto& entry : entries) {
+        try {
+            compiler_.compile(entry);
+            if (!entry.hasError && entry.compiledExpr) PlotCompiler::extractParameters(entry, vars);
+        } catch (const std::exception& e) {
+            entry.hasError = true;
+            entry.errorMessage = e.what();
+            entry.compiledExpr = nullptr;
+        }
+    }
+
+    PlotView view = scene.plotView();
+    for (auto& entry : entries) {
+        if (entry.hasError || !entry.compiledExpr || !entry.visible) continue;
+
+        bool is3DType = entry.plotType == PlotType::Surface3D || entry.plotType == PlotType::Implicit3D ||
+                        entry.plotType == PlotType::Parametric3D;
+        if (!scene.mode3D) {
+            if (entry.plotType == PlotType::Implicit3D) {
+                // 与画布一样, 2D模式绘制 z = 0 截面
+                VariableContext slice = vars;
+                slice["z"] = 0.0;
+                entry.plotType = PlotType::Implicit;
+                sampler_.samplePolyline(entry, view, slice);
+                entry.plotType = PlotType::Implicit3D;
+            } else if (!is3DType) {
+                sampler_.samplePolyline(entry, view, vars);
+            }
+        } else if (entry.plotType == PlotType::Surface3D) {
+            buildSurface(entry, scene, vars);
+        } else if (entry.plotType == PlotType::Implicit3D) {
+            buildImplicit3D(entry, scene, vars);
+        } else if (entry.plotType == PlotType::Parametric3D) {
+            int samples = static_cast<int>(PlotSampler::kParametric3DSamples * scene.precision);
+            sampler_.sampleCurve3D(entry, samples, vars, entry.vertices3D);
+        }
+    }
+    return entries;
+}
+
+void SceneBuilder::buildSurface(PlotEntry& entry, const Scene& scene, const VariableContext& vars) {
+    // The tiles the canvas would stream for this camera, at full resolution
+    QMatrix4x4 viewProj = scene.viewProjection();
+    ChunkView chunkView;
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 4; ++col) chunkView.viewProj[row * 4 + col] = viewProj(row, col);
+    }
+    std::copy(scene.target, scene.target + 3, chunkView.target);
+    chunkView.radius = std::clamp(3.0 * scene.distance, kSurfaceChunkSize, 90.0);
+
+    int resolution = std::max(2, static_cast<int>(50 * scene.precision));
+    double step = kSurfaceChunkSize / resolution;
+    IndexedMesh tile;
+    for (ChunkCoord coord : visibleChunks(chunkView, kSurfaceChunkSize, kMaxSurfaceChunks)) {
+        std::vector<double> xVals, yVals;
+        for (int k = -1; k <= resolution + 1; ++k) {
+            xVals.push_back((coord.i * resolution + k) * step);
+            yVals.push_back((coord.j * resolution + k) * step);
+        }
+        std::vector<std::vector<double>> zGrid;
+        evaluator_.evaluateGrid(entry.compiledExpr, xVals, yVals, zGrid, vars);
+
+        tile.clear();
+        SurfaceMesh::triangulate(zGrid, xVals, yVals, 1, tile);
+        auto base = static_cast<unsigned int>(entry.vertices3D.size() / 6);
+        entry.vertices3D.insert(entry.vertices3D.end(), tile.vertices.begin(), tile.vertices.end());
+        for (unsigned int index : tile.indices) entry.indices3D.push_back(base + index);
+    }
+}
+
+void SceneBuilder::buildImplicit3D(PlotEntry& entry, const Scene& scene, const VariableContext& vars) {
+    ExprNodePtr expr = entry.compiledExpr;
+    auto sampler = [this, expr, &vars](const std::vector<double>& points, std::vector<double>& values) {
+        evaluator_.evaluatePoints(expr, points, values, vars);
+    };
+    // 区间算术: 证明不含零点的盒子不再细分
+    auto bound = [this, expr, &vars](const double lo[3], const double hi[3]) {
+        IntervalContext ranges = {{"x", Interval(lo[0], hi[0])},
+                                  {"y", Interval(lo[1], hi[1])},
+                                  {"z", Interval(lo[2], hi[2])}};
+        Interval r = evaluator_.evaluateInterval(expr, ranges, vars);
+        return std::make_pair(r.lo, r.hi);
+    };
+
+    // Drawn in math coordinates, so world = math for the camera as well
+    double eye[3];
+    scene.cameraEye(eye);
+    OctreeMesher mesher;
+    mesher.setFunction(sampler, bound, entry.expression);
+    IndexedMesh mesh;
+    mesher.build(cameraMeshSettings(eye, scene.target, scene.precision), mesh);
+    entry.vertices3D = std::move(mesh.vertices);
+    entry.indices3D = std::move(mesh.indices);
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,243 @@
+#include "headless/SvgWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+
+namespace ArchMaths {
+
+namespace {
+
+std::string hexColor(float r, float g, float b) {
+    auto channel = [](float v) { return static_cast<int>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    char buffer[8];
+    std::snprintf(buffer, sizeof(buffer), "#%02x%02x%02x", channel(r), channel(g), channel(b));
+    return buffer;
+}
+
+std::string hexColor(const Color& color, float lighting = 1.0f) {
+    float r, g, b;
+    color.toRGB(r, g, b);
+    return hexColor(r * lighting, g * lighting, b * lighting);
+}
+
+std::string axisLabel(double v) {
+    if (std::abs(v - std::round(v)) < 0.0001) return std::to_string(static_cast<int>(std::round(v)));
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.4g", v);
+    return buffer;
+}
+
+// Screen position of vertex k, or false for a break
+using PointSource = std::function<bool(size_t k, double& x, double& y)>;
+
+// One path; a break starts a new subpath, single points are dropped
+void writePath(std::ostream& out, size_t count, const PointSource& point,
+               const std::string& stroke, float width) {
+    std::string d;
+    char buffer[64];
+    size_t runLength = 0;
+    double firstX = 0.0, firstY = 0.0;
+    for (size_t k = 0; k < count; ++k) {
+        double x, y;
+        if (!point(k, x, y)) {
+            runLength = 0;
+            continue;
+        }
+        if (runLength == 0) {
+            firstX = x;
+            firstY = y;
+        } else {
+            if (runLength == 1) {
+                std::snprintf(buffer, sizeof(buffer), "M%.2f %.2f", firstX, firstY);
+                d += buffer;
+            }
+            std::snprintf(buffer, sizeof(buffer), "L%.2f %.2f", x, y);
+            d += buffer;
+        }
+        ++runLength;
+    }
+    if (d.empty()) return;
+    out << "<path d=\"" << d << "\" fill=\"none\" stroke=\"" << stroke << "\" stroke-width=\"" << width
+        << "\" stroke-linejoin=\"round\" stroke-linecap=\"round\"/>\n";
+}
+
+// clip = viewProj * (p, 1), then the viewport transform
+struct Projector {
+    double m[16];
+    double width, height;
+
+    bool operator()(const float* p, double& x, double& y, double& depth) const {
+        double c[4];
+        for (int row = 0; row < 4; ++row) {
+            c[row] = m[row * 4] * p[0] + m[row * 4 + 1] * p[1] + m[row * 4 + 2] * p[2] + m[row * 4 + 3];
+        }
+        if (c[3] <= 1e-6) return false;  // behind the camera
+        x = (0.5 + 0.5 * c[0] / c[3]) * width;
+        y = (0.5 - 0.5 * c[1] / c[3]) * height;
+        depth = c[2] / c[3];
+        return true;
+    }
+};
+
+void write2D(std::ostream& out, const Scene& scene, const std::vector<PlotEntry>& entries) {
+    PlotView view = scene.plotView();
+    double w = scene.width, h = scene.height;
+    double gridStep = scene.gridStep();
+    double startX = std::floor((0 - view.offsetX) / view.scale / gridStep) * gridStep;
+    double endX = std::ceil((w - view.offsetX) / view.scale / gridStep) * gridStep;
+    double startY = std::floor((view.offsetY - h) / view.scale / gridStep) * gridStep;
+    double endY = std::ceil(view.offsetY / view.scale / gridStep) * gridStep;
+
+    out << "<g stroke=\"#e6e6e6\" stroke-width=\"1\">\n";
+    for (double x = startX; x <= endX; x += gridStep) {
+        double sx = view.offsetX + x * view.scale;
+        out << "<line x1=\"" << sx << "\" y1=\"0\" x2=\"" << sx << "\" y2=\"" << h << "\"/>\n";
+    }
+    for (double y = startY; y <= endY; y += gridStep) {
+        double sy = view.offsetY - y * view.scale;
+        out << "<line x1=\"0\" y1=\"" << sy << "\" x2=\"" << w << "\" y2=\"" << sy << "\"/>\n";
+    }
+    out << "</g>\n";
+
+    double yAxis = view.offsetY, xAxis = view.offsetX;
+    bool xAxisVisible = yAxis >= 0 && yAxis <= h;
+    bool yAxisVisible = xAxis >= 0 && xAxis <= w;
+    out << "<g stroke=\"#4d4d4d\" stroke-width=\"2\">\n";
+    if (xAxisVisible) out << "<line x1=\"0\" y1=\"" << yAxis << "\" x2=\"" << w << "\" y2=\"" << yAxis << "\"/>\n";
+    if (yAxisVisible) out << "<line x1=\"" << xAxis << "\" y1=\"0\" x2=\"" << xAxis << "\" y2=\"" << h << "\"/>\n";
+    out << "</g>\n";
+
+    for (const auto& entry : entries) {
+        if (!entry.visible || entry.hasError || entry.vertices.empty()) continue;
+        const std::vector<float>& v = entry.vertices;
+        writePath(out, v.size() / 2, [&](size_t k, double& x, double& y) {
+            x = v[2 * k];
+            y = v[2 * k + 1];
+            return std::isfinite(x) && std::isfinite(y);
+        }, hexColor(entry.color), entry.thickness);
+    }
+
+    // Tick labels as in the canvas
+    out << "<g fill=\"#505050\" font-family=\"sans-serif\" font-size=\"12\">\n";
+    if (xAxisVisible) {
+        for (double x = startX; x <= endX; x += gridStep) {
+            if (std::abs(x) < gridStep * 0.01) continue;
+            double sx = view.offsetX + x * view.scale;
+            out << "<text x=\"" << sx << "\" y=\"" << yAxis + 17 << "\" text-anchor=\"middle\">"
+                << axisLabel(x) << "</text>\n";
+        }
+    }
+    if (yAxisVisible) {
+        for (double y = startY; y <= endY; y += gridStep) {
+            if (std::abs(y) < gridStep * 0.01) continue;
+            double sy = view.offsetY - y * view.scale;
+            out << "<text x=\"" << xAxis - 5 << "\" y=\"" << sy + 4 << "\" text-anchor=\"end\">"
+                << axisLabel(y) << "</text>\n";
+        }
+    }
+    out << "</g>\n";
+}
+
+void write3D(std::ostream& out, const Scene& scene, const std::vector<PlotEntry>& entries) {
+    Projector project;
+    QMatrix4x4 viewProj = scene.viewProjection();
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 4; ++col) project.m[row * 4 + col] = viewProj(row, col);
+    }
+    project.width = scene.width;
+    project.height = scene.height;
+
+    struct Face {
+        double depth;
+        double x[3], y[3];
+        size_t entry;
+        float lighting;
+    };
+    std::vector<Face> faces;
+    const double light = 1.0 / std::sqrt(3.0);  // normalize(1, 1, 1)
+    for (size_t e = 0; e < entries.size(); ++e) {
+        const PlotEntry& entry = entries[e];
+        if (!entry.visible || entry.hasError || entry.plotType == PlotType::Parametric3D) continue;
+        for (size_t t = 0; t + 2 < entry.indices3D.size(); t += 3) {
+            const float* p[3];
+            Face face{0.0, {}, {}, e, 0.0f};
+            bool visible = true;
+            for (int k = 0; k < 3 && visible; ++k) {
+                p[k] = &entry.vertices3D[static_cast<size_t>(entry.indices3D[t + k]) * 6];
+                double depth;
+                visible = project(p[k], face.x[k], face.y[k], depth);
+                face.depth += depth / 3.0;
+            }
+            if (!visible) continue;
+            double minX = std::min({face.x[0], face.x[1], face.x[2]}), maxX = std::max({face.x[0], face.x[1], face.x[2]});
+            double minY = std::min({face.y[0], face.y[1], face.y[2]}), maxY = std::max({face.y[0], face.y[1], face.y[2]});
+            if (maxX < 0 || minX > scene.width || maxY < 0 || minY > scene.height) continue;
+
+            // Flat shading with the canvas lighting
+            double u[3], v[3], n[3];
+            for (int a = 0; a < 3; ++a) {
+                u[a] = p[1][a] - p[0][a];
+                v[a] = p[2][a] - p[0][a];
+            }
+            n[0] = u[1] * v[2] - u[2] * v[1];
+            n[1] = u[2] * v[0] - u[0] * v[2];
+            n[2] = u[0] * v[1] - u[1] * v[0];
+            double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            double diff = len > 0.0 ? std::abs(n[0] + n[1] + n[2]) * light / len : 0.0;
+            face.lighting = static_cast<float>(0.3 + 0.7 * diff);
+            faces.push_back(face);
+        }
+    }
+    // Back to front
+    std::sort(faces.begin(), faces.end(), [](const Face& a, const Face& b) { return a.depth > b.depth; });
+
+    out << "<g fill-opacity=\"0.9\" stroke=\"none\">\n";
+    for (const Face& face : faces) {
+        out << "<polygon points=\"" << face.x[0] << ',' << face.y[0] << ' ' << face.x[1] << ',' << face.y[1]
+            << ' ' << face.x[2] << ',' << face.y[2] << "\" fill=\""
+            << hexColor(entries[face.entry].color, face.lighting) << "\"/>\n";
+    }
+    out << "</g>\n";
+
+    const float axes[3][6] = {{-5, 0, 0, 5, 0, 0}, {0, -5, 0, 0, 5, 0}, {0, 0, -5, 0, 0, 5}};
+    const char* axisColors[3] = {"#cc3333", "#33cc33", "#3333cc"};
+    for (int a = 0; a < 3; ++a) {
+        writePath(out, 2, [&](size_t k, double& x, double& y) {
+            double depth;
+            return project(&axes[a][3 * k], x, y, depth);
+        }, axisColors[a], 2.0f);
+    }
+
+    for (const auto& entry : entries) {
+        if (!entry.visible || entry.hasError || entry.plotType != PlotType::Parametric3D) continue;
+        const std::vector<float>& v = entry.vertices3D;
+        writePath(out, v.size() / 3, [&](size_t k, double& x, double& y) {
+            double depth;
+            return std::isfinite(v[3 * k]) && project(&v[3 * k], x, y, depth);
+        }, hexColor(entry.color), entry.thickness);
+    }
+}
+
+} // namespace
+
+bool SvgWriter::write(const std::string& path, const Scene& scene, const std::vector<PlotEntry>& entries) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out << std::fixed << std::setprecision(2);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << scene.width << "\" height=\"" << scene.height
+        << "\" viewBox=\"0 0 " << scene.width << ' ' << scene.height << "\">\n"
+        << "<rect width=\"100%\" height=\"100%\" fill=\"#ffffff\"/>\n";
+    if (scene.mode3D) {
+        write3D(out, scene, entries);
+    } else {
+        write2D(out, scene, entries);
+    }
+    out << "</svg>\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace ArchMaths
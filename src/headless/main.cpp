@@ -0,0 +1,173 @@
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "headless/OffscreenRenderer.h"
+#include "headless/Scene.h"
+#include "headless/SceneBuilder.h"
+#include "headless/SvgWriter.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace ArchMaths;
+
+namespace {
+
+// 工作线程计算好但需要在主线程渲染的图 (平台不支持多线程OpenGL时)
+struct PendingImage {
+    size_t scene;
+    std::vector<PlotEntry> entries;
+};
+
+bool isSvg(const Scene& scene) {
+    return scene.output.toLower().endsWith(".svg");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // 无显示器的服务器上默认使用 offscreen 平台 (Mesa/llvmpipe)
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName("ArchMathsRender");
+    QGuiApplication::setApplicationVersion("1.0.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders Arch Maths scenes to PNG or SVG without a window.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("scenes", "JSON scene files (an array in a file renders every scene in it).",
+                                 "<scene.json...>");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Number of worker threads.", "N",
+                                  QString::number(QThread::idealThreadCount()));
+    parser.addOption(jobsOption);
+    parser.process(app);
+
+    std::vector<Scene> scenes;
+    for (const QString& path : parser.positionalArguments()) {
+        std::vector<Scene> loaded;
+        QString error;
+        if (!loadScenes(path, loaded, error)) {
+            std::cerr << path.toLocal8Bit().constData() << ": " << error.toLocal8Bit().constData() << std::endl;
+            return 1;
+        }
+        scenes.insert(scenes.end(), loaded.begin(), loaded.end());
+    }
+    if (scenes.empty()) parser.showHelp(1);
+
+    int jobs = std::clamp(parser.value(jobsOption).toInt(), 1, static_cast<int>(scenes.size()));
+    // Without threaded OpenGL the workers only compute and the main thread renders
+    bool threadedGL = QOpenGLContext::supportsThreadedOpenGL();
+
+    // Surfaces must be created on the GUI thread; one per rendering thread
+    std::vector<std::unique_ptr<QOffscreenSurface>> surfaces(threadedGL ? jobs : 1);
+    for (auto& surface : surfaces) {
+        surface = std::make_unique<QOffscreenSurface>();
+        surface->setFormat(OffscreenRenderer::surfaceFormat());
+        surface->create();
+    }
+
+    std::mutex mutex;
+    std::condition_variable pendingReady;
+    std::deque<PendingImage> pending;
+    std::atomic<size_t> nextScene{0};
+    std::atomic<int> failures{0};
+    int runningWorkers = jobs;
+
+    auto report = [&](size_t index, const std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::cerr << scenes[index].output.toLocal8Bit().constData() << ": " << message << std::endl;
+    };
+    auto saveImage = [&](size_t index, OffscreenRenderer& renderer, const std::vector<PlotEntry>& entries) {
+        QImage image = renderer.render(scenes[index], entries);
+        if (image.isNull() || !image.save(scenes[index].output)) {
+            report(index, "could not render or write the image");
+            ++failures;
+        }
+    };
+
+    auto worker = [&](int id) {
+#ifdef _OPENMP
+        // 并行来自多个工作线程, 每个线程内部不再嵌套并行
+        omp_set_num_threads(1);
+#endif
+        SceneBuilder builder;
+        std::unique_ptr<OffscreenRenderer> renderer;
+        for (size_t index = nextScene++; index < scenes.size(); index = nextScene++) {
+            const Scene& scene = scenes[index];
+            std::vector<PlotEntry> entries = builder.build(scene);
+            for (const auto& entry : entries) {
+                if (entry.hasError) report(index, entry.expression + ": " + entry.errorMessage);
+            }
+
+            if (isSvg(scene)) {
+                if (!SvgWriter::write(scene.output.toLocal8Bit().constData(), scene, entries)) {
+                    report(index, "could not write the SVG file");
+                    ++failures;
+                }
+            } else if (threadedGL) {
+                if (!renderer) {
+                    renderer = std::make_unique<OffscreenRenderer>(surfaces[id].get());
+                    QString error;
+                    if (!renderer->initialize(error)) {
+                        report(index, error.toLocal8Bit().constData());
+                        ++failures;
+                        renderer.reset();
+                        continue;
+                    }
+                }
+                saveImage(index, *renderer, entries);
+            } else {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back(PendingImage{index, std::move(entries)});
+                pendingReady.notify_one();
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        --runningWorkers;
+        pendingReady.notify_one();
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::thread> threads;
+    for (int id = 0; id < jobs; ++id) threads.emplace_back(worker, id);
+
+    if (!threadedGL) {
+        OffscreenRenderer renderer(surfaces[0].get());
+        QString error;
+        bool ready = renderer.initialize(error);
+        if (!ready) std::cerr << error.toLocal8Bit().constData() << std::endl;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            pendingReady.wait(lock, [&] { return !pending.empty() || runningWorkers == 0; });
+            if (pending.empty()) break;
+            PendingImage item = std::move(pending.front());
+            pending.pop_front();
+            lock.unlock();
+            if (ready) {
+                saveImage(item.scene, renderer, item.entries);
+            } else {
+                ++failures;
+            }
+            lock.lock();
+        }
+    }
+    for (auto& thread : threads) thread.join();
+
+    std::cerr << scenes.size() << " figures, " << failures.load() << " failed, "
+              << timer.elapsed() << " ms on " << jobs << " threads" << std::endl;
+    return failures.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include "math/CurveSampler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ArchMaths {
+
+void CurveSampler::sample(const Batch& evaluate, const CurveSamplerSettings& settings,
+                          std::vector<double>& t, std::vector<double>& x, std::vector<double>& y) {
+    const int n = std::max(2, settings.initialSamples);
+    t.resize(n + 1);
+    for (int i = 0; i <= n; ++i) t[i] = settings.tMin + (settings.tMax - settings.tMin) * i / n;
+    evaluate(t, x, y);
+
+    const double maxLen2 = settings.maxSegmentLength * settings.maxSegmentLength;
+    const double minLen2 = settings.minSegmentLength * settings.minSegmentLength;
+    auto finite = [&](size_t i) { return std::isfinite(x[i]) && std::isfinite(y[i]); };
+
+    // Cosine of the turn between segments a -> b and b -> c
+    auto turnCos = [&](size_t a, size_t b, size_t c) {
+        double ux = x[b] - x[a], uy = y[b] - y[a];
+        double vx = x[c] - x[b], vy = y[c] - y[b];
+        double lu = ux * ux + uy * uy, lv = vx * vx + vy * vy;
+        if (lu <= 0.0 || lv <= 0.0) return 1.0;
+        return (ux * vx + uy * vy) / std::sqrt(lu * lv);
+    };
+
+    auto needsSplit = [&](size_t i) {
+        bool fa = finite(i), fb = finite(i + 1);
+        if (fa != fb) return true;
+        if (!fa) return false;
+
+        double dx = x[i + 1] - x[i], dy = y[i + 1] - y[i];
+        double len2 = dx * dx + dy * dy;
+        // Both ends beyond the same side of the view by more than the chord:
+        // the arc between them cannot reach the screen either
+        double len = std::sqrt(len2);
+        const double* p[2] = {&x[i], &y[i]};
+        for (int a = 0; a < 2; ++a) {
+            double lo = std::min(p[a][0], p[a][1]), hi = std::max(p[a][0], p[a][1]);
+            if (hi < settings.viewMin[a] - len || lo > settings.viewMax[a] + len) return false;
+        }
+
+        if (len2 > maxLen2) return true;
+        if (len2 <= minLen2) return false;
+        if (i > 0 && finite(i - 1) && turnCos(i - 1, i, i + 1) < settings.minTurnCos) return true;
+        if (i + 2 < t.size() && finite(i + 2) && turnCos(i, i + 1, i + 2) < settings.minTurnCos) return true;
+        return false;
+    };
+
+    std::vector<char> split;
+    std::vector<double> midT, midX, midY, nextT, nextX, nextY;
+    for (int pass = 0; pass < settings.maxPasses; ++pass) {
+        split.assign(t.size() - 1, 0);
+        midT.clear();
+        for (size_t i = 0; i + 1 < t.size(); ++i) {
+            if (!needsSplit(i)) continue;
+            split[i] = 1;
+            midT.push_back(0.5 * (t[i] + t[i + 1]));
+        }
+        if (midT.empty() || t.size() + midT.size() > settings.maxSamples) break;
+
+        evaluate(midT, midX, midY);
+
+        nextT.clear();
+        nextX.clear();
+        nextY.clear();
+        size_t m = 0;
+        for (size_t i = 0; i < t.size(); ++i) {
+            nextT.push_back(t[i]);
+            nextX.push_back(x[i]);
+            nextY.push_back(y[i]);
+            if (i < split.size() && split[i]) {
+                nextT.push_back(midT[m]);
+                nextX.push_back(midX[m]);
+                nextY.push_back(midY[m]);
+                ++m;
+            }
+        }
+        t.swap(nextT);
+        x.swap(nextX);
+        y.swap(nextY);
+    }
+}
+
+} // namespace ArchMaths
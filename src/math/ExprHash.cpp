@@ -0,0 +1,34 @@
+#include "math/ExprHash.h"
+#include <utility>
+
+namespace ArchMaths {
+
+uint64_t hashExpression(const ExprNodePtr& node) {
+    HashBuilder h;
+    if (!node) return h.value();
+
+    h.add(static_cast<int>(node->type));
+    switch (node->type) {
+        case NodeType::Number:
+            h.add(node->value);
+            break;
+        case NodeType::Variable:
+            h.add(node->name);
+            break;
+        case NodeType::BinaryOp: {
+            uint64_t l = hashExpression(node->left);
+            uint64_t r = hashExpression(node->right);
+            if ((node->op == "+" || node->op == "*") && r < l) std::swap(l, r);
+            h.add(node->op).add(l).add(r);
+            break;
+        }
+        default:
+            h.add(node->name).add(node->op);
+            h.add(hashExpression(node->left)).add(hashExpression(node->right));
+            for (const auto& arg : node->args) h.add(hashExpression(arg));
+            break;
+    }
+    return h.value();
+}
+
+} // namespace ArchMaths
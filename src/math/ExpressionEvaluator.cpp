@@ -5,6 +5,94 @@
 
 namespace ArchMaths {
 
+namespace {
+
+// Hull of the given values; any NaN means the bound is unknown
+Interval hull(std::initializer_list<double> values) {
+    Interval r(INFINITY, -INFINITY);
+    for (double v : values) {
+        if (std::isnan(v)) return Interval();
+        r.lo = std::min(r.lo, v);
+        r.hi = std::max(r.hi, v);
+    }
+    return r;
+}
+
+// 0 * inf counts as 0: a zero factor bound really is zero
+double boundProduct(double a, double b) {
+    return (a == 0.0 || b == 0.0) ? 0.0 : a * b;
+}
+
+Interval intervalMul(const Interval& a, const Interval& b) {
+    return hull({boundProduct(a.lo, b.lo), boundProduct(a.lo, b.hi),
+                 boundProduct(a.hi, b.lo), boundProduct(a.hi, b.hi)});
+}
+
+Interval intervalDiv(const Interval& a, const Interval& b) {
+    if (b.lo <= 0.0 && b.hi >= 0.0) return Interval();
+    return intervalMul(a, Interval(1.0 / b.hi, 1.0 / b.lo));
+}
+
+Interval intervalPowInt(const Interval& a, int n) {
+    if (n < 0) return intervalDiv(Interval(1.0, 1.0), intervalPowInt(a, -n));
+    if (n == 0) return Interval(1.0, 1.0);
+    double pl = std::pow(a.lo, n), ph = std::pow(a.hi, n);
+    if (n % 2 == 1) return hull({pl, ph});
+    if (a.lo >= 0.0) return hull({pl, ph});
+    if (a.hi <= 0.0) return hull({ph, pl});
+    return Interval(0.0, std::max(pl, ph));
+}
+
+Interval intervalPow(const Interval& a, const Interval& b) {
+    if (b.lo == b.hi && b.lo == std::round(b.lo) && std::abs(b.lo) < 64.0) {
+        return intervalPowInt(a, static_cast<int>(b.lo));
+    }
+    // Negative bases are undefined for non-integer exponents
+    if (a.lo < 0.0) return Interval();
+    // x^y is monotone in x for fixed sign of y and in y for fixed side of 1,
+    // so the extremes lie on the corners of the split box
+    double xs[3] = {a.lo, std::clamp(1.0, a.lo, a.hi), a.hi};
+    double ys[3] = {b.lo, std::clamp(0.0, b.lo, b.hi), b.hi};
+    Interval r(INFINITY, -INFINITY);
+    for (double x : xs) {
+        for (double y : ys) {
+            Interval c = hull({std::pow(x, y)});
+            r.lo = std::min(r.lo, c.lo);
+            r.hi = std::max(r.hi, c.hi);
+        }
+    }
+    return r;
+}
+
+// Non-decreasing f on [domainLo, domainHi]; outside the domain the point
+// evaluator yields NaN, which never proves a sign
+template <typename F>
+Interval monotone(const Interval& a, F f, double domainLo = -INFINITY, double domainHi = INFINITY) {
+    if (a.hi < domainLo || a.lo > domainHi) return Interval();
+    return hull({f(std::max(a.lo, domainLo)), f(std::min(a.hi, domainHi))});
+}
+
+Interval intervalSin(const Interval& a) {
+    if (!std::isfinite(a.lo) || !std::isfinite(a.hi) || a.hi - a.lo >= Constants::TAU) {
+        return Interval(-1.0, 1.0);
+    }
+    Interval r = hull({std::sin(a.lo), std::sin(a.hi)});
+    // Does the range contain a maximum (pi/2 + 2k pi) or a minimum (-pi/2 + 2k pi)?
+    double kMax = std::ceil((a.lo - Constants::PI / 2) / Constants::TAU);
+    if (Constants::PI / 2 + kMax * Constants::TAU <= a.hi) r.hi = 1.0;
+    double kMin = std::ceil((a.lo + Constants::PI / 2) / Constants::TAU);
+    if (-Constants::PI / 2 + kMin * Constants::TAU <= a.hi) r.lo = -1.0;
+    return r;
+}
+
+Interval intervalAbs(const Interval& a) {
+    if (a.lo >= 0.0) return a;
+    if (a.hi <= 0.0) return Interval(-a.hi, -a.lo);
+    return Interval(0.0, std::max(-a.lo, a.hi));
+}
+
+} // namespace
+
 ExpressionEvaluator::ExpressionEvaluator() {
     initBuiltinFunctions();
 }
@@ -62,6 +150,11 @@ void ExpressionEvaluator::registerFunction(const std::string& name, MathFunction
 }
 
 double ExpressionEvaluator::evaluate(const ExprNodePtr& node, const VariableContext& vars) {
+    evaluations_.fetch_add(1, std::memory_order_relaxed);
+    return evaluateNode(node, vars);
+}
+
+double ExpressionEvaluator::evaluateNode(const ExprNodePtr& node, const VariableContext& vars) {
     if (!node) {
         return std::nan("");
     }
@@ -79,8 +172,8 @@ double ExpressionEvaluator::evaluate(const ExprNodePtr& node, const VariableCont
         }
 
         case NodeType::BinaryOp: {
-            double left = evaluate(node->left, vars);
-            double right = evaluate(node->right, vars);
+            double left = evaluateNode(node->left, vars);
+            double right = evaluateNode(node->right, vars);
 
             if (node->op == "+") return left + right;
             if (node->op == "-") return left - right;
@@ -92,7 +185,7 @@ double ExpressionEvaluator::evaluate(const ExprNodePtr& node, const VariableCont
         }
 
         case NodeType::UnaryOp: {
-            double operand = evaluate(node->left, vars);
+            double operand = evaluateNode(node->left, vars);
             if (node->op == "-") return -operand;
             if (node->op == "+") return operand;
             throw std::runtime_error("未知的一元运算符: " + node->op);
@@ -102,7 +195,7 @@ double ExpressionEvaluator::evaluate(const ExprNodePtr& node, const VariableCont
             std::vector<double> args;
             args.reserve(node->args.size());
             for (const auto& arg : node->args) {
-                args.push_back(evaluate(arg, vars));
+                args.push_back(evaluateNode(arg, vars));
             }
             return evaluateFunction(node->name, args);
         }
@@ -126,17 +219,52 @@ void ExpressionEvaluator::evaluateBatch(const ExprNodePtr& node,
                                         const VariableContext& baseVars,
                                         const std::string& varName) {
     results.resize(xValues.size());
-    VariableContext vars = baseVars;
-
-    // 使用OpenMP并行计算（如果可用）
-    #pragma omp parallel for if(xValues.size() > 1000)
-    for (size_t i = 0; i < xValues.size(); ++i) {
-        VariableContext localVars = vars;
-        localVars[varName] = xValues[i];
-        try {
-            results[i] = evaluate(node, localVars);
-        } catch (...) {
-            results[i] = std::nan("");
+    evaluations_.fetch_add(xValues.size(), std::memory_order_relaxed);
+
+    // 使用OpenMP并行计算（如果可用）, 每个线程一份变量上下文
+    #pragma omp parallel if(xValues.size() > 1000)
+    {
+        VariableContext localVars = baseVars;
+        #pragma omp for
+        for (size_t i = 0; i < xValues.size(); ++i) {
+            localVars[varName] = xValues[i];
+            try {
+                results[i] = evaluateNode(node, localVars);
+            } catch (...) {
+                results[i] = std::nan("");
+            }
+        }
+    }
+}
+
+void ExpressionEvaluator::evaluateBatchPair(const ExprNodePtr& first,
+                                            const ExprNodePtr& second,
+                                            const std::vector<double>& tValues,
+                                            std::vector<double>& firstResults,
+                                            std::vector<double>& secondResults,
+                                            const VariableContext& baseVars,
+                                            const std::string& varName) {
+    firstResults.resize(tValues.size());
+    secondResults.resize(tValues.size());
+    evaluations_.fetch_add(2 * tValues.size(), std::memory_order_relaxed);
+
+    // One variable context per thread instead of per sample
+    #pragma omp parallel if(tValues.size() > 1000)
+    {
+        VariableContext localVars = baseVars;
+        #pragma omp for
+        for (size_t i = 0; i < tValues.size(); ++i) {
+            localVars[varName] = tValues[i];
+            try {
+                firstResults[i] = evaluateNode(first, localVars);
+            } catch (...) {
+                firstResults[i] = std::nan("");
+            }
+            try {
+                secondResults[i] = evaluateNode(second, localVars);
+            } catch (...) {
+                secondResults[i] = std::nan("");
+            }
         }
     }
 }
@@ -150,6 +278,7 @@ void ExpressionEvaluator::evaluateGrid(const ExprNodePtr& node,
     for (auto& row : results) {
         row.resize(xValues.size());
     }
+    evaluations_.fetch_add(xValues.size() * yValues.size(), std::memory_order_relaxed);
 
     #pragma omp parallel for if(xValues.size() * yValues.size() > 1000)
     for (size_t j = 0; j < yValues.size(); ++j) {
@@ -158,7 +287,7 @@ void ExpressionEvaluator::evaluateGrid(const ExprNodePtr& node,
         for (size_t i = 0; i < xValues.size(); ++i) {
             localVars["x"] = xValues[i];
             try {
-                results[j][i] = evaluate(node, localVars);
+                results[j][i] = evaluateNode(node, localVars);
             } catch (...) {
                 results[j][i] = std::nan("");
             }
@@ -176,6 +305,7 @@ void ExpressionEvaluator::evaluateVolume(const ExprNodePtr& node,
     size_t ny = yValues.size();
     size_t nz = zValues.size();
     results.resize(nx * ny * nz);
+    evaluations_.fetch_add(nx * ny * nz, std::memory_order_relaxed);
 
     #pragma omp parallel for if(nx * ny * nz > 1000)
     for (size_t k = 0; k < nz; ++k) {
@@ -187,7 +317,7 @@ void ExpressionEvaluator::evaluateVolume(const ExprNodePtr& node,
                 localVars["x"] = xValues[i];
                 size_t idx = i + j * nx + k * nx * ny;
                 try {
-                    results[idx] = evaluate(node, localVars);
+                    results[idx] = evaluateNode(node, localVars);
                 } catch (...) {
                     results[idx] = std::nan("");
                 }
@@ -196,4 +326,150 @@ void ExpressionEvaluator::evaluateVolume(const ExprNodePtr& node,
     }
 }
 
+void ExpressionEvaluator::evaluatePoints(const ExprNodePtr& node,
+                                         const std::vector<double>& points,
+                                         std::vector<double>& results,
+                                         const VariableContext& baseVars) {
+    const size_t count = points.size() / 3;
+    results.resize(count);
+    evaluations_.fetch_add(count, std::memory_order_relaxed);
+
+    #pragma omp parallel if(count > 1000)
+    {
+        // References into the per-thread context: no key lookups per point
+        VariableContext localVars = baseVars;
+        double& x = localVars["x"];
+        double& y = localVars["y"];
+        double& z = localVars["z"];
+        #pragma omp for schedule(static)
+        for (size_t i = 0; i < count; ++i) {
+            x = points[3 * i];
+            y = points[3 * i + 1];
+            z = points[3 * i + 2];
+            try {
+                results[i] = evaluateNode(node, localVars);
+            } catch (...) {
+                results[i] = std::nan("");
+            }
+        }
+    }
+}
+
+Interval ExpressionEvaluator::evaluateInterval(const ExprNodePtr& node,
+                                               const IntervalContext& ranges,
+                                               const VariableContext& baseVars) {
+    if (!node) return Interval();
+
+    switch (node->type) {
+        case NodeType::Number:
+            return Interval(node->value, node->value);
+
+        case NodeType::Variable: {
+            auto range = ranges.find(node->name);
+            if (range != ranges.end()) return range->second;
+            auto it = baseVars.find(node->name);
+            if (it != baseVars.end()) return Interval(it->second, it->second);
+            return Interval();
+        }
+
+        case NodeType::BinaryOp: {
+            Interval a = evaluateInterval(node->left, ranges, baseVars);
+            Interval b = evaluateInterval(node->right, ranges, baseVars);
+            if (node->op == "+") return hull({a.lo + b.lo, a.hi + b.hi});
+            if (node->op == "-") return hull({a.lo - b.hi, a.hi - b.lo});
+            if (node->op == "*") return intervalMul(a, b);
+            if (node->op == "/") return intervalDiv(a, b);
+            if (node->op == "^") return intervalPow(a, b);
+            return Interval();
+        }
+
+        case NodeType::UnaryOp: {
+            Interval a = evaluateInterval(node->left, ranges, baseVars);
+            if (node->op == "-") return Interval(-a.hi, -a.lo);
+            return a;
+        }
+
+        case NodeType::Function: {
+            std::vector<Interval> args;
+            args.reserve(node->args.size());
+            for (const auto& arg : node->args) {
+                args.push_back(evaluateInterval(arg, ranges, baseVars));
+            }
+            return evaluateFunctionInterval(node->name, args);
+        }
+
+        default:
+            return Interval();
+    }
+}
+
+Interval ExpressionEvaluator::evaluateFunctionInterval(const std::string& name,
+                                                       const std::vector<Interval>& args) {
+    if (args.empty()) return Interval();
+    const Interval& a = args[0];
+    auto fn = [](double (*f)(double)) { return f; };
+
+    if (name == "sin") return intervalSin(a);
+    if (name == "cos") return intervalSin(Interval(a.lo + Constants::PI / 2, a.hi + Constants::PI / 2));
+    if (name == "tan") {
+        // Continuous only between consecutive poles
+        if (!std::isfinite(a.lo) || !std::isfinite(a.hi) || a.hi - a.lo >= Constants::PI) return Interval();
+        double k = std::ceil((a.lo - Constants::PI / 2) / Constants::PI);
+        if (Constants::PI / 2 + k * Constants::PI <= a.hi) return Interval();
+        return hull({std::tan(a.lo), std::tan(a.hi)});
+    }
+    if (name == "asin") return monotone(a, fn(std::asin), -1.0, 1.0);
+    if (name == "acos") {
+        Interval r = monotone(a, fn(std::asin), -1.0, 1.0);
+        return hull({Constants::PI / 2 - r.hi, Constants::PI / 2 - r.lo});
+    }
+    if (name == "atan") return monotone(a, fn(std::atan));
+    if (name == "atan2") return Interval(-Constants::PI, Constants::PI);
+
+    if (name == "sinh") return monotone(a, fn(std::sinh));
+    if (name == "cosh") {
+        Interval m = intervalAbs(a);
+        return hull({std::cosh(m.lo), std::cosh(m.hi)});
+    }
+    if (name == "tanh") return monotone(a, fn(std::tanh));
+    if (name == "asinh") return monotone(a, fn(std::asinh));
+    if (name == "acosh") return monotone(a, fn(std::acosh), 1.0);
+    if (name == "atanh") return monotone(a, fn(std::atanh), -1.0, 1.0);
+
+    if (name == "exp") return monotone(a, fn(std::exp));
+    if (name == "log" || name == "ln") return monotone(a, fn(std::log), 0.0);
+    if (name == "log10") return monotone(a, fn(std::log10), 0.0);
+    if (name == "log2") return monotone(a, fn(std::log2), 0.0);
+
+    if (name == "sqrt") return monotone(a, fn(std::sqrt), 0.0);
+    if (name == "cbrt") return monotone(a, fn(std::cbrt));
+    if (name == "pow" && args.size() >= 2) return intervalPow(a, args[1]);
+
+    if (name == "floor") return monotone(a, fn(std::floor));
+    if (name == "ceil") return monotone(a, fn(std::ceil));
+    if (name == "round") return monotone(a, fn(std::round));
+    if (name == "frac") {
+        if (std::isfinite(a.lo) && std::floor(a.lo) == std::floor(a.hi)) {
+            return Interval(a.lo - std::floor(a.lo), a.hi - std::floor(a.lo));
+        }
+        return Interval(0.0, 1.0);
+    }
+
+    if (name == "abs") return intervalAbs(a);
+    if (name == "sign") return hull({a.lo > 0 ? 1.0 : a.lo < 0 ? -1.0 : 0.0,
+                                     a.hi > 0 ? 1.0 : a.hi < 0 ? -1.0 : 0.0});
+    if (name == "min" && args.size() >= 2) return Interval(std::min(a.lo, args[1].lo), std::min(a.hi, args[1].hi));
+    if (name == "max" && args.size() >= 2) return Interval(std::max(a.lo, args[1].lo), std::max(a.hi, args[1].hi));
+    if (name == "mod" && args.size() >= 2) {
+        // fmod keeps the dividend's sign and stays below |divisor|
+        double bound = std::max(std::abs(args[1].lo), std::abs(args[1].hi));
+        if (a.lo >= 0.0) return Interval(0.0, std::min(a.hi, bound));
+        if (a.hi <= 0.0) return Interval(-std::min(-a.lo, bound), 0.0);
+        return Interval(-bound, bound);
+    }
+
+    // Registered functions have no interval extension
+    return Interval();
+}
+
 } // namespace ArchMaths
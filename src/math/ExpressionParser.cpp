@@ -1,6 +1,5 @@
 #include "math/ExpressionParser.h"
 #include <stdexcept>
-#include <iostream>
 
 namespace ArchMaths {
 
@@ -192,7 +191,6 @@ ExprNodePtr ExpressionParser::parsePrimary() {
 
         // 检查是否后面跟着左括号且是用户自定义函数
         if (currentToken().type == TokenType::LeftParen && userFunctions_ && userFunctions_->count(varName) > 0) {
-            std::cerr << "Found user function call: " << varName << std::endl;
             return parseFunction(varName);
         }
 
@@ -211,7 +209,6 @@ ExprNodePtr ExpressionParser::parsePrimary() {
 }
 
 ExprNodePtr ExpressionParser::parseFunction(const std::string& name) {
-    std::cerr << "parseFunction called for: " << name << std::endl;
     expect(TokenType::LeftParen, "函数调用缺少左括号");
 
     std::vector<ExprNodePtr> args;
@@ -226,16 +223,12 @@ ExprNodePtr ExpressionParser::parseFunction(const std::string& name) {
     }
 
     expect(TokenType::RightParen, "函数调用缺少右括号");
-    std::cerr << "parseFunction: parsed " << args.size() << " args" << std::endl;
 
     // 检查是否是用户自定义函数
     if (userFunctions_) {
         auto it = userFunctions_->find(name);
         if (it != userFunctions_->end()) {
-            std::cerr << "Calling substituteUserFunction for: " << name << std::endl;
-            auto result = substituteUserFunction(name, args);
-            std::cerr << "substituteUserFunction returned, result=" << (result ? "valid" : "null") << std::endl;
-            return result;
+            return substituteUserFunction(name, args);
         }
     }
 
@@ -243,24 +236,18 @@ ExprNodePtr ExpressionParser::parseFunction(const std::string& name) {
 }
 
 ExprNodePtr ExpressionParser::substituteUserFunction(const std::string& name, const std::vector<ExprNodePtr>& args) {
-    std::cerr << "substituteUserFunction: name=" << name << ", args.size()=" << args.size() << std::endl;
-
     if (!userFunctions_ || userFunctions_->empty()) {
-        std::cerr << "substituteUserFunction: no user functions" << std::endl;
         return ExprNode::makeFunction(name, std::vector<ExprNodePtr>(args));
     }
 
     auto it = userFunctions_->find(name);
     if (it == userFunctions_->end()) {
-        std::cerr << "substituteUserFunction: function not found" << std::endl;
         return ExprNode::makeFunction(name, std::vector<ExprNodePtr>(args));
     }
 
-    const UserFunction& func = it->second;
-    std::cerr << "substituteUserFunction: bodyStr=" << func.bodyStr << ", params.size()=" << func.params.size() << std::endl;
+    UserFunction& func = it->second;
 
     if (func.bodyStr.empty()) {
-        std::cerr << "substituteUserFunction: empty body" << std::endl;
         return ExprNode::makeFunction(name, std::vector<ExprNodePtr>(args));
     }
     if (args.size() != func.params.size()) {
@@ -268,31 +255,36 @@ ExprNodePtr ExpressionParser::substituteUserFunction(const std::string& name, co
             std::to_string(func.params.size()) + " 个参数，实际 " + std::to_string(args.size()) + " 个");
     }
 
-    std::cerr << "substituteUserFunction: creating bodyParser" << std::endl;
-    // 使用新的解析器实例解析函数体（避免状态污染）
-    ExpressionParser bodyParser;
-    std::cerr << "substituteUserFunction: parsing body" << std::endl;
-    ExprNodePtr bodyExpr = bodyParser.parse(func.bodyStr);
-    std::cerr << "substituteUserFunction: body parsed, bodyExpr=" << (bodyExpr ? "valid" : "null") << std::endl;
-    if (!bodyExpr || bodyParser.hasError()) {
-        throw std::runtime_error("函数体解析失败: " + bodyParser.getError());
+    // 函数体只解析一次, 之后每次调用克隆缓存的AST
+    if (!func.body) {
+        // 使用新的解析器实例解析函数体（避免状态污染）; 函数体可以调用其他用户函数
+        if (substitutionDepth_ >= kMaxSubstitutionDepth) {
+            throw std::runtime_error("函数 " + name + " 嵌套过深 (递归定义?)");
+        }
+        ExpressionParser bodyParser;
+        bodyParser.userFunctions_ = userFunctions_;
+        bodyParser.substitutionDepth_ = substitutionDepth_ + 1;
+        ExprNodePtr bodyExpr = bodyParser.parse(func.bodyStr);
+        if (!bodyExpr || bodyParser.hasError()) {
+            // 嵌套函数体的错误已带前缀, 不再重复
+            const std::string prefix = "函数体解析失败: ";
+            const std::string& error = bodyParser.getError();
+            throw std::runtime_error(error.compare(0, prefix.size(), prefix) == 0 ? error : prefix + error);
+        }
+        func.body = bodyExpr;
     }
 
-    std::cerr << "substituteUserFunction: building subs map" << std::endl;
     // 构建参数替换映射
     std::unordered_map<std::string, ExprNodePtr> subs;
     for (size_t i = 0; i < func.params.size(); ++i) {
-        std::cerr << "substituteUserFunction: param[" << i << "]=" << func.params[i] << std::endl;
         if (!args[i]) {
             throw std::runtime_error("函数参数为空");
         }
         subs[func.params[i]] = args[i];
     }
 
-    std::cerr << "substituteUserFunction: calling cloneAndSubstitute" << std::endl;
     // 克隆函数体并替换参数
-    auto result = cloneAndSubstitute(bodyExpr, subs);
-    std::cerr << "substituteUserFunction: cloneAndSubstitute done, result=" << (result ? "valid" : "null") << std::endl;
+    auto result = cloneAndSubstitute(func.body, subs);
     if (!result) {
         throw std::runtime_error("函数替换失败");
     }
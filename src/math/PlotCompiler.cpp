@@ -0,0 +1,324 @@
+#include "math/PlotCompiler.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace ArchMaths {
+
+bool PlotCompiler::splitTuple(const std::string& expr, std::vector<std::string>& parts) {
+    parts.clear();
+    size_t first = expr.find_first_not_of(" \t");
+    size_t last = expr.find_last_not_of(" \t");
+    if (first == std::string::npos || expr[first] != '(' || expr[last] != ')') return false;
+
+    int depth = 0;
+    size_t start = first + 1;
+    for (size_t i = first; i <= last; ++i) {
+        char c = expr[i];
+        if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            // The opening parenthesis must close at the very end
+            if (--depth == 0 && i != last) return false;
+        } else if (c == ',' && depth == 1) {
+            parts.push_back(expr.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    parts.push_back(expr.substr(start, last - start));
+    return parts.size() >= 2;
+}
+
+// 简单的函数定义解析 (不使用regex)
+bool PlotCompiler::parseFunctionDefinition(const std::string& expr, std::string& funcName,
+                                           std::vector<std::string>& params, std::string& body) {
+    // 查找 name(params) = body 模式
+    size_t parenOpen = expr.find('(');
+    if (parenOpen == std::string::npos || parenOpen == 0) return false;
+
+    size_t parenClose = expr.find(')', parenOpen);
+    if (parenClose == std::string::npos) return false;
+
+    size_t eqPos = expr.find('=', parenClose);
+    if (eqPos == std::string::npos) return false;
+
+    // 提取函数名
+    funcName = expr.substr(0, parenOpen);
+    // 去除空格
+    funcName.erase(std::remove_if(funcName.begin(), funcName.end(), ::isspace), funcName.end());
+
+    // 检查函数名是否有效 (只包含字母数字下划线，以字母开头)
+    if (funcName.empty() || !std::isalpha(funcName[0])) return false;
+    for (char c : funcName) {
+        if (!std::isalnum(c) && c != '_') return false;
+    }
+
+    // 转小写
+    std::transform(funcName.begin(), funcName.end(), funcName.begin(), ::tolower);
+
+    // 提取参数
+    std::string paramsStr = expr.substr(parenOpen + 1, parenClose - parenOpen - 1);
+    std::stringstream ss(paramsStr);
+    std::string param;
+    while (std::getline(ss, param, ',')) {
+        param.erase(std::remove_if(param.begin(), param.end(), ::isspace), param.end());
+        std::transform(param.begin(), param.end(), param.begin(), ::tolower);
+        if (!param.empty()) {
+            params.push_back(param);
+        }
+    }
+
+    // Validate each parameter is a valid identifier (not an expression like "x*y")
+    for (const auto& p : params) {
+        if (p.empty() || !std::isalpha(p[0])) return false;
+        for (char c : p) {
+            if (!std::isalnum(c) && c != '_') return false;
+        }
+    }
+
+    // 提取函数体
+    body = expr.substr(eqPos + 1);
+    // 去除前导空格
+    size_t start = body.find_first_not_of(" \t");
+    if (start != std::string::npos) {
+        body = body.substr(start);
+    }
+
+    return !body.empty();
+}
+
+PlotCompiler::PlotCompiler()
+    : parser_(std::make_unique<ExpressionParser>())
+{
+    parser_->setUserFunctions(&userFunctions_);
+}
+
+void PlotCompiler::defineFunctions(const std::vector<PlotEntry>& entries) {
+    userFunctions_.clear();
+    for (const auto& entry : entries) {
+        std::string funcName;
+        std::vector<std::string> params;
+        std::string bodyStr;
+        if (parseFunctionDefinition(entry.expression, funcName, params, bodyStr)) {
+            // Only register if function doesn't already exist (first definition wins)
+            if (userFunctions_.count(funcName) == 0) {
+                UserFunction func;
+                func.params = std::move(params);
+                func.bodyStr = std::move(bodyStr);
+                userFunctions_[funcName] = std::move(func);
+            }
+        }
+    }
+}
+
+void PlotCompiler::compile(PlotEntry& entry) {
+    entry.hasError = false;
+    entry.errorMessage.clear();
+    entry.compiledExpr = nullptr;
+    entry.compiledExprX = nullptr;
+    entry.compiledExprY = nullptr;
+    entry.compiledExprZ = nullptr;
+
+    if (entry.expression.empty()) {
+        return;
+    }
+
+    std::string expr = entry.expression;
+
+    // 检测是否是函数定义: name(params) = body
+    std::string funcName;
+    std::vector<std::string> params;
+    std::string bodyStr;
+
+    if (parseFunctionDefinition(expr, funcName, params, bodyStr)) {
+        // If function already exists, treat as function call (implicit plot), not redefinition
+        if (userFunctions_.count(funcName) == 0) {
+            // 验证函数体语法
+            auto bodyExpr = parser_->parse(bodyStr);
+            if (parser_->hasError() || !bodyExpr) {
+                entry.hasError = true;
+                entry.errorMessage = parser_->hasError() ? parser_->getError() : "解析失败";
+                return;
+            }
+
+            // 存储用户函数（只存储字符串，AST在首次调用时缓存）; 已缓存的函数体
+            // 可能把这个名字当作普通函数解析过, 全部作废
+            for (auto& [name, existing] : userFunctions_) existing.body = nullptr;
+            UserFunction func;
+            func.params = params;
+            func.bodyStr = bodyStr;
+            userFunctions_[funcName] = func;
+
+            // 函数定义不需要绘图
+            entry.plotType = PlotType::ExplicitY;
+            return;
+        }
+        // Check if this is a function definition (params match) vs function call (params differ)
+        const auto& existingFunc = userFunctions_.at(funcName);
+        if (params == existingFunc.params) {
+            // This is a function definition, not a call - don't plot
+            entry.plotType = PlotType::ExplicitY;
+            return;
+        }
+        // Fall through to equation parsing for existing function calls like g(x,y) = 1
+    }
+
+    // 参数方程 (f(t), g(t)) 或 (f(t), g(t), h(t)); compiledExpr 指向x分量, 沿用"已编译"检查
+    std::vector<std::string> components;
+    if (expr.find('=') == std::string::npos && splitTuple(expr, components) &&
+        (components.size() == 2 || components.size() == 3)) {
+        entry.plotType = components.size() == 2 ? PlotType::Parametric2D : PlotType::Parametric3D;
+        ExprNodePtr* targets[] = {&entry.compiledExprX, &entry.compiledExprY, &entry.compiledExprZ};
+        for (size_t i = 0; i < components.size(); ++i) {
+            *targets[i] = parser_->parse(components[i]);
+            if (parser_->hasError()) break;
+        }
+        entry.compiledExpr = entry.compiledExprX;
+        if (parser_->hasError()) {
+            entry.hasError = true;
+            entry.errorMessage = parser_->getError();
+            entry.compiledExpr = nullptr;
+        }
+        return;
+    }
+
+    // 检测表达式类型
+    size_t eqPos = expr.find('=');
+
+    if (eqPos != std::string::npos) {
+        std::string lhs = expr.substr(0, eqPos);
+        std::string rhs = expr.substr(eqPos + 1);
+
+        // 去除空格
+        lhs.erase(std::remove_if(lhs.begin(), lhs.end(), ::isspace), lhs.end());
+        rhs.erase(std::remove_if(rhs.begin(), rhs.end(), ::isspace), rhs.end());
+
+        if (lhs == "y") {
+            entry.plotType = PlotType::ExplicitY;
+            entry.compiledExpr = parser_->parse(rhs);
+        } else if (lhs == "x") {
+            entry.plotType = PlotType::ExplicitX;
+            entry.compiledExpr = parser_->parse(rhs);
+        } else if (lhs == "r") {
+            // r = f(θ) -> Polar
+            entry.plotType = PlotType::Polar;
+            entry.compiledExpr = parser_->parse(rhs);
+        } else if (lhs == "z") {
+            // z = f(x,y) -> Surface3D
+            entry.plotType = PlotType::Surface3D;
+            entry.compiledExpr = parser_->parse(rhs);
+        } else {
+            // Check if it's an implicit 3D equation (contains x, y, and z)
+            std::string implicitExpr = lhs + "-(" + rhs + ")";
+            auto tempExpr = parser_->parse(implicitExpr);
+            if (tempExpr && containsVariable(tempExpr, "z")) {
+                // Implicit 3D: f(x,y,z) = 0
+                entry.plotType = PlotType::Implicit3D;
+                entry.compiledExpr = tempExpr;
+            } else {
+                // 隐函数 2D: convert "lhs = rhs" to "lhs - (rhs)" for f(x,y) = 0
+                entry.plotType = PlotType::Implicit;
+                entry.compiledExpr = tempExpr;
+            }
+        }
+    } else {
+        // 默认为 y = f(x)
+        entry.plotType = PlotType::ExplicitY;
+        entry.compiledExpr = parser_->parse(expr);
+    }
+
+    if (parser_->hasError()) {
+        entry.hasError = true;
+        entry.errorMessage = parser_->getError();
+        entry.compiledExpr = nullptr;
+    }
+}
+
+void PlotCompiler::extractParameters(PlotEntry& entry, VariableContext& vars) {
+    if (!entry.compiledExpr) return;
+
+    // Collect all variables from the expression (and every curve component)
+    std::set<std::string> names;
+    for (const ExprNodePtr& expr : {entry.compiledExpr, entry.compiledExprX, entry.compiledExprY, entry.compiledExprZ}) {
+        collectVariables(expr, names);
+    }
+
+    // Standard plot variables to exclude
+    static const std::set<std::string> standardVars = {"x", "y", "t", "theta", "r"};
+
+    // Build list of parameters (non-standard variables)
+    std::vector<ParameterInfo> newParams;
+    for (const auto& var : names) {
+        if (standardVars.find(var) == standardVars.end()) {
+            // Check if this parameter already exists (preserve its value)
+            bool found = false;
+            for (const auto& existing : entry.parameters) {
+                if (existing.name == var) {
+                    newParams.push_back(existing);
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                ParameterInfo param;
+                param.name = var;
+                // Check if there's a global value for this variable
+                auto it = vars.find(var);
+                param.value = (it != vars.end()) ? it->second : 1.0;
+                newParams.push_back(param);
+            }
+            // Ensure the variable is in the global context
+            if (vars.find(var) == vars.end()) {
+                vars[var] = newParams.back().value;
+            }
+        }
+    }
+
+    entry.parameters = std::move(newParams);
+}
+
+void PlotCompiler::collectVariables(const ExprNodePtr& node, std::set<std::string>& vars) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NodeType::Variable:
+            vars.insert(node->name);
+            break;
+        case NodeType::BinaryOp:
+            collectVariables(node->left, vars);
+            collectVariables(node->right, vars);
+            break;
+        case NodeType::UnaryOp:
+            collectVariables(node->left, vars);
+            break;
+        case NodeType::Function:
+            for (const auto& arg : node->args) {
+                collectVariables(arg, vars);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool PlotCompiler::containsVariable(const ExprNodePtr& node, const std::string& varName) {
+    if (!node) return false;
+
+    switch (node->type) {
+        case NodeType::Variable:
+            return node->name == varName;
+        case NodeType::BinaryOp:
+            return containsVariable(node->left, varName) || containsVariable(node->right, varName);
+        case NodeType::UnaryOp:
+            return containsVariable(node->left, varName);
+        case NodeType::Function:
+            for (const auto& arg : node->args) {
+                if (containsVariable(arg, varName)) return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,183 @@
+#include "math/PlotSampler.h"
+#include "math/CurveSampler.h"
+#include "mesh/MarchingSquares.h"
+#include <algorithm>
+
+namespace ArchMaths {
+
+void PlotSampler::samplePolyline(PlotEntry& entry, const PlotView& view, const VariableContext& vars) const {
+    entry.vertices.clear();
+    entry.plotPoints.clear();
+
+    double scale = view.scale;
+    double offsetX = view.offsetX;
+    double offsetY = view.offsetY;
+    int width = view.width;
+    int height = view.height;
+
+    if (entry.plotType == PlotType::ExplicitY) {
+        // y = f(x)
+        double xMin = (0 - offsetX) / scale;
+        double xMax = (width - offsetX) / scale;
+        double step = 1.0 / (scale * view.precision); // 每像素一个点
+
+        std::vector<double> xValues;
+        for (double x = xMin; x <= xMax; x += step) {
+            xValues.push_back(x);
+        }
+
+        std::vector<double> yValues;
+        evaluator_.evaluateBatch(entry.compiledExpr, xValues, yValues, vars, "x");
+
+        for (size_t i = 0; i < xValues.size(); ++i) {
+            if (std::isfinite(yValues[i])) {
+                float screenX = static_cast<float>(offsetX + xValues[i] * scale);
+                float screenY = static_cast<float>(offsetY - yValues[i] * scale);
+
+                // 只添加在视口内的点
+                if (screenY >= -1000 && screenY <= height + 1000) {
+                    entry.vertices.push_back(screenX);
+                    entry.vertices.push_back(screenY);
+                    entry.plotPoints.push_back(Point2D(xValues[i], yValues[i]));
+                }
+            } else if (!entry.vertices.empty()) {
+                // 遇到NaN时断开线条，添加一个特殊标记
+                entry.vertices.push_back(std::nanf(""));
+                entry.vertices.push_back(std::nanf(""));
+            }
+        }
+    }
+    else if (entry.plotType == PlotType::ExplicitX) {
+        // x = f(y)
+        double yMin = (offsetY - height) / scale;
+        double yMax = offsetY / scale;
+        double step = 1.0 / (scale * view.precision);
+
+        std::vector<double> yInputs;
+        for (double y = yMin; y <= yMax; y += step) {
+            yInputs.push_back(y);
+        }
+
+        std::vector<double> xValues;
+        evaluator_.evaluateBatch(entry.compiledExpr, yInputs, xValues, vars, "y");
+
+        for (size_t i = 0; i < yInputs.size(); ++i) {
+            if (std::isfinite(xValues[i])) {
+                float screenX = static_cast<float>(offsetX + xValues[i] * scale);
+                float screenY = static_cast<float>(offsetY - yInputs[i] * scale);
+
+                if (screenX >= -1000 && screenX <= width + 1000) {
+                    entry.vertices.push_back(screenX);
+                    entry.vertices.push_back(screenY);
+                }
+            }
+        }
+    }
+    else if (entry.plotType == PlotType::Implicit) {
+        // Marching squares algorithm for implicit functions f(x,y) = 0
+        double xMin = (0 - offsetX) / scale;
+        double xMax = (width - offsetX) / scale;
+        double yMin = (offsetY - height) / scale;
+        double yMax = offsetY / scale;
+
+        int gridSize = std::min(static_cast<int>(std::max(width, height) / 4 * view.precision), 1000);
+        double dx = (xMax - xMin) / gridSize;
+        double dy = (yMax - yMin) / gridSize;
+
+        std::vector<double> xVals(gridSize + 1), yVals(gridSize + 1);
+        for (int k = 0; k <= gridSize; ++k) {
+            xVals[k] = xMin + k * dx;
+            yVals[k] = yMin + k * dy;
+        }
+        std::vector<std::vector<double>> grid;
+        evaluator_.evaluateGrid(entry.compiledExpr, xVals, yVals, grid, vars);
+
+        std::vector<double> segments;
+        MarchingSquares::extract(grid, xVals, yVals, segments);
+        entry.vertices.reserve(segments.size() / 4 * 6);
+        for (size_t k = 0; k + 3 < segments.size(); k += 4) {
+            entry.vertices.push_back(static_cast<float>(offsetX + segments[k] * scale));
+            entry.vertices.push_back(static_cast<float>(offsetY - segments[k + 1] * scale));
+            entry.vertices.push_back(static_cast<float>(offsetX + segments[k + 2] * scale));
+            entry.vertices.push_back(static_cast<float>(offsetY - segments[k + 3] * scale));
+            entry.vertices.push_back(std::nanf(""));
+            entry.vertices.push_back(std::nanf(""));
+        }
+    }
+    else if (entry.plotType == PlotType::Parametric2D || entry.plotType == PlotType::Polar) {
+        // (f(t), g(t)) or r = f(θ), refined by screen-space arc length
+        bool polar = entry.plotType == PlotType::Polar;
+        if (!polar && (!entry.compiledExprX || !entry.compiledExprY)) return;
+
+        CurveSamplerSettings settings;
+        settings.tMax = polar ? kPolarThetaMax : kParametricTMax;
+        settings.maxSegmentLength = 4.0 / view.precision;
+        settings.viewMax[0] = width;
+        settings.viewMax[1] = height;
+
+        std::vector<double> radii;
+        auto evaluate = [&](const std::vector<double>& ts, std::vector<double>& xs, std::vector<double>& ys) {
+            if (polar) {
+                evaluator_.evaluateBatch(entry.compiledExpr, ts, radii, vars, "theta");
+                xs.resize(ts.size());
+                ys.resize(ts.size());
+                for (size_t i = 0; i < ts.size(); ++i) {
+                    xs[i] = radii[i] * std::cos(ts[i]);
+                    ys[i] = radii[i] * std::sin(ts[i]);
+                }
+            } else {
+                evaluator_.evaluateBatchPair(entry.compiledExprX, entry.compiledExprY, ts, xs, ys, vars, "t");
+            }
+            for (size_t i = 0; i < ts.size(); ++i) {
+                xs[i] = offsetX + xs[i] * scale;
+                ys[i] = offsetY - ys[i] * scale;
+            }
+        };
+
+        std::vector<double> ts, xs, ys;
+        CurveSampler::sample(evaluate, settings, ts, xs, ys);
+
+        for (size_t i = 0; i < ts.size(); ++i) {
+            if (std::isfinite(xs[i]) && std::isfinite(ys[i])) {
+                entry.vertices.push_back(static_cast<float>(xs[i]));
+                entry.vertices.push_back(static_cast<float>(ys[i]));
+            } else if (!entry.vertices.empty() && std::isfinite(entry.vertices.back())) {
+                // 遇到NaN时断开线条
+                entry.vertices.push_back(std::nanf(""));
+                entry.vertices.push_back(std::nanf(""));
+            }
+        }
+    }
+}
+
+void PlotSampler::sampleCurve3D(const PlotEntry& entry, int samples, const VariableContext& vars,
+                                std::vector<float>& out) const {
+    out.clear();
+    if (!entry.compiledExprX || !entry.compiledExprY || !entry.compiledExprZ || samples < 1) return;
+
+    double tMin = 0.0, tMax = kParametricTMax;
+    double step = (tMax - tMin) / samples;
+    std::vector<double> tVals;
+    tVals.reserve(samples + 1);
+    for (int i = 0; i <= samples; ++i) {
+        tVals.push_back(tMin + i * step);
+    }
+
+    std::vector<double> xVals, yVals, zVals;
+    evaluator_.evaluateBatchPair(entry.compiledExprX, entry.compiledExprY, tVals, xVals, yVals, vars, "t");
+    evaluator_.evaluateBatch(entry.compiledExprZ, tVals, zVals, vars, "t");
+
+    out.reserve(tVals.size() * 3);
+    for (size_t i = 0; i < tVals.size(); ++i) {
+        if (std::isfinite(xVals[i]) && std::isfinite(yVals[i]) && std::isfinite(zVals[i])) {
+            out.push_back(static_cast<float>(xVals[i]));
+            out.push_back(static_cast<float>(yVals[i]));
+            out.push_back(static_cast<float>(zVals[i]));
+        } else if (!out.empty() && std::isfinite(out.back())) {
+            // 遇到NaN时断开曲线, 不跨越间断连接
+            out.insert(out.end(), 3, std::nanf(""));
+        }
+    }
+}
+
+} // namespace ArchMaths
@@ -96,16 +96,26 @@ std::vector<Token> Tokenizer::tokenize(const std::string& expression) {
             else if (isFunction(identifier)) {
                 tokens.push_back(Token(TokenType::Function, lower));
             }
-            // 变量 - 支持隐式乘法 (xy -> x*y)
+            // 变量 - 支持隐式乘法 (xy -> x*y), "theta" 作为一个变量 (rtheta -> r*theta)
             else {
                 for (size_t k = 0; k < lower.length(); ++k) {
                     if (k > 0) {
                         tokens.push_back(Token(TokenType::Operator, "*"));
                     }
-                    tokens.push_back(Token(TokenType::Variable, std::string(1, lower[k])));
+                    if (lower.compare(k, 5, "theta") == 0) {
+                        tokens.push_back(Token(TokenType::Variable, "theta"));
+                        k += 4;
+                    } else {
+                        tokens.push_back(Token(TokenType::Variable, std::string(1, lower[k])));
+                    }
                 }
             }
         }
+        // θ (UTF-8 0xCE 0xB8) 与 theta 等价
+        else if (c == '\xCE' && i + 1 < expr.length() && expr[i + 1] == '\xB8') {
+            tokens.push_back(Token(TokenType::Variable, "theta"));
+            i += 2;
+        }
         // 运算符
         else if (isOperator(c)) {
             tokens.push_back(Token(TokenType::Operator, std::string(1, c)));
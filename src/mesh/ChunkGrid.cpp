@@ -0,0 +1,54 @@
+#include "mesh/ChunkGrid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ArchMaths {
+
+namespace {
+
+// True if the box is entirely on the negative side of a frustum plane
+bool outsideFrustum(const double m[16], const double lo[3], const double hi[3]) {
+    // Gribb-Hartmann: planes are row 3 ± rows 0..2 of the view-projection
+    for (int row = 0; row < 3; ++row) {
+        for (int sign = -1; sign <= 1; sign += 2) {
+            double plane[4];
+            for (int c = 0; c < 4; ++c) plane[c] = m[12 + c] + sign * m[row * 4 + c];
+            // Corner furthest along the plane normal
+            double d = plane[3];
+            for (int a = 0; a < 3; ++a) d += plane[a] * (plane[a] >= 0.0 ? hi[a] : lo[a]);
+            if (d < 0.0) return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+std::vector<ChunkCoord> visibleChunks(const ChunkView& view, double chunkSize, size_t maxChunks) {
+    std::vector<std::pair<double, ChunkCoord>> candidates;
+    const double tx = view.target[0], tz = view.target[2];
+    const int i0 = static_cast<int>(std::floor((tx - view.radius) / chunkSize));
+    const int i1 = static_cast<int>(std::floor((tx + view.radius) / chunkSize));
+    const int j0 = static_cast<int>(std::floor((tz - view.radius) / chunkSize));
+    const int j1 = static_cast<int>(std::floor((tz + view.radius) / chunkSize));
+
+    for (int j = j0; j <= j1; ++j) {
+        for (int i = i0; i <= i1; ++i) {
+            double lo[3] = {i * chunkSize, view.target[1] - view.radius, j * chunkSize};
+            double hi[3] = {(i + 1) * chunkSize, view.target[1] + view.radius, (j + 1) * chunkSize};
+            double dx = std::max({lo[0] - tx, 0.0, tx - hi[0]});
+            double dz = std::max({lo[2] - tz, 0.0, tz - hi[2]});
+            double distance = std::sqrt(dx * dx + dz * dz);
+            if (distance > view.radius || outsideFrustum(view.viewProj, lo, hi)) continue;
+            candidates.push_back({distance, ChunkCoord{i, j, 0}});
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<ChunkCoord> chunks;
+    for (size_t n = 0; n < candidates.size() && n < maxChunks; ++n) chunks.push_back(candidates[n].second);
+    return chunks;
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,138 @@
+#include "mesh/IndexedMesh.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace ArchMaths {
+
+namespace {
+
+// Forsyth's linear-speed vertex cache optimisation: reorders the triangles
+// in place. Vertex ids must be below vertexCount.
+void orderTriangles(unsigned int* indices, size_t triCount, size_t vertexCount) {
+    // Modelled cache size; small enough to be conservative on mobile GPUs
+    constexpr int kCacheSize = 16;
+    if (triCount == 0) return;
+
+    // Score tables: cache position term and the valence boost
+    constexpr int kMaxValence = 32;
+    static const auto tables = [] {
+        std::pair<std::vector<float>, std::vector<float>> t;
+        t.first.resize(kCacheSize);
+        for (int p = 0; p < kCacheSize; ++p) {
+            // The last triangle's vertices get a fixed score so the order
+            // does not just ping-pong between two triangles
+            t.first[p] = p < 3 ? 0.75f : std::pow(1.0f - static_cast<float>(p - 3) / (kCacheSize - 3), 1.5f);
+        }
+        // Boost vertices with few triangles left, to finish them off
+        t.second.resize(kMaxValence + 1);
+        for (int r = 1; r <= kMaxValence; ++r) t.second[r] = 2.0f * std::pow(static_cast<float>(r), -0.5f);
+        return t;
+    }();
+    auto vertexScore = [](int cachePos, int remaining) -> float {
+        if (remaining == 0) return -1.0f;
+        float score = cachePos >= 0 ? tables.first[cachePos] : 0.0f;
+        return score + (remaining <= kMaxValence ? tables.second[remaining]
+                                                 : 2.0f * std::pow(static_cast<float>(remaining), -0.5f));
+    };
+
+    // Vertex -> triangles adjacency (CSR)
+    std::vector<int> remaining(vertexCount, 0);
+    for (size_t n = 0; n < triCount * 3; ++n) ++remaining[indices[n]];
+    std::vector<size_t> adjOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjOffset[v + 1] = adjOffset[v] + remaining[v];
+    std::vector<size_t> adjacency(triCount * 3);
+    {
+        std::vector<size_t> fill(adjOffset.begin(), adjOffset.end() - 1);
+        for (size_t t = 0; t < triCount; ++t) {
+            for (int c = 0; c < 3; ++c) adjacency[fill[indices[t * 3 + c]]++] = t;
+        }
+    }
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vScore[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<char> emitted(triCount, 0);
+    std::vector<float> tScore(triCount);
+    for (size_t t = 0; t < triCount; ++t) {
+        tScore[t] = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+    }
+
+    std::vector<unsigned int> ordered;
+    ordered.reserve(triCount * 3);
+    std::vector<unsigned int> cache, nextCache;
+    size_t scanCursor = 0;
+    size_t best = std::max_element(tScore.begin(), tScore.end()) - tScore.begin();
+
+    for (size_t emittedCount = 0; emittedCount < triCount; ++emittedCount) {
+        if (best == triCount || emitted[best]) {
+            // Nothing useful in the cache: take the next unemitted triangle
+            while (emitted[scanCursor]) ++scanCursor;
+            best = scanCursor;
+        }
+
+        emitted[best] = 1;
+        const unsigned int* tri = &indices[best * 3];
+        nextCache.assign(tri, tri + 3);
+        for (int c = 0; c < 3; ++c) {
+            ordered.push_back(tri[c]);
+            // Drop the triangle from the vertex's live adjacency range
+            size_t first = adjOffset[tri[c]];
+            size_t last = first + --remaining[tri[c]];
+            for (size_t a = first; a <= last; ++a) {
+                if (adjacency[a] == best) { std::swap(adjacency[a], adjacency[last]); break; }
+            }
+        }
+        for (unsigned int v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) nextCache.push_back(v);
+        }
+
+        // Rescore everything that was or is in the cache
+        for (size_t p = 0; p < nextCache.size(); ++p) {
+            unsigned int v = nextCache[p];
+            cachePos[v] = p < static_cast<size_t>(kCacheSize) ? static_cast<int>(p) : -1;
+            vScore[v] = vertexScore(cachePos[v], remaining[v]);
+        }
+        if (nextCache.size() > static_cast<size_t>(kCacheSize)) nextCache.resize(kCacheSize);
+        cache.swap(nextCache);
+
+        best = triCount;
+        float bestScore = -1.0f;
+        for (unsigned int v : cache) {
+            for (size_t a = adjOffset[v]; a < adjOffset[v] + remaining[v]; ++a) {
+                size_t t = adjacency[a];
+                const unsigned int* o = &indices[t * 3];
+                tScore[t] = vScore[o[0]] + vScore[o[1]] + vScore[o[2]];
+                if (tScore[t] > bestScore) { bestScore = tScore[t]; best = t; }
+            }
+        }
+    }
+
+    std::copy(ordered.begin(), ordered.end(), indices);
+}
+
+// Renumber vertices in first-use order; unreferenced vertices are dropped
+void renumberFirstUse(IndexedMesh& mesh) {
+    std::vector<int> remap(mesh.vertexCount(), -1);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+    int next = 0;
+    for (unsigned int& id : mesh.indices) {
+        if (remap[id] < 0) {
+            remap[id] = next++;
+            vertices.insert(vertices.end(), mesh.vertices.begin() + id * 6, mesh.vertices.begin() + id * 6 + 6);
+        }
+        id = static_cast<unsigned int>(remap[id]);
+    }
+    mesh.vertices.swap(vertices);
+}
+
+} // namespace
+
+void optimizeVertexCache(IndexedMesh& mesh) {
+    orderTriangles(mesh.indices.data(), mesh.indices.size() / 3, mesh.vertexCount());
+    renumberFirstUse(mesh);
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,59 @@
+#include "mesh/MarchingSquares.h"
+#include <cmath>
+
+namespace ArchMaths {
+
+void MarchingSquares::extract(const std::vector<std::vector<double>>& field,
+                              const std::vector<double>& xVals,
+                              const std::vector<double>& yVals,
+                              std::vector<double>& segments) {
+    auto lerp = [](double p1, double p2, double v1, double v2) {
+        if (std::abs(v2 - v1) < 1e-10) return (p1 + p2) / 2;
+        return p1 + (-v1) * (p2 - p1) / (v2 - v1);
+    };
+
+    auto addSeg = [&](double ax, double ay, double bx, double by) {
+        segments.insert(segments.end(), {ax, ay, bx, by});
+    };
+
+    for (size_t j = 0; j + 1 < yVals.size(); ++j) {
+        const std::vector<double>& row0 = field[j];
+        const std::vector<double>& row1 = field[j + 1];
+        for (size_t i = 0; i + 1 < xVals.size(); ++i) {
+            // Corners: 0=BL, 1=BR, 2=TR, 3=TL
+            double v0 = row0[i], v1 = row0[i + 1];
+            double v2 = row1[i + 1], v3 = row1[i];
+
+            if (!std::isfinite(v0) || !std::isfinite(v1) ||
+                !std::isfinite(v2) || !std::isfinite(v3)) continue;
+
+            // Case index: bit0=v0, bit1=v1, bit2=v2, bit3=v3
+            int c = (v0 > 0 ? 1 : 0) | (v1 > 0 ? 2 : 0) |
+                    (v2 > 0 ? 4 : 0) | (v3 > 0 ? 8 : 0);
+
+            if (c == 0 || c == 15) continue;
+
+            double x0 = xVals[i], x1 = xVals[i + 1];
+            double y0 = yVals[j], y1 = yVals[j + 1];
+
+            // Edge crossings: bottom(0-1), right(1-2), top(3-2), left(0-3)
+            double bx = lerp(x0, x1, v0, v1), by = y0;
+            double rx = x1, ry = lerp(y0, y1, v1, v2);
+            double tx = lerp(x0, x1, v3, v2), ty = y1;
+            double lx = x0, ly = lerp(y0, y1, v0, v3);
+
+            switch (c) {
+                case 1: case 14: addSeg(bx, by, lx, ly); break;
+                case 2: case 13: addSeg(bx, by, rx, ry); break;
+                case 3: case 12: addSeg(lx, ly, rx, ry); break;
+                case 4: case 11: addSeg(rx, ry, tx, ty); break;
+                case 6: case 9:  addSeg(bx, by, tx, ty); break;
+                case 7: case 8:  addSeg(lx, ly, tx, ty); break;
+                case 5:  addSeg(bx, by, lx, ly); addSeg(rx, ry, tx, ty); break;
+                case 10: addSeg(bx, by, rx, ry); addSeg(lx, ly, tx, ty); break;
+            }
+        }
+    }
+}
+
+} // namespace ArchMaths
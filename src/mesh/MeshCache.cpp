@@ -0,0 +1,47 @@
+#include "mesh/MeshCache.h"
+#include "mesh/SurfaceMesh.h"
+
+namespace ArchMaths {
+
+size_t CachedGeometry::byteSize() const {
+    return vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int) +
+           (packed ? packed->byteSize() : 0);
+}
+
+std::shared_ptr<const CachedGeometry> MeshCache::find(uint64_t key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+    ++hits_;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+}
+
+void MeshCache::insert(uint64_t key, std::shared_ptr<const CachedGeometry> geometry) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        bytes_ -= it->second->second->byteSize();
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    bytes_ += geometry->byteSize();
+    lru_.emplace_front(key, std::move(geometry));
+    index_[key] = lru_.begin();
+
+    // Never evicts the geometry just inserted
+    while (bytes_ > budgetBytes_ && lru_.size() > 1) {
+        bytes_ -= lru_.back().second->byteSize();
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+void MeshCache::clear() {
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,240 @@
+#include "mesh/MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace ArchMaths {
+
+namespace {
+
+// Sum of squared distances to a set of planes, as a symmetric 4x4 matrix
+struct Quadric {
+    double aa = 0, ab = 0, ac = 0, ad = 0, bb = 0, bc = 0, bd = 0, cc = 0, cd = 0, dd = 0;
+
+    void addPlane(double a, double b, double c, double d) {
+        aa += a * a; ab += a * b; ac += a * c; ad += a * d;
+        bb += b * b; bc += b * c; bd += b * d;
+        cc += c * c; cd += c * d;
+        dd += d * d;
+    }
+
+    void add(const Quadric& o) {
+        aa += o.aa; ab += o.ab; ac += o.ac; ad += o.ad;
+        bb += o.bb; bc += o.bc; bd += o.bd;
+        cc += o.cc; cd += o.cd;
+        dd += o.dd;
+    }
+
+    double error(const float* p) const {
+        double x = p[0], y = p[1], z = p[2];
+        double e = aa * x * x + bb * y * y + cc * z * z + dd +
+                   2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+        return std::max(e, 0.0);
+    }
+};
+
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+void faceNormal(const float* a, const float* b, const float* c, double n[3]) {
+    double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double w[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    n[0] = u[1] * w[2] - u[2] * w[1];
+    n[1] = u[2] * w[0] - u[0] * w[2];
+    n[2] = u[0] * w[1] - u[1] * w[0];
+}
+
+// Each pass collapses an independent set of edges and then rebuilds the
+// adjacency; the mesh roughly halves every few passes
+constexpr int kMaxPasses = 48;
+
+} // namespace
+
+void MeshSimplifier::simplify(IndexedMesh& mesh, const SimplifySettings& settings) {
+    const bool bounded = settings.maxError > 0.0 || settings.errorPerDistance > 0.0;
+    if (!bounded && settings.targetTriangles == 0) return;
+    if (!bounded && mesh.indices.size() / 3 <= settings.targetTriangles) return;
+
+    const size_t vertexCount = mesh.vertexCount();
+    std::vector<unsigned int>& indices = mesh.indices;
+    auto position = [&](unsigned int v) { return &mesh.vertices[static_cast<size_t>(v) * 6]; };
+
+    // Unit plane equations, so the error is a sum of squared distances
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const float* p0 = position(indices[t]);
+        double n[3];
+        faceNormal(p0, position(indices[t + 1]), position(indices[t + 2]), n);
+        double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len <= 0.0) continue;
+        for (double& c : n) c /= len;
+        double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        for (int k = 0; k < 3; ++k) quadrics[indices[t + k]].addPlane(n[0], n[1], n[2], d);
+    }
+
+    // Edges not shared by exactly two triangles lock their vertices
+    std::vector<char> locked(vertexCount, 0);
+    {
+        std::unordered_map<uint64_t, int> edgeUse;
+        edgeUse.reserve(indices.size());
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            for (int e = 0; e < 3; ++e) {
+                uint64_t a = indices[t + e], b = indices[t + (e + 1) % 3];
+                ++edgeUse[std::min(a, b) << 32 | std::max(a, b)];
+            }
+        }
+        for (const auto& [key, count] : edgeUse) {
+            if (count == 2) continue;
+            locked[key >> 32] = 1;
+            locked[key & 0xFFFFFFFFu] = 1;
+        }
+    }
+
+    std::vector<double> tolerance2;
+    if (bounded) {
+        tolerance2.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            const float* p = position(static_cast<unsigned int>(v));
+            double dx = p[0] - settings.eye[0], dy = p[1] - settings.eye[1], dz = p[2] - settings.eye[2];
+            double tol = settings.maxError + settings.errorPerDistance * std::sqrt(dx * dx + dy * dy + dz * dz);
+            tolerance2[v] = tol * tol;
+        }
+    }
+
+    std::vector<unsigned int> adjOffset, adjTriangles, cursor;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<unsigned int> stamp(vertexCount, 0);
+    std::vector<char> touched(vertexCount);
+    unsigned int stampId = 0;
+    std::vector<Collapse> candidates;
+    // Collapses within the error bound come first and never stop at the
+    // budget; only if they leave the mesh over budget do costlier ones follow
+    bool withinBound = bounded;
+
+    auto around = [&](unsigned int v, auto&& visit) {
+        for (unsigned int k = adjOffset[v]; k < adjOffset[v + 1]; ++k) visit(adjTriangles[k]);
+    };
+
+    // Half-edge collapse from -> to keeps the surface a manifold only if the
+    // two 1-rings share exactly the two vertices opposite the edge, and must
+    // not turn any surviving triangle around `from` over
+    auto collapseValid = [&](unsigned int from, unsigned int to) {
+        stampId += 2;
+        around(from, [&](unsigned int t) {
+            for (int k = 0; k < 3; ++k) stamp[indices[t * 3 + k]] = stampId;
+        });
+        int common = 0;
+        around(to, [&](unsigned int t) {
+            for (int k = 0; k < 3; ++k) {
+                unsigned int w = indices[t * 3 + k];
+                if (w == from || w == to || stamp[w] != stampId) continue;
+                stamp[w] = stampId + 1;
+                ++common;
+            }
+        });
+        if (common != 2) return false;
+
+        bool flips = false;
+        around(from, [&](unsigned int t) {
+            const unsigned int* tri = &indices[t * 3];
+            if (flips || tri[0] == to || tri[1] == to || tri[2] == to) return;
+            const float* p[3] = {position(tri[0]), position(tri[1]), position(tri[2])};
+            double before[3], after[3];
+            faceNormal(p[0], p[1], p[2], before);
+            for (int k = 0; k < 3; ++k) {
+                if (tri[k] == from) p[k] = position(to);
+            }
+            faceNormal(p[0], p[1], p[2], after);
+            flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+        });
+        return !flips;
+    };
+
+    for (int pass = 0; pass < kMaxPasses; ++pass) {
+        const size_t triangles = indices.size() / 3;
+        const bool overBudget = settings.targetTriangles != 0 && triangles > settings.targetTriangles;
+        if (!withinBound && !overBudget) break;
+
+        // vertex -> triangle adjacency
+        adjOffset.assign(vertexCount + 1, 0);
+        for (unsigned int v : indices) ++adjOffset[v + 1];
+        for (size_t v = 0; v < vertexCount; ++v) adjOffset[v + 1] += adjOffset[v];
+        cursor.assign(adjOffset.begin(), adjOffset.end() - 1);
+        adjTriangles.resize(indices.size());
+        for (size_t k = 0; k < indices.size(); ++k) adjTriangles[cursor[indices[k]]++] = static_cast<unsigned int>(k / 3);
+
+        // Interior edges appear once per orientation; keep the a < b one and
+        // the cheaper of its two directions
+        candidates.clear();
+        for (size_t k = 0; k < indices.size(); ++k) {
+            unsigned int a = indices[k];
+            unsigned int b = indices[k % 3 == 2 ? k - 2 : k + 1];
+            if (a > b || (locked[a] && locked[b])) continue;
+            Quadric q = quadrics[a];
+            q.add(quadrics[b]);
+            const double inf = std::numeric_limits<double>::infinity();
+            double toB = locked[a] ? inf : q.error(position(b));
+            double toA = locked[b] ? inf : q.error(position(a));
+            Collapse c = toB <= toA ? Collapse{a, b, toB} : Collapse{b, a, toA};
+            if (withinBound && c.cost > tolerance2[c.to]) continue;
+            candidates.push_back(c);
+        }
+        if (candidates.empty()) {
+            if (!withinBound || !overBudget) break;
+            withinBound = false;
+            continue;
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        // Under a budget only the cheaper half is used per pass, so costly
+        // collapses wait until the cheap ones have been exhausted
+        size_t limit = candidates.size();
+        size_t maxCollapses = std::numeric_limits<size_t>::max();
+        if (!withinBound) {
+            limit = candidates.size() / 2 + 1;
+            maxCollapses = (triangles - settings.targetTriangles + 1) / 2;
+        }
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t collapsed = 0;
+        for (size_t n = 0; n < limit && n < candidates.size() && collapsed < maxCollapses; ++n) {
+            const Collapse& c = candidates[n];
+            if (touched[c.from] || touched[c.to] || !collapseValid(c.from, c.to)) continue;
+            // The ring around `from` changes shape; leave it for the next pass
+            around(c.from, [&](unsigned int t) {
+                for (int k = 0; k < 3; ++k) touched[indices[t * 3 + k]] = 1;
+            });
+            remap[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+            ++collapsed;
+        }
+        if (collapsed == 0) {
+            if (!withinBound || !overBudget) break;
+            withinBound = false;
+            continue;
+        }
+
+        size_t out = 0;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+            if (a == b || b == c || a == c) continue;
+            indices[out++] = a;
+            indices[out++] = b;
+            indices[out++] = c;
+        }
+        indices.resize(out);
+    }
+
+    // Also drops the collapsed vertices
+    optimizeVertexCache(mesh);
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,799 @@
+#include "mesh/OctreeMesher.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ArchMaths {
+
+namespace {
+
+// Corner c of a cell sits at offset (c>>2 & 1, c>>1 & 1, c & 1).
+// Edges 0-3 run along x, 4-7 along y, 8-11 along z.
+const int edgeCorners[12][2] = {
+    {0, 4}, {1, 5}, {2, 6}, {3, 7},
+    {0, 2}, {1, 3}, {4, 6}, {5, 7},
+    {0, 1}, {2, 3}, {4, 5}, {6, 7}
+};
+
+// Contouring tables: children sharing each internal face / edge of a cell,
+// the sub-faces and sub-edges of a face, the sub-edges of an edge, and for
+// four cells around an edge, which of their own edges it is
+const int cellProcFaceMask[12][3] = {
+    {0, 4, 0}, {1, 5, 0}, {2, 6, 0}, {3, 7, 0},
+    {0, 2, 1}, {4, 6, 1}, {1, 3, 1}, {5, 7, 1},
+    {0, 1, 2}, {2, 3, 2}, {4, 5, 2}, {6, 7, 2}
+};
+const int cellProcEdgeMask[6][5] = {
+    {0, 1, 2, 3, 0}, {4, 5, 6, 7, 0},
+    {0, 4, 1, 5, 1}, {2, 6, 3, 7, 1},
+    {0, 2, 4, 6, 2}, {1, 3, 5, 7, 2}
+};
+const int faceProcFaceMask[3][4][3] = {
+    {{4, 0, 0}, {5, 1, 0}, {6, 2, 0}, {7, 3, 0}},
+    {{2, 0, 1}, {6, 4, 1}, {3, 1, 1}, {7, 5, 1}},
+    {{1, 0, 2}, {3, 2, 2}, {5, 4, 2}, {7, 6, 2}}
+};
+const int faceProcEdgeMask[3][4][6] = {
+    {{1, 4, 0, 5, 1, 1}, {1, 6, 2, 7, 3, 1}, {0, 4, 6, 0, 2, 2}, {0, 5, 7, 1, 3, 2}},
+    {{0, 2, 3, 0, 1, 0}, {0, 6, 7, 4, 5, 0}, {1, 2, 0, 6, 4, 2}, {1, 3, 1, 7, 5, 2}},
+    {{1, 1, 0, 3, 2, 0}, {1, 5, 4, 7, 6, 0}, {0, 1, 5, 0, 4, 1}, {0, 3, 7, 2, 6, 1}}
+};
+const int edgeProcEdgeMask[3][2][5] = {
+    {{3, 2, 1, 0, 0}, {7, 6, 5, 4, 0}},
+    {{5, 1, 4, 0, 1}, {7, 3, 6, 2, 1}},
+    {{6, 4, 2, 0, 2}, {7, 5, 3, 1, 2}}
+};
+const int processEdgeMask[3][4] = {{3, 2, 1, 0}, {7, 5, 6, 4}, {11, 10, 9, 8}};
+
+// The two triangles of an edge's quad, by which end of the edge is inside
+const int quadTriangles[2][6] = {{0, 1, 3, 0, 3, 2}, {0, 3, 1, 0, 2, 3}};
+
+// The cell cache is dropped wholesale past this size (~70 MB)
+constexpr size_t kMaxCachedCells = size_t(1) << 19;
+// Per-cell loops with fewer items stay on the calling thread
+constexpr int kParallelCells = 256;
+// Cells solved per batch; bounds the Hermite scratch data (~1 KB a cell)
+constexpr size_t kSolveBatch = size_t(1) << 16;
+
+// Camera movement (relative to its distance) and turn that trigger a remesh
+constexpr double kRebuildMove = 0.05;
+constexpr double kRebuildTurnCos = 0.985;
+
+uint64_t sampleKey(int ix, int iy, int iz) {
+    return static_cast<uint64_t>(ix) | (static_cast<uint64_t>(iy) << 21) | (static_cast<uint64_t>(iz) << 42);
+}
+
+// Central-difference stencil around p, h on either side: +x, -x, +y, -y, +z, -z
+void stencil(const double p[3], double h, double* out) {
+    for (int k = 0; k < 6; ++k) {
+        double* q = out + 3 * k;
+        q[0] = p[0];
+        q[1] = p[1];
+        q[2] = p[2];
+        q[k / 2] += (k & 1) ? -h : h;
+    }
+}
+
+// 2h * grad f from the stencil's values
+void stencilGradient(const double* v, double g[3]) {
+    for (int a = 0; a < 3; ++a) g[a] = v[2 * a] - v[2 * a + 1];
+}
+
+// Mass-point regularized QEF: minimize sum (n.(x - p))^2 + w |x - m|^2
+bool solveQEF(const double ata[6], const double atb[3], const double mass[3], double w, double x[3]) {
+    double a00 = ata[0] + w, a01 = ata[1], a02 = ata[2];
+    double a11 = ata[3] + w, a12 = ata[4], a22 = ata[5] + w;
+    double b[3] = {atb[0] + w * mass[0], atb[1] + w * mass[1], atb[2] + w * mass[2]};
+    double c00 = a11 * a22 - a12 * a12;
+    double c01 = a02 * a12 - a01 * a22;
+    double c02 = a01 * a12 - a02 * a11;
+    double det = a00 * c00 + a01 * c01 + a02 * c02;
+    if (std::abs(det) < 1e-30) return false;
+    double c11 = a00 * a22 - a02 * a02;
+    double c12 = a01 * a02 - a00 * a12;
+    double c22 = a00 * a11 - a01 * a01;
+    x[0] = (c00 * b[0] + c01 * b[1] + c02 * b[2]) / det;
+    x[1] = (c01 * b[0] + c11 * b[1] + c12 * b[2]) / det;
+    x[2] = (c02 * b[0] + c12 * b[1] + c22 * b[2]) / det;
+    return std::isfinite(x[0]) && std::isfinite(x[1]) && std::isfinite(x[2]);
+}
+
+} // namespace
+
+void OctreeMesher::setFunction(Sampler f, BoxBound bound, const std::string& key, bool coherent) {
+    f_ = std::move(f);
+    bound_ = std::move(bound);
+    if (key != key_) {
+        key_ = key;
+        clearCache();
+        // The band only predicts where a slightly changed surface is
+        coherent_ = coherent;
+        if (!coherent) band_.clear();
+    }
+}
+
+void OctreeMesher::clearCache() {
+    cells_.clear();
+    built_ = false;
+}
+
+bool OctreeMesher::needsRebuild(const OctreeMeshSettings& s) const {
+    if (!built_) return true;
+    const OctreeMeshSettings& b = settings_;
+    if (s.halfSize != b.halfSize || s.maxDepth != b.maxDepth || s.minDepth != b.minDepth ||
+        s.detail != b.detail || s.curvatureCos != b.curvatureCos) return true;
+    double moved = 0.0, distance = 0.0, turn = 0.0;
+    for (int a = 0; a < 3; ++a) {
+        if (s.center[a] != b.center[a]) return true;
+        moved += (s.eye[a] - b.eye[a]) * (s.eye[a] - b.eye[a]);
+        distance += (b.eye[a] - b.center[a]) * (b.eye[a] - b.center[a]);
+        turn += s.viewDir[a] * b.viewDir[a];
+    }
+    return std::sqrt(moved) > kRebuildMove * std::max(std::sqrt(distance), spacing_) || turn < kRebuildTurnCos;
+}
+
+void OctreeMesher::worldPosition(double ix, double iy, double iz, double p[3]) const {
+    p[0] = settings_.center[0] - settings_.halfSize + ix * spacing_;
+    p[1] = settings_.center[1] - settings_.halfSize + iy * spacing_;
+    p[2] = settings_.center[2] - settings_.halfSize + iz * spacing_;
+}
+
+void OctreeMesher::evaluate(const std::vector<double>& points, std::vector<double>& values) {
+    values.clear();
+    if (points.empty()) return;
+    evaluations_ += points.size() / 3;
+    f_(points, values);
+    values.resize(points.size() / 3, std::nan(""));
+}
+
+uint64_t OctreeMesher::cellKey(int x, int y, int z, int depth) const {
+    const int shift = settings_.maxDepth - depth;
+    return (static_cast<uint64_t>(depth) << 57) |
+           (static_cast<uint64_t>(x >> shift) << 38) |
+           (static_cast<uint64_t>(y >> shift) << 19) |
+           static_cast<uint64_t>(z >> shift);
+}
+
+OctreeMesher::CellInfo& OctreeMesher::cell(const Node& node) {
+    return cells_[cellKey(node.x, node.y, node.z, node.depth)];
+}
+
+bool OctreeMesher::inBand(const Node& node) const {
+    return band_.count(cellKey(node.x, node.y, node.z, std::min(node.depth, bandDepth_))) != 0;
+}
+
+bool OctreeMesher::updateBand(bool builtInBand) {
+    const int blocks = 1 << bandDepth_;
+    const int shift = settings_.maxDepth - bandDepth_;
+
+    // Blocks the surface passes through; a coarse leaf covers several
+    std::unordered_set<uint64_t> seen;
+    std::vector<int> surface;  // x, y, z block triplets
+    for (int index : surfaceLeaves_) {
+        const Node& node = nodes_[index];
+        const int span = 1 << (bandDepth_ - std::min(node.depth, bandDepth_));
+        const int bx = node.x >> shift, by = node.y >> shift, bz = node.z >> shift;
+        for (int i = 0; i < span; ++i) {
+            for (int j = 0; j < span; ++j) {
+                for (int k = 0; k < span; ++k) {
+                    if (!seen.insert(cellKey((bx + i) << shift, (by + j) << shift, (bz + k) << shift, bandDepth_)).second) continue;
+                    surface.insert(surface.end(), {bx + i, by + j, bz + k});
+                }
+            }
+        }
+    }
+
+    auto forNeighbours = [&](int radius, auto&& visit) {
+        for (size_t s = 0; s < surface.size(); s += 3) {
+            for (int i = -radius; i <= radius; ++i) {
+                for (int j = -radius; j <= radius; ++j) {
+                    for (int k = -radius; k <= radius; ++k) {
+                        int x = surface[s] + i, y = surface[s + 1] + j, z = surface[s + 2] + k;
+                        if (x < 0 || y < 0 || z < 0 || x >= blocks || y >= blocks || z >= blocks) continue;
+                        if (!visit(x << shift, y << shift, z << shift)) return false;
+                    }
+                }
+            }
+        }
+        return true;
+    };
+
+    // Every block next to the new surface must have been visited; at the
+    // edge of the band the surface may continue into blocks that were not
+    if (builtInBand && !forNeighbours(1, [&](int x, int y, int z) {
+            return band_.count(cellKey(x, y, z, bandDepth_)) != 0;
+        })) {
+        return false;
+    }
+
+    band_.clear();
+    forNeighbours(kBandRadius, [&](int x, int y, int z) {
+        // Ancestors too, so coarse nodes can test the band directly
+        for (int depth = bandDepth_; depth >= 0; --depth) {
+            if (!band_.insert(cellKey(x, y, z, depth)).second) break;
+        }
+        return true;
+    });
+    return true;
+}
+
+void OctreeMesher::sampleCorners(const std::vector<int>& indices) {
+    // Corner keys and where their values go; a corner shared by several
+    // cells of the batch is evaluated once
+    std::vector<std::pair<uint64_t, double*>> pending;
+    for (int index : indices) {
+        const Node& node = nodes_[index];
+        CellInfo& info = *node.info;
+        if (info.sampled) continue;
+        info.sampled = true;
+        // Child c shares its corner c with the parent
+        int inherited = -1;
+        if (node.parent >= 0) {
+            inherited = index - nodes_[node.parent].firstChild;
+            info.corner[inherited] = nodes_[node.parent].info->corner[inherited];
+        }
+        const int size = 1 << (settings_.maxDepth - node.depth);
+        for (int c = 0; c < 8; ++c) {
+            if (c == inherited) continue;
+            uint64_t key = sampleKey(node.x + ((c >> 2) & 1) * size, node.y + ((c >> 1) & 1) * size,
+                                     node.z + (c & 1) * size);
+            pending.emplace_back(key, &info.corner[c]);
+        }
+    }
+    if (pending.empty()) return;
+    std::sort(pending.begin(), pending.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<double> points;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (i > 0 && pending[i].first == pending[i - 1].first) continue;
+        uint64_t key = pending[i].first;
+        double p[3];
+        worldPosition(static_cast<double>(key & 0x1FFFFF), static_cast<double>((key >> 21) & 0x1FFFFF),
+                      static_cast<double>(key >> 42), p);
+        points.insert(points.end(), p, p + 3);
+    }
+    std::vector<double> values;
+    evaluate(points, values);
+    size_t unique = 0;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (i > 0 && pending[i].first != pending[i - 1].first) ++unique;
+        *pending[i].second = values[unique];
+    }
+}
+
+void OctreeMesher::solveCells(const std::vector<int>& indices) {
+    struct Solve {
+        int node;
+        int crossings;
+        bool newton;
+        double lo[3], hi[3];
+        double x[3];
+        double avg[3];
+    };
+    std::vector<Solve> cells;
+    for (int index : indices) {
+        if (!nodes_[index].info->solved) cells.push_back(Solve{index, 0, false, {}, {}, {}, {}});
+    }
+    if (cells.empty()) return;
+    if (cells.size() > kSolveBatch) {
+        std::vector<int> batch;
+        for (size_t first = 0; first < cells.size(); first += kSolveBatch) {
+            batch.clear();
+            for (size_t i = first; i < std::min(first + kSolveBatch, cells.size()); ++i) batch.push_back(cells[i].node);
+            solveCells(batch);
+        }
+        return;
+    }
+    const int n = static_cast<int>(cells.size());
+    const double h = 0.5 * spacing_;
+
+    // Hermite data: edge crossings (at most 12 per cell) and the field
+    // gradient there, all stencils of the batch evaluated together. An edge
+    // is shared by up to four cells of its size, which all find the same
+    // crossing, so its stencil is evaluated once per edge.
+    std::vector<double> crossing(static_cast<size_t>(n) * 36);
+    // (lower end on the lattice, axis | depth << 2) of each crossing's edge
+    std::vector<std::pair<uint64_t, int>> edgeKey(static_cast<size_t>(n) * 12);
+    #pragma omp parallel for if(n > kParallelCells)
+    for (int i = 0; i < n; ++i) {
+        Solve& s = cells[i];
+        const Node& node = nodes_[s.node];
+        const int size = 1 << (settings_.maxDepth - node.depth);
+        worldPosition(node.x, node.y, node.z, s.lo);
+        worldPosition(node.x + size, node.y + size, node.z + size, s.hi);
+        const double* value = node.info->corner;
+        for (const auto& edge : edgeCorners) {
+            int c0 = edge[0], c1 = edge[1];
+            if (((node.inside >> c0) & 1) == ((node.inside >> c1) & 1)) continue;
+            double t = value[c0] / (value[c0] - value[c1]);
+            const size_t slot = static_cast<size_t>(i) * 12 + s.crossings++;
+            double* p = &crossing[slot * 3];
+            for (int a = 0; a < 3; ++a) {
+                double p0 = ((c0 >> (2 - a)) & 1) ? s.hi[a] : s.lo[a];
+                double p1 = ((c1 >> (2 - a)) & 1) ? s.hi[a] : s.lo[a];
+                p[a] = p0 + t * (p1 - p0);
+            }
+            const int axis = c1 - c0 == 4 ? 0 : c1 - c0 == 2 ? 1 : 2;
+            edgeKey[slot] = {sampleKey(node.x + ((c0 >> 2) & 1) * size, node.y + ((c0 >> 1) & 1) * size,
+                                       node.z + (c0 & 1) * size),
+                             axis | node.depth << 2};
+        }
+    }
+    std::vector<size_t> order;
+    for (int i = 0; i < n; ++i) {
+        for (int k = 0; k < cells[i].crossings; ++k) order.push_back(static_cast<size_t>(i) * 12 + k);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return edgeKey[a] < edgeKey[b]; });
+    // Stencil of each distinct edge; gradientOf[slot] indexes its values
+    std::vector<size_t> gradientOf(static_cast<size_t>(n) * 12);
+    std::vector<double> points;
+    size_t edges = 0;
+    for (size_t j = 0; j < order.size(); ++j) {
+        if (j == 0 || edgeKey[order[j]] != edgeKey[order[j - 1]]) {
+            points.resize((edges + 1) * 18);
+            stencil(&crossing[order[j] * 3], h, &points[edges * 18]);
+            ++edges;
+        }
+        gradientOf[order[j]] = edges - 1;
+    }
+    std::vector<double> values;
+    evaluate(points, values);
+
+    #pragma omp parallel for if(n > kParallelCells)
+    for (int i = 0; i < n; ++i) {
+        Solve& s = cells[i];
+        CellInfo& info = *nodes_[s.node].info;
+        double ata[6] = {0, 0, 0, 0, 0, 0}, atb[3] = {0, 0, 0}, mass[3] = {0, 0, 0};
+        double normals[12][3];
+        int planes = 0;
+        for (int k = 0; k < s.crossings; ++k) {
+            const double* p = &crossing[(static_cast<size_t>(i) * 12 + k) * 3];
+            for (int a = 0; a < 3; ++a) mass[a] += p[a];
+            double g[3];
+            stencilGradient(&values[gradientOf[static_cast<size_t>(i) * 12 + k] * 6], g);
+            double len = std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+            if (!(len > 0.0) || !std::isfinite(len)) continue;
+            double* nrm = normals[planes++];
+            for (int a = 0; a < 3; ++a) {
+                nrm[a] = g[a] / len;
+                s.avg[a] += nrm[a];
+            }
+            double d = nrm[0] * p[0] + nrm[1] * p[1] + nrm[2] * p[2];
+            ata[0] += nrm[0] * nrm[0]; ata[1] += nrm[0] * nrm[1]; ata[2] += nrm[0] * nrm[2];
+            ata[3] += nrm[1] * nrm[1]; ata[4] += nrm[1] * nrm[2]; ata[5] += nrm[2] * nrm[2];
+            for (int a = 0; a < 3; ++a) atb[a] += nrm[a] * d;
+        }
+
+        if (s.crossings == 0) {
+            // The surface only touches this cell through a finer neighbour's
+            // edge: the centre is pulled onto it by Newton steps below
+            s.newton = true;
+            for (int a = 0; a < 3; ++a) s.x[a] = 0.5 * (s.lo[a] + s.hi[a]);
+            continue;
+        }
+        for (double& m : mass) m /= s.crossings;
+        // Small weight: sharp features stay sharp, flat cells stay centred
+        if (!solveQEF(ata, atb, mass, 0.05 * std::max(planes, 1), s.x)) {
+            for (int a = 0; a < 3; ++a) s.x[a] = mass[a];
+        }
+        double avgLen = std::sqrt(s.avg[0] * s.avg[0] + s.avg[1] * s.avg[1] + s.avg[2] * s.avg[2]);
+        if (planes > 1 && avgLen > 0.0) {
+            double minDot = 1.0;
+            for (int k = 0; k < planes; ++k) {
+                double dot = (normals[k][0] * s.avg[0] + normals[k][1] * s.avg[1] + normals[k][2] * s.avg[2]) / avgLen;
+                minDot = std::min(minDot, dot);
+            }
+            info.curved = minDot < settings_.curvatureCos;
+        }
+    }
+
+    // A few Newton steps, each a batch of the value and the stencil at x
+    std::vector<int> newton;
+    for (int i = 0; i < n; ++i) {
+        if (cells[i].newton) newton.push_back(i);
+    }
+    for (int step = 0; step < 4 && !newton.empty(); ++step) {
+        points.resize(newton.size() * 21);
+        for (size_t j = 0; j < newton.size(); ++j) {
+            const double* x = cells[newton[j]].x;
+            std::copy(x, x + 3, &points[j * 21]);
+            stencil(x, h, &points[j * 21 + 3]);
+        }
+        evaluate(points, values);
+        size_t kept = 0;
+        for (size_t j = 0; j < newton.size(); ++j) {
+            double* x = cells[newton[j]].x;
+            double v = values[j * 7];
+            double g[3];
+            stencilGradient(&values[j * 7 + 1], g);
+            double g2 = g[0] * g[0] + g[1] * g[1] + g[2] * g[2];
+            if (!std::isfinite(v) || !(g2 > 0.0) || !std::isfinite(g2)) continue;
+            // The stencil gives 2h * grad f
+            double scale = v * spacing_ / g2;
+            for (int a = 0; a < 3; ++a) x[a] -= scale * g[a];
+            newton[kept++] = newton[j];
+        }
+        newton.resize(kept);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        Solve& s = cells[i];
+        CellInfo& info = *nodes_[s.node].info;
+        double avgLen = std::sqrt(s.avg[0] * s.avg[0] + s.avg[1] * s.avg[1] + s.avg[2] * s.avg[2]);
+        for (int a = 0; a < 3; ++a) {
+            double x = std::isfinite(s.x[a]) ? std::clamp(s.x[a], s.lo[a], s.hi[a]) : 0.5 * (s.lo[a] + s.hi[a]);
+            info.position[a] = static_cast<float>(x);
+            // Kept as the normal where the field has no gradient at the vertex
+            info.normal[a] = avgLen > 0.0 ? static_cast<float>(s.avg[a] / avgLen) : 0.0f;
+        }
+        info.solved = true;
+    }
+}
+
+void OctreeMesher::shadeCells(const std::vector<int>& indices) {
+    std::vector<CellInfo*> cells;
+    for (int index : indices) {
+        CellInfo* info = nodes_[index].info;
+        if (!info->shaded) cells.push_back(info);
+    }
+    if (cells.empty()) return;
+
+    std::vector<double> points(cells.size() * 18);
+    for (size_t i = 0; i < cells.size(); ++i) {
+        const double x[3] = {cells[i]->position[0], cells[i]->position[1], cells[i]->position[2]};
+        stencil(x, 0.5 * spacing_, &points[i * 18]);
+    }
+    std::vector<double> values;
+    evaluate(points, values);
+    for (size_t i = 0; i < cells.size(); ++i) {
+        CellInfo& info = *cells[i];
+        double g[3];
+        stencilGradient(&values[i * 6], g);
+        double len = std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+        if (len > 0.0 && std::isfinite(len)) {
+            for (int a = 0; a < 3; ++a) info.normal[a] = static_cast<float>(g[a] / len);
+        }
+        info.shaded = true;
+    }
+}
+
+double OctreeMesher::targetSize(const Node& node) const {
+    const double size = (1 << (settings_.maxDepth - node.depth)) * spacing_;
+    double lo[3];
+    worldPosition(node.x, node.y, node.z, lo);
+    double d2 = 0.0, ahead = 0.0;
+    for (int a = 0; a < 3; ++a) {
+        double e = settings_.eye[a];
+        double d = e < lo[a] ? lo[a] - e : (e > lo[a] + size ? e - lo[a] - size : 0.0);
+        d2 += d * d;
+        ahead += (lo[a] + 0.5 * size - e) * settings_.viewDir[a];
+    }
+    double target = std::max(std::sqrt(d2) * settings_.detail, spacing_);
+    // Cells entirely behind the camera only matter once it turns
+    if (ahead < -size) target *= 4.0;
+    return target;
+}
+
+void OctreeMesher::buildLevel(const std::vector<int>& level, std::vector<int>& next) {
+    next.clear();
+    std::vector<int> work;
+    work.reserve(level.size());
+    for (int index : level) {
+        Node& node = nodes_[index];
+        // Outside the band around the previous surface: assumed empty, not sampled
+        if (useBand_ && !inBand(node)) continue;
+        node.info = &cell(node);
+        work.push_back(index);
+    }
+    sampleCorners(work);
+
+    // bit 0: sign change, bit 1: surface may pass through, bit 2: f unbounded
+    const int count = static_cast<int>(work.size());
+    std::vector<unsigned char> state(count, 0);
+    #pragma omp parallel for schedule(dynamic, 16) if(count > kParallelCells)
+    for (int w = 0; w < count; ++w) {
+        Node& node = nodes_[work[w]];
+        CellInfo& info = *node.info;
+        for (int c = 0; c < 8; ++c) {
+            if (!std::isfinite(info.corner[c])) node.invalid |= 1 << c;
+            else if (info.corner[c] < 0.0) node.inside |= 1 << c;
+        }
+        unsigned char valid = static_cast<unsigned char>(~node.invalid);
+        bool signChange = node.inside != 0 && node.inside != valid;
+
+        bool active = signChange;
+        bool unbounded = false;
+        if (!active && bound_) {
+            if (info.active < 0) {
+                const int size = 1 << (settings_.maxDepth - node.depth);
+                double lo[3], hi[3];
+                worldPosition(node.x, node.y, node.z, lo);
+                worldPosition(node.x + size, node.y + size, node.z + size, hi);
+                std::pair<double, double> range(-INFINITY, INFINITY);
+                try {
+                    range = bound_(lo, hi);
+                } catch (...) {
+                }
+                if (range.first > 0.0 || range.second < 0.0) info.active = 0;
+                else info.active = std::isfinite(range.first) || std::isfinite(range.second) ? 1 : 2;
+            }
+            active = info.active > 0;
+            unbounded = info.active == 2;
+        }
+        state[w] = (signChange ? 1 : 0) | (active ? 2 : 0) | (unbounded ? 4 : 0);
+    }
+
+    // 1: split; 2: split only if the surface bends, which needs the cell solved
+    std::vector<unsigned char> split(count, 0);
+    std::vector<int> curvature;
+    // Without a bound, only a sign change says where the surface is; below
+    // this depth a cell without one would be refined blindly
+    const int unboundedDepth = std::max(settings_.minDepth, std::min(kUnboundedDepth, settings_.maxDepth));
+    size_t splits = 0;
+    for (int w = 0; w < count; ++w) {
+        const Node& node = nodes_[work[w]];
+        if (!(state[w] & 2)) continue;
+        if ((state[w] & 4) && node.depth >= unboundedDepth) continue;
+        if (node.depth < settings_.minDepth) {
+            split[w] = 1;
+        } else if (node.depth < settings_.maxDepth) {
+            double size = (1 << (settings_.maxDepth - node.depth)) * spacing_;
+            double target = targetSize(node);
+            if (size > target) {
+                split[w] = 1;
+            } else if ((state[w] & 1) && size > target / (1 << kCurvatureLevels)) {
+                split[w] = 2;
+                curvature.push_back(work[w]);
+            }
+        }
+        if (split[w] == 1) ++splits;
+    }
+    if (nodes_.size() + 8 * splits > kMaxNodes) {
+        // Too fine for the node budget: this level's cells stay leaves
+        lastBuildTruncated_ = true;
+        std::fill(split.begin(), split.end(), 0);
+        curvature.clear();
+    }
+    solveCells(curvature);
+    for (int index : curvature) {
+        if (nodes_[index].info->curved) ++splits;
+    }
+    if (nodes_.size() + 8 * splits > kMaxNodes) {
+        lastBuildTruncated_ = true;
+        std::replace(split.begin(), split.end(), 2, 0);
+    }
+
+    for (int w = 0; w < count; ++w) {
+        const int index = work[w];
+        if (!(state[w] & 2)) continue;
+        if (split[w] == 1 || (split[w] == 2 && nodes_[index].info->curved)) {
+            const int firstChild = static_cast<int>(nodes_.size());
+            nodes_[index].firstChild = firstChild;
+            const Node parent = nodes_[index];
+            const int half = (1 << (settings_.maxDepth - parent.depth)) / 2;
+            for (int c = 0; c < 8; ++c) {
+                Node child;
+                child.x = parent.x + ((c >> 2) & 1) * half;
+                child.y = parent.y + ((c >> 1) & 1) * half;
+                child.z = parent.z + (c & 1) * half;
+                child.depth = parent.depth + 1;
+                child.parent = index;
+                nodes_.push_back(child);
+                next.push_back(firstChild + c);
+            }
+            continue;
+        }
+
+        // The vertex itself is solved once the whole tree is known
+        ++leafCount_;
+        if (state[w] & 1) surfaceLeaves_.push_back(index);
+        if (!nodes_[index].invalid) {
+            LeafVertex vertex;
+            vertex.node = index;
+            nodes_[index].leaf = static_cast<int>(leaves_.size());
+            leaves_.push_back(vertex);
+        }
+    }
+}
+
+void OctreeMesher::build(const OctreeMeshSettings& settings, IndexedMesh& mesh) {
+    mesh.clear();
+    const OctreeMeshSettings& b = settings_;
+    bool sameLattice = built_ && settings.halfSize == b.halfSize && settings.maxDepth == b.maxDepth &&
+                       settings.center[0] == b.center[0] && settings.center[1] == b.center[1] &&
+                       settings.center[2] == b.center[2] && settings.curvatureCos == b.curvatureCos;
+    if (!sameLattice || cells_.size() > kMaxCachedCells) cells_.clear();
+    evaluations_ = 0;
+
+    settings_ = settings;
+    settings_.maxDepth = std::clamp(settings.maxDepth, 1, kMaxDepth);
+    settings_.minDepth = std::clamp(settings.minDepth, 0, settings_.maxDepth);
+    spacing_ = 2.0 * settings_.halfSize / (1 << settings_.maxDepth);
+    built_ = true;
+
+    lastBuildIncremental_ = false;
+    lastBuildTruncated_ = false;
+    nodes_.clear();
+    leaves_.clear();
+    surfaceLeaves_.clear();
+    leafCount_ = 0;
+    if (!f_ || !(settings_.halfSize > 0.0)) return;
+
+    const double lattice[5] = {settings_.center[0], settings_.center[1], settings_.center[2],
+                               settings_.halfSize, static_cast<double>(settings_.maxDepth)};
+    bandDepth_ = std::max(settings_.maxDepth - kBandLevels, 0);
+    useBand_ = coherent_ && !band_.empty() && incrementalBuilds_ < kMaxIncrementalBuilds &&
+               std::equal(lattice, lattice + 5, bandLattice_);
+    coherent_ = false;
+
+    buildTree(mesh);
+    if (useBand_ && !updateBand(true)) {
+        // The surface escaped the band: redo the whole tree. Samples and
+        // cells visited so far are cached and not evaluated again.
+        useBand_ = false;
+        buildTree(mesh);
+    }
+    if (useBand_) {
+        ++incrementalBuilds_;
+    } else {
+        updateBand(false);
+        incrementalBuilds_ = 0;
+    }
+    lastBuildIncremental_ = useBand_;
+    useBand_ = false;
+    std::copy(lattice, lattice + 5, bandLattice_);
+    optimizeVertexCache(mesh);
+}
+
+void OctreeMesher::buildTree(IndexedMesh& mesh) {
+    mesh.clear();
+    nodes_.clear();
+    leaves_.clear();
+    surfaceLeaves_.clear();
+    leafCount_ = 0;
+    nodes_.emplace_back();
+    std::vector<int> level = {0}, next;
+    while (!level.empty()) {
+        buildLevel(level, next);
+        level.swap(next);
+    }
+
+    // Collect the quads first: only leaves a quad uses get a vertex, so only
+    // those are solved, all in one batch, before the mesh is written
+    std::vector<EdgeQuad> quads;
+    cellProc(0, quads);
+    std::vector<int> vertexNodes;
+    for (const EdgeQuad& quad : quads) {
+        for (int leaf : quad.leaf) {
+            LeafVertex& vertex = leaves_[leaf];
+            if (vertex.outputIndex >= 0) continue;
+            vertex.outputIndex = static_cast<int>(vertexNodes.size());
+            vertexNodes.push_back(vertex.node);
+        }
+    }
+    solveCells(vertexNodes);
+    shadeCells(vertexNodes);
+
+    mesh.vertices.reserve(vertexNodes.size() * 6);
+    for (int index : vertexNodes) {
+        const CellInfo& info = *nodes_[index].info;
+        mesh.vertices.insert(mesh.vertices.end(), info.position, info.position + 3);
+        mesh.vertices.insert(mesh.vertices.end(), info.normal, info.normal + 3);
+    }
+    mesh.indices.reserve(quads.size() * 6);
+    for (const EdgeQuad& quad : quads) {
+        int v[4];
+        for (int j = 0; j < 4; ++j) v[j] = leaves_[quad.leaf[j]].outputIndex;
+        // Quad split along 0-3, wound so that the face points to f > 0
+        const int* order = quadTriangles[quad.firstInside ? 1 : 0];
+        for (int t = 0; t < 6; t += 3) {
+            int a = v[order[t]], b = v[order[t + 1]], c = v[order[t + 2]];
+            // A coarse cell can appear twice around an edge: keep the triangle
+            // only if it is not degenerate
+            if (a == b || b == c || a == c) continue;
+            mesh.indices.push_back(static_cast<unsigned int>(a));
+            mesh.indices.push_back(static_cast<unsigned int>(b));
+            mesh.indices.push_back(static_cast<unsigned int>(c));
+        }
+    }
+}
+
+void OctreeMesher::cellProc(int n, std::vector<EdgeQuad>& quads) {
+    const int first = nodes_[n].firstChild;
+    if (first < 0) return;
+
+    for (int c = 0; c < 8; ++c) cellProc(first + c, quads);
+    for (const auto& face : cellProcFaceMask) {
+        faceProc(first + face[0], first + face[1], face[2], quads);
+    }
+    for (const auto& edge : cellProcEdgeMask) {
+        const int around[4] = {first + edge[0], first + edge[1], first + edge[2], first + edge[3]};
+        edgeProc(around, edge[4], quads);
+    }
+}
+
+void OctreeMesher::faceProc(int n0, int n1, int dir, std::vector<EdgeQuad>& quads) {
+    const int pair[2] = {n0, n1};
+    if (nodes_[n0].firstChild < 0 && nodes_[n1].firstChild < 0) return;
+
+    auto child = [&](int n, int c) { return nodes_[n].firstChild < 0 ? n : nodes_[n].firstChild + c; };
+    for (const auto& face : faceProcFaceMask[dir]) {
+        faceProc(child(n0, face[0]), child(n1, face[1]), face[2], quads);
+    }
+
+    static const int orders[2][4] = {{0, 0, 1, 1}, {0, 1, 0, 1}};
+    for (const auto& edge : faceProcEdgeMask[dir]) {
+        const int* order = orders[edge[0]];
+        int around[4];
+        for (int j = 0; j < 4; ++j) around[j] = child(pair[order[j]], edge[1 + j]);
+        edgeProc(around, edge[5], quads);
+    }
+}
+
+void OctreeMesher::edgeProc(const int n[4], int dir, std::vector<EdgeQuad>& quads) {
+    bool allLeaves = true;
+    for (int j = 0; j < 4; ++j) allLeaves = allLeaves && nodes_[n[j]].firstChild < 0;
+    if (allLeaves) {
+        processEdge(n, dir, quads);
+        return;
+    }
+
+    for (const auto& edge : edgeProcEdgeMask[dir]) {
+        int around[4];
+        for (int j = 0; j < 4; ++j) {
+            around[j] = nodes_[n[j]].firstChild < 0 ? n[j] : nodes_[n[j]].firstChild + edge[j];
+        }
+        edgeProc(around, edge[4], quads);
+    }
+}
+
+void OctreeMesher::processEdge(const int n[4], int dir, std::vector<EdgeQuad>& quads) {
+    // The smallest cell holds the actual (minimal) edge and decides the sign
+    int finest = 0;
+    for (int j = 0; j < 4; ++j) {
+        if (nodes_[n[j]].leaf < 0) return;
+        if (nodes_[n[j]].depth > nodes_[n[finest]].depth) finest = j;
+    }
+    const Node& node = nodes_[n[finest]];
+    const int edge = processEdgeMask[dir][finest];
+    const unsigned bit0 = 1u << edgeCorners[edge][0];
+    const unsigned bit1 = 1u << edgeCorners[edge][1];
+    if (node.invalid & (bit0 | bit1)) return;
+    const bool in0 = (node.inside & bit0) != 0;
+    const bool in1 = (node.inside & bit1) != 0;
+    if (in0 == in1) return;
+
+    EdgeQuad quad;
+    for (int j = 0; j < 4; ++j) quad.leaf[j] = nodes_[n[j]].leaf;
+    quad.firstInside = in0;
+    quads.push_back(quad);
+}
+
+OctreeMeshSettings cameraMeshSettings(const double eye[3], const double target[3], double precision) {
+    OctreeMeshSettings settings;
+    // The centre snaps to half the cube so small pans keep the sample
+    // lattice (and its cache). The finest level (64 cells per axis of the ±3
+    // cube at precision 1) is only reached near the camera or where the
+    // surface bends.
+    double dir[3], distance = 0.0;
+    for (int a = 0; a < 3; ++a) {
+        dir[a] = target[a] - eye[a];
+        distance += dir[a] * dir[a];
+    }
+    distance = std::sqrt(distance);
+    int grow = std::max(0, static_cast<int>(std::ceil(std::log2(distance / 8.0))));
+    settings.halfSize = 3.0 * (1 << grow);
+    double snap = 0.5 * settings.halfSize;
+    for (int a = 0; a < 3; ++a) {
+        settings.center[a] = std::round(target[a] / snap) * snap;
+        settings.eye[a] = eye[a];
+        settings.viewDir[a] = distance > 0.0 ? dir[a] / distance : (a == 2 ? -1.0 : 0.0);
+    }
+
+    int extraLevels = static_cast<int>(std::lround(std::log2(std::max(precision, 0.125))));
+    settings.maxDepth = std::clamp(6 + extraLevels + grow, 4, 12);
+    settings.detail = 0.02 / precision;
+    return settings;
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,174 @@
+#include "mesh/SurfaceMesh.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace ArchMaths {
+
+namespace {
+
+std::atomic<uint64_t> nextRevision{1};
+
+int16_t toSnorm16(float v) {
+    return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+// 16-bit positions keep ~1/65535 of each axis range. Heights are quantized
+// over the tile's own height range, so a height step is range / 65535; at a
+// ratio of 16 that is ~1/80 of a grid cell of a 50-sample tile. Larger
+// ratios (1000 gave steps near a whole cell) stair-step on gentle slopes.
+constexpr double kMaxQuantizedAspect = 16.0;
+
+} // namespace
+
+void encodeOctahedral(float nx, float ny, float nz, int16_t out[2]) {
+    float l1 = std::abs(nx) + std::abs(ny) + std::abs(nz);
+    if (l1 <= 0.0f) { out[0] = 0; out[1] = 0; return; }
+    float u = nx / l1, v = ny / l1;
+    if (nz < 0.0f) {
+        float fu = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float fv = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = fu;
+        v = fv;
+    }
+    out[0] = toSnorm16(u);
+    out[1] = toSnorm16(v);
+}
+
+void SurfaceMesh::triangulate(const std::vector<std::vector<double>>& zGrid,
+                              const std::vector<double>& xVals,
+                              const std::vector<double>& yVals,
+                              int apron,
+                              IndexedMesh& mesh) {
+    mesh.clear();
+    const int nx = static_cast<int>(xVals.size());
+    const int ny = static_cast<int>(yVals.size());
+    if (apron < 0 || nx < 2 * apron + 2 || ny < 2 * apron + 2 || static_cast<int>(zGrid.size()) < ny) return;
+    const int i0 = apron, i1 = nx - 1 - apron;
+    const int j0 = apron, j1 = ny - 1 - apron;
+
+    auto z = [&](int i, int j) { return zGrid[j][i]; };
+    auto finite = [&](int i, int j) { return std::isfinite(z(i, j)); };
+    auto cellKept = [&](int i, int j) {
+        return finite(i, j) && finite(i + 1, j) && finite(i, j + 1) && finite(i + 1, j + 1);
+    };
+
+    // A node gets a vertex only if some cell using it is kept
+    std::vector<char> used(static_cast<size_t>(nx) * ny, 0);
+    size_t cellCount = 0;
+    for (int j = j0; j < j1; ++j) {
+        for (int i = i0; i < i1; ++i) {
+            if (!cellKept(i, j)) continue;
+            used[j * nx + i] = used[j * nx + i + 1] = used[(j + 1) * nx + i] = used[(j + 1) * nx + i + 1] = 1;
+            ++cellCount;
+        }
+    }
+
+    // Central differences where both neighbours are finite, one-sided otherwise
+    auto slope = [&](int i, int j, int di, int dj, const std::vector<double>& coord, int c) {
+        bool hasNext = c + 1 < static_cast<int>(coord.size()) && finite(i + di, j + dj);
+        bool hasPrev = c > 0 && finite(i - di, j - dj);
+        if (hasNext && hasPrev) return (z(i + di, j + dj) - z(i - di, j - dj)) / (coord[c + 1] - coord[c - 1]);
+        if (hasNext) return (z(i + di, j + dj) - z(i, j)) / (coord[c + 1] - coord[c]);
+        if (hasPrev) return (z(i, j) - z(i - di, j - dj)) / (coord[c] - coord[c - 1]);
+        return 0.0;
+    };
+
+    // GL axes: (x, z, y)
+    std::vector<int> vertexId(used.size(), -1);
+    for (int j = j0; j <= j1; ++j) {
+        for (int i = i0; i <= i1; ++i) {
+            if (!used[j * nx + i]) continue;
+            vertexId[j * nx + i] = static_cast<int>(mesh.vertexCount());
+            double dzdx = slope(i, j, 1, 0, xVals, i);
+            double dzdy = slope(i, j, 0, 1, yVals, j);
+            double len = std::sqrt(dzdx * dzdx + 1.0 + dzdy * dzdy);
+            const float v[6] = {static_cast<float>(xVals[i]), static_cast<float>(z(i, j)), static_cast<float>(yVals[j]),
+                                static_cast<float>(-dzdx / len), static_cast<float>(1.0 / len),
+                                static_cast<float>(-dzdy / len)};
+            mesh.vertices.insert(mesh.vertices.end(), v, v + 6);
+        }
+    }
+
+    // Row-major cell order is already local for the vertex cache
+    mesh.indices.reserve(cellCount * 6);
+    for (int j = j0; j < j1; ++j) {
+        for (int i = i0; i < i1; ++i) {
+            if (!cellKept(i, j)) continue;
+            int v00 = vertexId[j * nx + i];
+            int v10 = vertexId[j * nx + i + 1];
+            int v01 = vertexId[(j + 1) * nx + i];
+            int v11 = vertexId[(j + 1) * nx + i + 1];
+            const unsigned int tri[6] = {static_cast<unsigned int>(v00), static_cast<unsigned int>(v10),
+                                         static_cast<unsigned int>(v01), static_cast<unsigned int>(v10),
+                                         static_cast<unsigned int>(v11), static_cast<unsigned int>(v01)};
+            mesh.indices.insert(mesh.indices.end(), tri, tri + 6);
+        }
+    }
+}
+
+uint64_t SurfaceMesh::newRevision() {
+    return nextRevision++;
+}
+
+std::shared_ptr<PackedMesh> SurfaceMesh::pack(const IndexedMesh& source, bool positions16) {
+    auto mesh = std::make_shared<PackedMesh>();
+    mesh->revision = newRevision();
+    mesh->vertexCount = source.vertexCount();
+    if (mesh->vertexCount == 0) return mesh;
+
+    double lo[3] = {INFINITY, INFINITY, INFINITY};
+    double hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (size_t v = 0; v < mesh->vertexCount; ++v) {
+        for (int a = 0; a < 3; ++a) {
+            lo[a] = std::min(lo[a], static_cast<double>(source.vertices[v * 6 + a]));
+            hi[a] = std::max(hi[a], static_cast<double>(source.vertices[v * 6 + a]));
+        }
+    }
+    // Height is GL y; the domain spans GL x and z
+    double domain = std::max(hi[0] - lo[0], hi[2] - lo[2]);
+    mesh->positions16 = positions16 && (hi[1] - lo[1]) <= kMaxQuantizedAspect * domain;
+
+    for (int a = 0; a < 3; ++a) {
+        mesh->center[a] = mesh->positions16 ? static_cast<float>(0.5 * (lo[a] + hi[a])) : 0.0f;
+        mesh->extent[a] = mesh->positions16 ? static_cast<float>(std::max(0.5 * (hi[a] - lo[a]), 1e-12)) : 1.0f;
+    }
+    mesh->normalOffset = mesh->positions16 ? 8 : 12;
+    mesh->stride = mesh->normalOffset + 4;
+    mesh->vertices.resize(mesh->vertexCount * mesh->stride);
+
+    for (size_t v = 0; v < mesh->vertexCount; ++v) {
+        const float* src = &source.vertices[v * 6];
+        unsigned char* dst = &mesh->vertices[v * mesh->stride];
+        if (mesh->positions16) {
+            int16_t q[4] = {0, 0, 0, 0};
+            for (int a = 0; a < 3; ++a) q[a] = toSnorm16((src[a] - mesh->center[a]) / mesh->extent[a]);
+            std::memcpy(dst, q, sizeof(q));
+        } else {
+            std::memcpy(dst, src, 3 * sizeof(float));
+        }
+        int16_t normal[2];
+        encodeOctahedral(src[3], src[4], src[5], normal);
+        std::memcpy(dst + mesh->normalOffset, normal, sizeof(normal));
+    }
+
+    if (mesh->vertexCount <= 0xFFFF) {
+        mesh->indices16.assign(source.indices.begin(), source.indices.end());
+    } else {
+        mesh->indices32.assign(source.indices.begin(), source.indices.end());
+    }
+    return mesh;
+}
+
+std::shared_ptr<PackedMesh> SurfaceMesh::build(const std::vector<std::vector<double>>& zGrid,
+                                               const std::vector<double>& xVals,
+                                               const std::vector<double>& yVals,
+                                               bool positions16,
+                                               int apron) {
+    IndexedMesh mesh;
+    triangulate(zGrid, xVals, yVals, apron, mesh);
+    return pack(mesh, positions16);
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,160 @@
+#include "profile/Profiler.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+namespace ArchMaths {
+
+namespace {
+
+const char* const kStageNames[] = {"parse", "compile", "evaluate", "mesh", "upload", "draw"};
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The innermost open scope on this thread
+thread_local ProfileScope* currentScope = nullptr;
+
+} // namespace
+
+const char* stageName(ProfileStage stage) {
+    int index = static_cast<int>(stage);
+    return index >= 0 && index < static_cast<int>(ProfileStage::Count) ? kStageNames[index] : "unknown";
+}
+
+double FrameProfile::totalMs() const {
+    double total = 0.0;
+    for (double ms : stageMs) total += ms;
+    return total;
+}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : epochNs_(steadyNs())
+{
+}
+
+int64_t Profiler::nowNs() const {
+    return steadyNs() - epochNs_;
+}
+
+void Profiler::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (enabled && !enabled_.load(std::memory_order_relaxed)) {
+        // Time spent disabled is not part of the first frame
+        current_ = FrameProfile();
+        frameStartNs_ = nowNs();
+    }
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+int Profiler::threadIndex() {
+    auto [it, inserted] = threads_.try_emplace(std::this_thread::get_id(), static_cast<int>(threads_.size()));
+    return it->second;
+}
+
+void Profiler::pushEvent(const TraceEvent& event) {
+    if (events_.size() >= kMaxTraceEvents) events_.pop_front();
+    events_.push_back(event);
+}
+
+void Profiler::record(ProfileStage stage, int entry, int64_t startNs, int64_t durationNs, int64_t exclusiveNs) {
+    if (!enabled()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    pushEvent(TraceEvent{'X', static_cast<int>(stage), entry, threadIndex(), startNs, durationNs, {}});
+    current_.stageMs[static_cast<int>(stage)] += exclusiveNs / 1e6;
+}
+
+void Profiler::count(int entry, uint64_t samples, uint64_t vertices, uint64_t bytes) {
+    if (!enabled()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    EntryCounters& counters = current_.entries[entry];
+    counters.samples += samples;
+    counters.vertices += vertices;
+    counters.bytes += bytes;
+    pushEvent(TraceEvent{'C', -1, entry, threadIndex(), nowNs(), 0, EntryCounters{samples, vertices, bytes}});
+}
+
+void Profiler::endFrame() {
+    if (!enabled()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t now = nowNs();
+    current_.intervalMs = (now - frameStartNs_) / 1e6;
+    pushEvent(TraceEvent{'X', -1, -1, threadIndex(), frameStartNs_, now - frameStartNs_, {}});
+    if (frames_.size() >= kMaxFrames) frames_.pop_front();
+    frames_.push_back(std::move(current_));
+    current_ = FrameProfile();
+    frameStartNs_ = now;
+}
+
+std::vector<FrameProfile> Profiler::recentFrames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::vector<FrameProfile>(frames_.begin(), frames_.end());
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.clear();
+    frames_.clear();
+    current_ = FrameProfile();
+    frameStartNs_ = nowNs();
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Timestamps and durations are in microseconds
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"ArchMaths\"}}";
+    for (const auto& [id, index] : threads_) {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << index
+            << ",\"args\":{\"name\":\"thread " << index << "\"}}";
+    }
+    for (const TraceEvent& event : events_) {
+        out << ",\n{\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.startNs / 1e3;
+        if (event.phase == 'C') {
+            out << ",\"ph\":\"C\",\"name\":\"entry " << event.entry << "\",\"args\":{\"samples\":"
+                << event.counters.samples << ",\"vertices\":" << event.counters.vertices
+                << ",\"bytes\":" << event.counters.bytes << "}}";
+        } else if (event.stage < 0) {
+            out << ",\"ph\":\"X\",\"name\":\"frame\",\"cat\":\"frame\",\"dur\":" << event.durationNs / 1e3 << "}";
+        } else {
+            const char* name = kStageNames[event.stage];
+            out << ",\"ph\":\"X\",\"name\":\"" << name << "\",\"cat\":\"" << name
+                << "\",\"dur\":" << event.durationNs / 1e3 << ",\"args\":{\"entry\":" << event.entry << "}}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(out);
+}
+
+ProfileScope::ProfileScope(ProfileStage stage, int entry)
+    : stage_(stage)
+    , entry_(entry)
+    , active_(Profiler::instance().enabled())
+{
+    if (!active_) return;
+    parent_ = currentScope;
+    currentScope = this;
+    startNs_ = Profiler::instance().nowNs();
+}
+
+ProfileScope::~ProfileScope() {
+    if (!active_) return;
+    Profiler& profiler = Profiler::instance();
+    int64_t duration = profiler.nowNs() - startNs_;
+    currentScope = parent_;
+    if (parent_) parent_->childNs_ += duration;
+    profiler.record(stage_, entry_, startNs_, duration, duration - childNs_);
+}
+
+} // namespace ArchMaths
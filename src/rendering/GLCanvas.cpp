@@ -1,59 +1,128 @@
 #include "rendering/GLCanvas.h"
+#include "rendering/GLSLCompiler.h"
+#include "math/ExprHash.h"
+#include "mesh/SurfaceMesh.h"
+#include "profile/Profiler.h"
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QPainter>
+#include <algorithm>
 #include <cmath>
 #include <sstream>
-#include <iostream>
+#include <QDebug>
 
 namespace ArchMaths {
 
-// Compile expression tree to GLSL code
-std::string compileToGLSL(const ExprNodePtr& node) {
-    if (!node) return "0.0";
-
-    switch (node->type) {
-        case NodeType::Number: {
-            std::ostringstream oss;
-            oss << std::fixed << node->value;
-            return oss.str();
-        }
-        case NodeType::Variable:
-            return node->name;
-        case NodeType::BinaryOp: {
-            std::string l = compileToGLSL(node->left);
-            std::string r = compileToGLSL(node->right);
-            if (node->op == "^") {
-                // GLSL pow() is undefined for negative base - use x*x for ^2
-                if (node->right && node->right->type == NodeType::Number && node->right->value == 2.0) {
-                    return "(" + l + "*" + l + ")";
-                }
-                return "pow(abs(" + l + ")," + r + ")";
-            }
-            return "(" + l + node->op + r + ")";
-        }
-        case NodeType::UnaryOp:
-            return "(" + node->op + compileToGLSL(node->left) + ")";
-        case NodeType::Function: {
-            std::string args;
-            for (size_t i = 0; i < node->args.size(); ++i) {
-                if (i > 0) args += ",";
-                args += compileToGLSL(node->args[i]);
-            }
-            std::string fn = node->name;
-            if (fn == "ln") fn = "log";
-            return fn + "(" + args + ")";
-        }
-        default:
-            return "0.0";
-    }
+namespace {
+
+#ifdef WASM_BUILD
+constexpr GLSLDialect kShaderDialect = GLSLDialect::GLSL300ES;
+#else
+constexpr GLSLDialect kShaderDialect = GLSLDialect::GLSL100;
+#endif
+
+// Full-screen quad for implicit rendering
+#ifdef WASM_BUILD
+const char* kImplicitVertexSource = R"(#version 300 es
+precision highp float;
+in vec2 aPos;
+out vec2 vPos;
+void main() {
+    vPos = aPos;
+    gl_Position = vec4(aPos, 0.0, 1.0);
+}
+)";
+#else
+const char* kImplicitVertexSource = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec2 aPos;
+varying vec2 vPos;
+void main() {
+    vPos = aPos;
+    gl_Position = vec4(aPos, 0.0, 1.0);
+}
+)";
+#endif
+
+// Explicit curves: samples outside the finite range or far off-screen are
+// flagged so the segments touching them are discarded
+#ifdef WASM_BUILD
+const char* kExplicitFragmentSource = R"(#version 300 es
+precision highp float;
+in float vValid;
+uniform vec4 color;
+out vec4 FragColor;
+void main() {
+    if (vValid < 0.999) discard;
+    FragColor = color;
+}
+)";
+#else
+const char* kExplicitFragmentSource = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+varying float vValid;
+uniform vec4 color;
+void main() {
+    if (vValid < 0.999) discard;
+    gl_FragColor = color;
+}
+)";
+#endif
+
+// GPU surfaces: same lighting as surface3DShader_, plus discarding the
+// fragments of cells that touch a non-finite sample
+#ifdef WASM_BUILD
+const char* kSurfaceFragmentSource = R"(#version 300 es
+precision highp float;
+uniform vec4 color;
+uniform vec3 lightDir;
+in vec3 vNormal;
+in float vValid;
+out vec4 FragColor;
+void main() {
+    if (vValid < 0.999) discard;
+    vec3 norm = normalize(vNormal);
+    float diff = abs(dot(norm, normalize(lightDir)));
+    float ambient = 0.3;
+    float lighting = ambient + (1.0 - ambient) * diff;
+    FragColor = vec4(color.rgb * lighting, color.a);
+}
+)";
+#else
+const char* kSurfaceFragmentSource = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+uniform vec4 color;
+uniform vec3 lightDir;
+varying vec3 vNormal;
+varying float vValid;
+void main() {
+    if (vValid < 0.999) discard;
+    vec3 norm = normalize(vNormal);
+    float diff = abs(dot(norm, normalize(lightDir)));
+    float ambient = 0.3;
+    float lighting = ambient + (1.0 - ambient) * diff;
+    gl_FragColor = vec4(color.rgb * lighting, color.a);
 }
+)";
+#endif
+
+} // namespace
 
 GLCanvas::GLCanvas(QWidget* parent)
     : QOpenGLWidget(parent)
     , gridVBO_(QOpenGLBuffer::VertexBuffer)
     , axesVBO_(QOpenGLBuffer::VertexBuffer)
     , quadVBO_(QOpenGLBuffer::VertexBuffer)
+    , explicitSampleVBO_(QOpenGLBuffer::VertexBuffer)
+    , tubeRingVBO_(QOpenGLBuffer::VertexBuffer)
+    , surfaceGridVBO_(QOpenGLBuffer::VertexBuffer)
+    , surfaceGridIBO_(QOpenGLBuffer::IndexBuffer)
 {
     setMouseTracking(true);
     setFocusPolicy(Qt::StrongFocus);
@@ -73,6 +142,15 @@ GLCanvas::~GLCanvas() {
     for (auto& ibo : plot3DIBOs_) {
         ibo.destroy();
     }
+    for (auto& item : packedBuffers_) {
+        item.second.vbo.destroy();
+        item.second.ibo.destroy();
+    }
+    generatedPrograms_.clear();
+    explicitSampleVBO_.destroy();
+    tubeRingVBO_.destroy();
+    surfaceGridVBO_.destroy();
+    surfaceGridIBO_.destroy();
     vao_.destroy();
     doneCurrent();
 }
@@ -97,9 +175,36 @@ void GLCanvas::initializeGL() {
     // Full-screen quad for implicit rendering
     float quadVertices[] = {-1, -1, 1, -1, -1, 1, 1, 1};
     quadVBO_.bind();
-    quadVBO_.allocate(quadVertices, sizeof(quadVertices));
+    uploadBuffer(quadVBO_, quadVertices, sizeof(quadVertices));
     quadVBO_.release();
 
+    // Sample indices for GPU-evaluated explicit curves
+    std::vector<float> sampleIndices(kMaxExplicitSamples);
+    for (int i = 0; i < kMaxExplicitSamples; ++i) {
+        sampleIndices[i] = static_cast<float>(i);
+    }
+    explicitSampleVBO_.create();
+    explicitSampleVBO_.bind();
+    uploadBuffer(explicitSampleVBO_, sampleIndices.data(), static_cast<int>(sampleIndices.size() * sizeof(float)));
+    explicitSampleVBO_.release();
+
+    // Ring of a tube segment as a triangle strip: (angle, start/end)
+    std::vector<float> ring;
+    for (int k = 0; k <= kTubeSides; ++k) {
+        float angle = static_cast<float>(2.0 * M_PI * k / kTubeSides);
+        ring.insert(ring.end(), {angle, 0.0f, angle, 1.0f});
+    }
+    tubeRingVBO_.create();
+    tubeRingVBO_.bind();
+    uploadBuffer(tubeRingVBO_, ring.data(), static_cast<int>(ring.size() * sizeof(float)));
+    tubeRingVBO_.release();
+
+    // Instanced tubes need vertex attribute divisors (GLES 3.0 / OpenGL 3.3)
+    QSurfaceFormat format = context()->format();
+    instancedTubes_ = context()->isOpenGLES()
+        ? format.majorVersion() >= 3
+        : format.majorVersion() > 3 || (format.majorVersion() == 3 && format.minorVersion() >= 3);
+
     vao_.release();
 }
 
@@ -230,6 +335,154 @@ void main() {
     surface3DShader_->bindAttributeLocation("aPos", 0);
     surface3DShader_->bindAttributeLocation("aNormal", 1);
     surface3DShader_->link();
+
+    // Compact surface meshes: snorm16 or float positions scaled by the
+    // mesh bounds, octahedral-encoded normals
+#ifdef WASM_BUILD
+    const char* packedVertSrc = R"(#version 300 es
+precision highp float;
+in vec3 aPos;
+in vec2 aNormal;
+uniform mat4 mvp;
+uniform mat4 model;
+uniform vec3 posCenter;
+uniform vec3 posExtent;
+out vec3 vNormal;
+out vec3 vPos;
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+void main() {
+    vec3 pos = posCenter + posExtent * aPos;
+    vPos = vec3(model * vec4(pos, 1.0));
+    vNormal = mat3(model) * octDecode(aNormal);
+    gl_Position = mvp * vec4(pos, 1.0);
+}
+)";
+#else
+    const char* packedVertSrc = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec3 aPos;
+attribute vec2 aNormal;
+uniform mat4 mvp;
+uniform mat4 model;
+uniform vec3 posCenter;
+uniform vec3 posExtent;
+varying vec3 vNormal;
+varying vec3 vPos;
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+void main() {
+    vec3 pos = posCenter + posExtent * aPos;
+    vPos = vec3(model * vec4(pos, 1.0));
+    vNormal = mat3(model) * octDecode(aNormal);
+    gl_Position = mvp * vec4(pos, 1.0);
+}
+)";
+#endif
+
+    packedSurfaceShader_ = std::make_unique<QOpenGLShaderProgram>();
+    packedSurfaceShader_->addShaderFromSourceCode(QOpenGLShader::Vertex, packedVertSrc);
+    packedSurfaceShader_->addShaderFromSourceCode(QOpenGLShader::Fragment, fragSrc);
+    packedSurfaceShader_->bindAttributeLocation("aPos", 0);
+    packedSurfaceShader_->bindAttributeLocation("aNormal", 1);
+    packedSurfaceShader_->link();
+
+    // Tubes around parametric curves: one instance per curve segment reads
+    // the segment and its two neighbours, the ring vertex picks an end and an
+    // angle. The frame at a point depends only on that point's tangent and
+    // the eye, so adjacent segments share their rings exactly; it turns with
+    // the view, so any twist happens where the tube points at the camera.
+#ifdef WASM_BUILD
+    const char* tubeVertSrc = R"(#version 300 es
+precision highp float;
+in vec2 aRing;
+in vec3 aPrev;
+in vec3 aStart;
+in vec3 aEnd;
+in vec3 aNext;
+uniform mat4 mvp;
+uniform mat4 model;
+uniform vec3 eye;
+uniform float radius;
+out vec3 vNormal;
+out vec3 vPos;
+vec3 direction(vec3 from, vec3 to, vec3 fallback) {
+    vec3 d = to - from;
+    return dot(d, d) > 1e-24 ? normalize(d) : fallback;
+}
+void main() {
+    vec3 segment = direction(aStart, aEnd, vec3(0.0, 0.0, 1.0));
+    bool atEnd = aRing.y > 0.5;
+    vec3 center = atEnd ? aEnd : aStart;
+    vec3 tangent = atEnd ? direction(aStart, aNext, segment) : direction(aPrev, aEnd, segment);
+    vec3 toEye = eye - center;
+    vec3 side = cross(tangent, toEye);
+    if (dot(side, side) < 1e-6 * dot(toEye, toEye)) side = cross(tangent, abs(tangent.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0));
+    side = normalize(side);
+    vec3 up = cross(side, tangent);
+    vec3 normal = cos(aRing.x) * side + sin(aRing.x) * up;
+    vec3 pos = center + radius * normal;
+    vPos = vec3(model * vec4(pos, 1.0));
+    vNormal = mat3(model) * normal;
+    gl_Position = mvp * vec4(pos, 1.0);
+}
+)";
+#else
+    const char* tubeVertSrc = R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec2 aRing;
+attribute vec3 aPrev;
+attribute vec3 aStart;
+attribute vec3 aEnd;
+attribute vec3 aNext;
+uniform mat4 mvp;
+uniform mat4 model;
+uniform vec3 eye;
+uniform float radius;
+varying vec3 vNormal;
+varying vec3 vPos;
+vec3 direction(vec3 from, vec3 to, vec3 fallback) {
+    vec3 d = to - from;
+    return dot(d, d) > 1e-24 ? normalize(d) : fallback;
+}
+void main() {
+    vec3 segment = direction(aStart, aEnd, vec3(0.0, 0.0, 1.0));
+    bool atEnd = aRing.y > 0.5;
+    vec3 center = atEnd ? aEnd : aStart;
+    vec3 tangent = atEnd ? direction(aStart, aNext, segment) : direction(aPrev, aEnd, segment);
+    vec3 toEye = eye - center;
+    vec3 side = cross(tangent, toEye);
+    if (dot(side, side) < 1e-6 * dot(toEye, toEye)) side = cross(tangent, abs(tangent.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0));
+    side = normalize(side);
+    vec3 up = cross(side, tangent);
+    vec3 normal = cos(aRing.x) * side + sin(aRing.x) * up;
+    vec3 pos = center + radius * normal;
+    vPos = vec3(model * vec4(pos, 1.0));
+    vNormal = mat3(model) * normal;
+    gl_Position = mvp * vec4(pos, 1.0);
+}
+)";
+#endif
+
+    tubeShader_ = std::make_unique<QOpenGLShaderProgram>();
+    tubeShader_->addShaderFromSourceCode(QOpenGLShader::Vertex, tubeVertSrc);
+    tubeShader_->addShaderFromSourceCode(QOpenGLShader::Fragment, fragSrc);
+    tubeShader_->bindAttributeLocation("aRing", 0);
+    tubeShader_->bindAttributeLocation("aPrev", 1);
+    tubeShader_->bindAttributeLocation("aStart", 2);
+    tubeShader_->bindAttributeLocation("aEnd", 3);
+    tubeShader_->bindAttributeLocation("aNext", 4);
+    tubeShader_->link();
 }
 
 void GLCanvas::resizeGL(int w, int h) {
@@ -241,23 +494,29 @@ void GLCanvas::resizeGL(int w, int h) {
 }
 
 void GLCanvas::paintGL() {
-    std::cerr << "paintGL called" << std::endl;
-
+    // Draw times are CPU submission; the GPU work is only waited for by
+    // whoever reads the frame back
     if (is3DMode_) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
 
         vao_.bind();
-        draw3DAxes();
+        {
+            ProfileScope scope(ProfileStage::Draw);
+            draw3DAxes();
+        }
 
+        ++frameCounter_;
         for (const auto& entry : plotEntries_) {
             if (!entry.visible) continue;
+            ProfileScope scope(ProfileStage::Draw, static_cast<int>(&entry - plotEntries_.data()));
             if (entry.plotType == PlotType::Surface3D || entry.plotType == PlotType::Implicit3D) {
                 drawSurface3D(entry);
             } else if (entry.plotType == PlotType::Parametric3D) {
                 drawParametric3D(entry);
             }
         }
+        evictPackedBuffers();
 
         vao_.release();
         glDisable(GL_DEPTH_TEST);
@@ -268,11 +527,12 @@ void GLCanvas::paintGL() {
         lineShader_->bind();
         lineShader_->setUniformValue("projection", projectionMatrix_);
 
-        drawGrid();
-        drawAxes();
-        std::cerr << "Drawing plots" << std::endl;
+        {
+            ProfileScope scope(ProfileStage::Draw);
+            drawGrid();
+            drawAxes();
+        }
         drawPlots();
-        std::cerr << "Plots drawn" << std::endl;
 
         lineShader_->release();
         vao_.release();
@@ -280,6 +540,9 @@ void GLCanvas::paintGL() {
         // Draw axis labels using QPainter (after OpenGL)
         drawAxisLabels();
     }
+
+    if (hudVisible_) drawProfilerHud();
+    Profiler::instance().endFrame();
 }
 
 void GLCanvas::drawGrid() {
@@ -318,7 +581,7 @@ void GLCanvas::drawGrid() {
 
     if (!gridVertices.empty()) {
         gridVBO_.bind();
-        gridVBO_.allocate(gridVertices.data(), static_cast<int>(gridVertices.size() * sizeof(float)));
+        uploadBuffer(gridVBO_, gridVertices.data(), static_cast<int>(gridVertices.size() * sizeof(float)));
 
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
@@ -355,7 +618,7 @@ void GLCanvas::drawAxes() {
 
     if (!axesVertices.empty()) {
         axesVBO_.bind();
-        axesVBO_.allocate(axesVertices.data(), static_cast<int>(axesVertices.size() * sizeof(float)));
+        uploadBuffer(axesVBO_, axesVertices.data(), static_cast<int>(axesVertices.size() * sizeof(float)));
 
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
@@ -369,17 +632,43 @@ void GLCanvas::drawAxes() {
 }
 
 void GLCanvas::drawPlots() {
+    // Use GPU rendering for implicit functions. Adjacent ones are fused into
+    // as few full-screen passes as possible; any other entry between them
+    // ends the run, so entries still draw in the user's order. In 2D mode,
+    // Implicit3D is rendered as a 2D slice with z as a parameter.
+    std::vector<const PlotEntry*> implicitRun;
+    auto drawImplicitRun = [&]() {
+        for (size_t start = 0; start < implicitRun.size(); start += kMaxFusedImplicit) {
+            // A fused pass draws several entries at once
+            ProfileScope scope(ProfileStage::Draw);
+            size_t end = std::min(start + kMaxFusedImplicit, implicitRun.size());
+            std::vector<const PlotEntry*> batch(implicitRun.begin() + start, implicitRun.begin() + end);
+            if (!drawImplicitGPU(batch) && batch.size() > 1) {
+                // One bad expression fails the fused program; draw the rest alone
+                for (const PlotEntry* entry : batch) {
+                    drawImplicitGPU({entry});
+                }
+            }
+        }
+        implicitRun.clear();
+    };
+
     for (size_t i = 0; i < plotEntries_.size(); ++i) {
         const auto& entry = plotEntries_[i];
-        if (!entry.visible) continue;
-
-        // Use GPU rendering for implicit functions
-        // In 2D mode, Implicit3D is rendered as a 2D slice with z as a parameter
-        if (entry.plotType == PlotType::Implicit || entry.plotType == PlotType::Implicit3D) {
-            drawImplicitGPU(entry);
+        // 3D-only types draw nothing in 2D and do not split an implicit run
+        if (!entry.visible || entry.plotType == PlotType::Surface3D || entry.plotType == PlotType::Parametric3D) {
             continue;
         }
+        bool implicit = entry.plotType == PlotType::Implicit || entry.plotType == PlotType::Implicit3D;
+        if (implicit && isGPUEvaluated(entry)) {
+            implicitRun.push_back(&entry);
+            continue;
+        }
+        drawImplicitRun();
 
+        ProfileScope scope(ProfileStage::Draw, static_cast<int>(i));
+        // Implicit curves get here only as marching-squares segments
+        if (!implicit && isGPUEvaluated(entry) && drawExplicitGPU(entry)) continue;
         if (entry.vertices.empty()) continue;
 
         // Ensure we have enough VBOs
@@ -418,7 +707,8 @@ void GLCanvas::drawPlots() {
 
         auto& vbo = plotVBOs_[i];
         vbo.bind();
-        vbo.allocate(cleanVertices.data(), static_cast<int>(cleanVertices.size() * sizeof(float)));
+        uploadBuffer(vbo, cleanVertices.data(), static_cast<int>(cleanVertices.size() * sizeof(float)),
+                     static_cast<int>(i));
 
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
@@ -434,6 +724,7 @@ void GLCanvas::drawPlots() {
 
         vbo.release();
     }
+    drawImplicitRun();
 }
 
 void GLCanvas::setOffset(const QPointF& offset) {
@@ -464,6 +755,15 @@ QPointF GLCanvas::mathToScreen(const QPointF& math) const {
 
 void GLCanvas::setPlotEntries(const std::vector<PlotEntry>& entries) {
     plotEntries_ = entries;
+    fallbackRequested_ = false;
+    for (auto it = entryPrograms_.begin(); it != entryPrograms_.end();) {
+        const ExprNode* tree = it->first;
+        bool plotted = std::any_of(entries.begin(), entries.end(),
+                                   [tree](const PlotEntry& entry) { return entry.compiledExpr.get() == tree; });
+        it = plotted ? std::next(it) : entryPrograms_.erase(it);
+    }
+    // Packed meshes carry a revision; plain vertex arrays are re-uploaded
+    std::fill(raw3DUploaded_.begin(), raw3DUploaded_.end(), 0);
     update();
 }
 
@@ -474,15 +774,82 @@ void GLCanvas::updatePlotData(int index, const std::vector<float>& vertices) {
     }
 }
 
+void GLCanvas::updateParameters(int index, const std::vector<ParameterInfo>& parameters) {
+    if (index >= 0 && index < static_cast<int>(plotEntries_.size())) {
+        plotEntries_[index].parameters = parameters;
+        update();
+    }
+}
+
 void GLCanvas::requestRedraw() {
     update();
 }
 
+void GLCanvas::uploadBuffer(QOpenGLBuffer& buffer, const void* data, int bytes, int entry) {
+    ProfileScope scope(ProfileStage::Upload, entry);
+    buffer.allocate(data, bytes);
+    uploadedBytes_ += static_cast<uint64_t>(bytes);
+    if (entry >= 0) Profiler::instance().count(entry, 0, 0, static_cast<uint64_t>(bytes));
+}
+
+void GLCanvas::setHudVisible(bool visible) {
+    hudVisible_ = visible;
+    update();
+}
+
+void GLCanvas::setPrecision(double multiplier) {
+    precisionMultiplier_ = multiplier;
+    update();
+}
+
+bool GLCanvas::isGPUEvaluated(const PlotEntry& entry) {
+    switch (entry.plotType) {
+        // Implicit (and Implicit3D's z = 0 slice in 2D mode) is drawn by the
+        // implicit pass, Implicit3D in 3D mode by a per-pixel ray march.
+        // GPU unless the compiler rejects the expression or the entry's own
+        // (unfused) program already failed to build.
+        case PlotType::Implicit:
+        case PlotType::Implicit3D:
+        case PlotType::ExplicitY:
+        case PlotType::ExplicitX:
+        case PlotType::Surface3D:
+            return GLSLCompiler::isSupported(entry.compiledExpr) && !programFailed(entryProgram(entry));
+        default:
+            return false;
+    }
+}
+
+Representation GLCanvas::requiredRepresentation(const PlotEntry& entry) {
+    if (!entry.visible || entry.hasError) return Representation::None;
+
+    bool is3DType = entry.plotType == PlotType::Surface3D || entry.plotType == PlotType::Implicit3D ||
+                    entry.plotType == PlotType::Parametric3D;
+    if (is3DMode_) {
+        if (!is3DType) return Representation::None;
+        return isGPUEvaluated(entry) ? Representation::GPU : Representation::Mesh;
+    }
+
+    switch (entry.plotType) {
+        case PlotType::Surface3D:
+        case PlotType::Parametric3D:
+            return Representation::None;
+        case PlotType::Implicit3D:
+            // Only the shader pass can draw the z = 0 slice
+            return isGPUEvaluated(entry) ? Representation::GPU : Representation::None;
+        default:
+            return isGPUEvaluated(entry) ? Representation::GPU : Representation::Polyline;
+    }
+}
+
 void GLCanvas::mousePressEvent(QMouseEvent* event) {
     if (event->button() == Qt::LeftButton) {
         isDragging_ = true;
         lastMousePos_ = event->pos();
         setCursor(Qt::ClosedHandCursor);
+    } else if (event->button() == Qt::RightButton && is3DMode_) {
+        isPanning_ = true;
+        lastMousePos_ = event->pos();
+        setCursor(Qt::SizeAllCursor);
     }
 }
 
@@ -495,6 +862,22 @@ void GLCanvas::mouseMoveEvent(QMouseEvent* event) {
             lastMousePos_ = event->pos();
             updateCamera();
             update();
+            emit cameraChanged();
+        } else if (isPanning_) {
+            // Move the target over the ground plane, as far as the point
+            // under the cursor moves at the target's depth
+            QPointF delta = event->pos() - lastMousePos_;
+            float yawRad = static_cast<float>(cameraYaw_ * M_PI / 180.0);
+            QVector3D right(std::cos(yawRad), 0.0f, -std::sin(yawRad));
+            QVector3D forward(-std::sin(yawRad), 0.0f, -std::cos(yawRad));
+            float unitsPerPixel = 2.0f * cameraDistance_ * std::tan(static_cast<float>(M_PI) / 8.0f) /
+                                  static_cast<float>(std::max(height(), 1));
+            cameraTarget_ += (-right * static_cast<float>(delta.x()) + forward * static_cast<float>(delta.y())) *
+                             unitsPerPixel;
+            lastMousePos_ = event->pos();
+            updateCamera();
+            update();
+            emit cameraChanged();
         }
     } else {
         QPointF mathPos = screenToMath(event->pos());
@@ -514,6 +897,9 @@ void GLCanvas::mouseReleaseEvent(QMouseEvent* event) {
     if (event->button() == Qt::LeftButton) {
         isDragging_ = false;
         setCursor(Qt::ArrowCursor);
+    } else if (event->button() == Qt::RightButton && isPanning_) {
+        isPanning_ = false;
+        setCursor(Qt::ArrowCursor);
     }
 }
 
@@ -523,6 +909,7 @@ void GLCanvas::wheelEvent(QWheelEvent* event) {
         cameraDistance_ = std::clamp(cameraDistance_ * factor, 1.0f, 50.0f);
         updateCamera();
         update();
+        emit cameraChanged();
     } else {
         QPointF mousePos = event->position();
         QPointF mathPosBefore = screenToMath(mousePos);
@@ -540,135 +927,197 @@ void GLCanvas::wheelEvent(QWheelEvent* event) {
     }
 }
 
-bool GLCanvas::compileImplicitShader(const ExprNodePtr& expr, const Color& color,
-                                     const std::vector<ParameterInfo>& parameters) {
-    std::string glslExpr = compileToGLSL(expr);
-    bool sameColor = (color.h == lastImplicitColor_.h && color.s == lastImplicitColor_.s &&
-                      color.b == lastImplicitColor_.b && color.a == lastImplicitColor_.a);
-    if (glslExpr == lastImplicitGLSL_ && sameColor && implicitShader_) return true;
-    lastImplicitGLSL_ = glslExpr;
-    lastImplicitColor_ = color;
-
-    float r, g, b;
-    color.toRGB(r, g, b);
-
-    // Format floats with decimal point for valid GLSL
-    auto formatFloat = [](float f) {
-        std::ostringstream oss;
-        oss << std::fixed << f;
-        return oss.str();
-    };
-    std::string colorVec = "vec4(" + formatFloat(r) + "," + formatFloat(g) + "," + formatFloat(b) + ", alpha)";
-
-    // Build uniform declarations for parameters
-    std::string paramUniforms;
-    for (const auto& param : parameters) {
-        paramUniforms += "uniform float " + param.name + ";\n";
+std::string GLCanvas::buildImplicitFragmentSource(const std::vector<const PlotEntry*>& entries) {
+    // Each entry becomes f<i>(x, y). Parameters are namespaced per entry
+    // (p<i>_name) and re-bound to their plain names as locals, so two entries
+    // can hold different values for the same slider name.
+    GLSLCompiler compiler(kShaderDialect);
+    std::string uniforms = "uniform vec2 offset;\nuniform float scale;\nuniform vec2 resolution;\n";
+    uniforms += "uniform vec4 colors[" + std::to_string(entries.size()) + "];\n";
+    std::string functions;
+    std::string composite;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const PlotEntry& entry = *entries[i];
+        std::string idx = std::to_string(i);
+        std::string locals;
+        for (const auto& param : entry.parameters) {
+            std::string uniformName = "p" + idx + "_" + param.name;
+            uniforms += "uniform float " + uniformName + ";\n";
+            locals += "    float " + param.name + " = " + uniformName + ";\n";
+        }
+        std::string function;
+        compiler.compileFunction("f" + idx, entry.compiledExpr, {"x", "y"}, locals, function);
+        functions += function;
+
+        // Later entries are composited over earlier ones (premultiplied "over")
+        composite +=
+            "    v = f" + idx + "(x, y);\n"
+            "    d = abs(v) / max(length(vec2(dFdx(v), dFdy(v))), 0.0001);\n"
+            "    a = colors[" + idx + "].a * smoothstep(2.0, 0.5, d);\n"
+            "    acc = vec4(colors[" + idx + "].rgb * a, a) + acc * (1.0 - a);\n";
     }
 
-#ifdef WASM_BUILD
-    // WebGL 2.0 / OpenGL ES 3.0 shaders
-    std::string vertSrc = R"(#version 300 es
-precision highp float;
-in vec2 aPos;
-out vec2 vPos;
-void main() {
-    vPos = aPos;
-    gl_Position = vec4(aPos, 0.0, 1.0);
-}
-)";
-
-    std::string fragSrc = R"(#version 300 es
-precision highp float;
-in vec2 vPos;
-out vec4 FragColor;
-uniform vec2 offset;
-uniform float scale;
-uniform vec2 resolution;
-)" + paramUniforms + R"(
-float f(float x, float y) {
-    return )" + glslExpr + R"(;
-}
-
+    std::string body = R"(
 void main() {
     vec2 screen = (vPos * 0.5 + 0.5) * resolution;
     float x = (screen.x - offset.x) / scale;
     float y = (offset.y - resolution.y + screen.y) / scale;
 
-    float v = f(x, y);
-    float dx = dFdx(v);
-    float dy = dFdy(v);
-    float grad = sqrt(dx*dx + dy*dy);
-    float d = abs(v) / max(grad, 0.0001);
+    vec4 acc = vec4(0.0);
+    float v;
+    float d;
+    float a;
+)" + composite + R"(
+    if (acc.a < 0.01) discard;
+)";
 
-    float alpha = smoothstep(2.0, 0.5, d);
-    if (alpha < 0.01) discard;
-    FragColor = )" + colorVec + R"(;
+#ifdef WASM_BUILD
+    // WebGL 2.0 / OpenGL ES 3.0 shaders
+    return R"(#version 300 es
+precision highp float;
+in vec2 vPos;
+out vec4 FragColor;
+)" + uniforms + compiler.helperSource() + functions + body + R"(    FragColor = vec4(acc.rgb / acc.a, acc.a);
 }
 )";
 #else
     // OpenGL ES 2.0 compatible shaders
-    std::string vertSrc = R"(
+    return R"(
 #ifdef GL_ES
 precision highp float;
 #endif
-attribute vec2 aPos;
 varying vec2 vPos;
-void main() {
-    vPos = aPos;
-    gl_Position = vec4(aPos, 0.0, 1.0);
+)" + uniforms + compiler.helperSource() + functions + body + R"(    gl_FragColor = vec4(acc.rgb / acc.a, acc.a);
 }
 )";
-
-    std::string fragSrc = R"(
-#ifdef GL_ES
-precision highp float;
 #endif
-varying vec2 vPos;
-uniform vec2 offset;
-uniform float scale;
-uniform vec2 resolution;
-)" + paramUniforms + R"(
-float f(float x, float y) {
-    return )" + glslExpr + R"(;
 }
 
-void main() {
-    vec2 screen = (vPos * 0.5 + 0.5) * resolution;
-    float x = (screen.x - offset.x) / scale;
-    float y = (offset.y - resolution.y + screen.y) / scale;
+const GLCanvas::EntryProgram& GLCanvas::entryProgram(const PlotEntry& entry) {
+    HashBuilder parameters;
+    for (const auto& param : entry.parameters) parameters.add(param.name);
+    uint64_t parameterHash = parameters.value();
 
-    float v = f(x, y);
-    float dx = dFdx(v);
-    float dy = dFdy(v);
-    float grad = sqrt(dx*dx + dy*dy);
-    float d = abs(v) / max(grad, 0.0001);
+    EntryProgram& sources = entryPrograms_[entry.compiledExpr.get()];
+    if (sources.expr == entry.compiledExpr && sources.type == entry.plotType && sources.is3D == is3DMode_ &&
+        sources.parameterHash == parameterHash && !sources.key.empty()) {
+        return sources;
+    }
 
-    float alpha = smoothstep(2.0, 0.5, d);
-    if (alpha < 0.01) discard;
-    gl_FragColor = )" + colorVec + R"(;
+    sources.expr = entry.compiledExpr;
+    sources.type = entry.plotType;
+    sources.is3D = is3DMode_;
+    sources.parameterHash = parameterHash;
+    switch (entry.plotType) {
+        case PlotType::ExplicitY:
+        case PlotType::ExplicitX:
+            sources.vertexSource = buildExplicitVertexSource(entry);
+            sources.fragmentSource = kExplicitFragmentSource;
+            break;
+        case PlotType::Surface3D:
+            sources.vertexSource = buildSurfaceVertexSource(entry);
+            sources.fragmentSource = kSurfaceFragmentSource;
+            break;
+        case PlotType::Implicit:
+        case PlotType::Implicit3D:
+            // The unfused implicit pass, or the ray march in 3D mode
+            sources.vertexSource = kImplicitVertexSource;
+            sources.fragmentSource = entry.plotType == PlotType::Implicit3D && is3DMode_
+                ? buildRaymarchFragmentSource(entry) : buildImplicitFragmentSource({&entry});
+            break;
+        default:
+            sources.vertexSource.clear();
+            sources.fragmentSource.clear();
+            break;
+    }
+    sources.key = sources.vertexSource + sources.fragmentSource;
+    return sources;
 }
-)";
-#endif
 
-    implicitShader_ = std::make_unique<QOpenGLShaderProgram>();
-    if (!implicitShader_->addShaderFromSourceCode(QOpenGLShader::Vertex, vertSrc.c_str())) return false;
-    if (!implicitShader_->addShaderFromSourceCode(QOpenGLShader::Fragment, fragSrc.c_str())) return false;
-    implicitShader_->bindAttributeLocation("aPos", 0);
-    return implicitShader_->link();
+bool GLCanvas::programFailed(const EntryProgram& sources) const {
+    auto it = generatedPrograms_.find(sources.key);
+    return it != generatedPrograms_.end() && !it->second.program;
+}
+
+QOpenGLShaderProgram* GLCanvas::cachedProgram(const EntryProgram& sources) {
+    return cachedProgram(sources.key, sources.vertexSource, sources.fragmentSource);
+}
+
+QOpenGLShaderProgram* GLCanvas::cachedProgram(const std::string& vertSrc, const std::string& fragSrc) {
+    return cachedProgram(vertSrc + fragSrc, vertSrc, fragSrc);
+}
+
+QOpenGLShaderProgram* GLCanvas::cachedProgram(const std::string& key, const std::string& vertSrc,
+                                              const std::string& fragSrc) {
+    auto it = generatedPrograms_.find(key);
+    if (it != generatedPrograms_.end()) {
+        it->second.lastUsed = ++programUseCounter_;
+        return it->second.program.get();
+    }
+
+    if (generatedPrograms_.size() >= kMaxGeneratedPrograms) {
+        auto lru = generatedPrograms_.begin();
+        for (auto cur = generatedPrograms_.begin(); cur != generatedPrograms_.end(); ++cur) {
+            if (cur->second.lastUsed < lru->second.lastUsed) lru = cur;
+        }
+        generatedPrograms_.erase(lru);
+    }
+
+    // Failed compiles are cached as null so they are not retried every frame
+    ProfileScope scope(ProfileStage::Compile);
+    auto program = std::make_unique<QOpenGLShaderProgram>();
+    program->bindAttributeLocation("aPos", 0);
+    program->bindAttributeLocation("aIndex", 0);
+    program->bindAttributeLocation("aGrid", 0);
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertSrc.c_str()) ||
+        !program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragSrc.c_str()) ||
+        !program->link()) {
+        qWarning() << "Generated shader failed to build";
+        program.reset();
+    }
+
+    CachedProgram& cached = generatedPrograms_[key];
+    cached.program = std::move(program);
+    cached.lastUsed = ++programUseCounter_;
+    return cached.program.get();
 }
 
-void GLCanvas::drawImplicitGPU(const PlotEntry& entry) {
-    if (!entry.compiledExpr || !compileImplicitShader(entry.compiledExpr, entry.color, entry.parameters)) return;
+bool GLCanvas::drawImplicitGPU(const std::vector<const PlotEntry*>& entries) {
+    if (entries.empty()) return true;
+    QOpenGLShaderProgram* program = entries.size() == 1
+        ? cachedProgram(entryProgram(*entries[0]))
+        : cachedProgram(kImplicitVertexSource, buildImplicitFragmentSource(entries));
+    if (!program) {
+        // A failed fused pass is retried entry by entry; a failed single
+        // entry now needs its marching-squares segments
+        if (entries.size() == 1 && !fallbackRequested_) {
+            fallbackRequested_ = true;
+            emit gpuFallbackRequired();
+        }
+        return false;
+    }
+
+    std::vector<QVector4D> colors;
+    colors.reserve(entries.size());
+    for (const PlotEntry* entry : entries) {
+        float r, g, b;
+        entry->color.toRGB(r, g, b);
+        colors.emplace_back(r, g, b, entry->color.a);
+    }
 
-    implicitShader_->bind();
-    implicitShader_->setUniformValue("offset", QVector2D(offset_.x(), offset_.y()));
-    implicitShader_->setUniformValue("scale", static_cast<float>(scale_));
-    implicitShader_->setUniformValue("resolution", QVector2D(width(), height()));
+    program->bind();
+    program->setUniformValue("offset", QVector2D(offset_.x(), offset_.y()));
+    program->setUniformValue("scale", static_cast<float>(scale_));
+    program->setUniformValue("resolution", QVector2D(width(), height()));
+    program->setUniformValueArray("colors", colors.data(), static_cast<int>(colors.size()));
 
     // Set parameter uniforms
-    for (const auto& param : entry.parameters) {
-        implicitShader_->setUniformValue(param.name.c_str(), static_cast<float>(param.value));
+    for (size_t i = 0; i < entries.size(); ++i) {
+        std::string prefix = "p" + std::to_string(i) + "_";
+        for (const auto& param : entries[i]->parameters) {
+            program->setUniformValue((prefix + param.name).c_str(), static_cast<float>(param.value));
+        }
     }
 
     quadVBO_.bind();
@@ -677,8 +1126,101 @@ void GLCanvas::drawImplicitGPU(const PlotEntry& entry) {
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     glDisableVertexAttribArray(0);
     quadVBO_.release();
-    implicitShader_->release();
+    program->release();
+    lineShader_->bind();
+    return true;
+}
+
+std::string GLCanvas::buildExplicitVertexSource(const PlotEntry& entry) {
+    GLSLCompiler compiler(kShaderDialect);
+    // y = f(x) samples x across the view; x = f(y) samples y
+    bool alongX = entry.plotType == PlotType::ExplicitY;
+    std::string function;
+    compiler.compileFunction("f", entry.compiledExpr, {alongX ? "x" : "y"}, "", function);
+
+    std::string uniforms = "uniform mat4 projection;\nuniform vec2 offset;\nuniform float scale;\n"
+                           "uniform vec2 resolution;\nuniform vec2 range;\nuniform float sampleCount;\n";
+    for (const auto& param : entry.parameters) {
+        uniforms += "uniform float " + param.name + ";\n";
+    }
+
+    std::string body = R"(
+void main() {
+    float s = range.x + (range.y - range.x) * aIndex / (sampleCount - 1.0);
+    float v = f(s);
+)" + std::string(alongX ? R"(    vec2 screen = vec2(offset.x + s * scale, offset.y - v * scale);
+    float across = screen.y - 0.5 * resolution.y;
+    float extent = 0.5 * resolution.y + 1000.0;
+)" : R"(    vec2 screen = vec2(offset.x + v * scale, offset.y - s * scale);
+    float across = screen.x - 0.5 * resolution.x;
+    float extent = 0.5 * resolution.x + 1000.0;
+)") + R"(    vValid = (abs(v) < 1.0e30 && abs(across) < extent) ? 1.0 : 0.0;
+    gl_Position = projection * vec4(screen, 0.0, 1.0);
+}
+)";
+
+#ifdef WASM_BUILD
+    return R"(#version 300 es
+precision highp float;
+in float aIndex;
+out float vValid;
+)" + uniforms + compiler.helperSource() + function + body;
+#else
+    return R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+attribute float aIndex;
+varying float vValid;
+)" + uniforms + compiler.helperSource() + function + body;
+#endif
+}
+
+bool GLCanvas::drawExplicitGPU(const PlotEntry& entry) {
+    QOpenGLShaderProgram* program = cachedProgram(entryProgram(entry));
+    if (!program) {
+        if (!fallbackRequested_) {
+            fallbackRequested_ = true;
+            emit gpuFallbackRequired();
+        }
+        return false;
+    }
+
+    float w = static_cast<float>(width());
+    float h = static_cast<float>(height());
+    // Same density as the CPU path: precisionMultiplier samples per pixel
+    float extent = entry.plotType == PlotType::ExplicitY ? w : h;
+    int sampleCount = std::clamp(static_cast<int>(extent * precisionMultiplier_), 2, kMaxExplicitSamples);
+
+    QVector2D range = entry.plotType == PlotType::ExplicitY
+        ? QVector2D(static_cast<float>(-offset_.x() / scale_), static_cast<float>((w - offset_.x()) / scale_))
+        : QVector2D(static_cast<float>((offset_.y() - h) / scale_), static_cast<float>(offset_.y() / scale_));
+
+    float r, g, b;
+    entry.color.toRGB(r, g, b);
+
+    program->bind();
+    program->setUniformValue("projection", projectionMatrix_);
+    program->setUniformValue("offset", QVector2D(offset_.x(), offset_.y()));
+    program->setUniformValue("scale", static_cast<float>(scale_));
+    program->setUniformValue("resolution", QVector2D(w, h));
+    program->setUniformValue("range", range);
+    program->setUniformValue("sampleCount", static_cast<float>(sampleCount));
+    program->setUniformValue("color", QVector4D(r, g, b, 1.0f));
+    for (const auto& param : entry.parameters) {
+        program->setUniformValue(param.name.c_str(), static_cast<float>(param.value));
+    }
+
+    explicitSampleVBO_.bind();
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), nullptr);
+    glLineWidth(entry.thickness);
+    glDrawArrays(GL_LINE_STRIP, 0, sampleCount);
+    glDisableVertexAttribArray(0);
+    explicitSampleVBO_.release();
+    program->release();
     lineShader_->bind();
+    return true;
 }
 
 void GLCanvas::drawAxisLabels() {
@@ -749,6 +1291,86 @@ void GLCanvas::drawAxisLabels() {
     painter.end();
 }
 
+void GLCanvas::drawProfilerHud() {
+    // 每帧一根堆叠柱, 按阶段着色; 满高为两帧预算 (33 ms)
+    constexpr int kHudFrames = 120;
+    constexpr int kBarWidth = 2;
+    constexpr int kGraphHeight = 80;
+    constexpr double kGraphMs = 1000.0 / 30.0;
+    const QColor stageColors[] = {QColor(156, 102, 204), QColor(230, 126, 34), QColor(52, 152, 219),
+                                  QColor(46, 204, 113), QColor(241, 196, 15), QColor(231, 76, 60)};
+    const int stageCount = static_cast<int>(ProfileStage::Count);
+
+    std::vector<FrameProfile> frames = Profiler::instance().recentFrames();
+    if (frames.size() > kHudFrames) frames.erase(frames.begin(), frames.end() - kHudFrames);
+
+    double averageMs[static_cast<int>(ProfileStage::Count)] = {};
+    double averageInterval = 0.0;
+    std::map<int, EntryCounters> entries;
+    for (const FrameProfile& frame : frames) {
+        for (int s = 0; s < stageCount; ++s) averageMs[s] += frame.stageMs[s] / frames.size();
+        averageInterval += frame.intervalMs / frames.size();
+        for (const auto& [index, counters] : frame.entries) {
+            EntryCounters& total = entries[index];
+            total.samples += counters.samples;
+            total.vertices += counters.vertices;
+            total.bytes += counters.bytes;
+        }
+    }
+
+    QPainter painter(this);
+    painter.setFont(QFont("Sans", 8));
+    QFontMetrics metrics = painter.fontMetrics();
+    int lineHeight = metrics.height();
+    int lines = 1 + stageCount + static_cast<int>(std::min<size_t>(entries.size(), 8));
+    int panelWidth = kHudFrames * kBarWidth + 16;
+    int panelHeight = kGraphHeight + 16 + lines * lineHeight;
+    QRect panel(width() - panelWidth - 8, 8, panelWidth, panelHeight);
+    painter.fillRect(panel, QColor(255, 255, 255, 220));
+    painter.setPen(QColor(200, 200, 200));
+    painter.drawRect(panel);
+
+    int graphLeft = panel.left() + 8;
+    int graphBottom = panel.top() + 8 + kGraphHeight;
+    double pixelsPerMs = kGraphHeight / kGraphMs;
+    for (size_t f = 0; f < frames.size(); ++f) {
+        int x = graphLeft + static_cast<int>(kHudFrames - frames.size() + f) * kBarWidth;
+        double y = graphBottom;
+        for (int s = 0; s < stageCount; ++s) {
+            double h = std::min(frames[f].stageMs[s] * pixelsPerMs, y - (graphBottom - kGraphHeight));
+            if (h <= 0.0) continue;
+            painter.fillRect(QRectF(x, y - h, kBarWidth, h), stageColors[s]);
+            y -= h;
+        }
+    }
+    // 60 Hz budget
+    painter.setPen(QPen(QColor(120, 120, 120), 1, Qt::DashLine));
+    int budgetY = graphBottom - static_cast<int>(1000.0 / 60.0 * pixelsPerMs);
+    painter.drawLine(graphLeft, budgetY, graphLeft + kHudFrames * kBarWidth, budgetY);
+
+    painter.setPen(QColor(60, 60, 60));
+    int textY = graphBottom + 8 + metrics.ascent();
+    QString header = !Profiler::instance().enabled() ? QString("Profiler off")
+                                    : QString("%1 frames, %2 ms apart").arg(frames.size()).arg(averageInterval, 0, 'f', 1);
+    painter.drawText(graphLeft, textY, header);
+    for (int s = 0; s < stageCount; ++s) {
+        textY += lineHeight;
+        painter.fillRect(QRect(graphLeft, textY - metrics.ascent() + 2, 8, 8), stageColors[s]);
+        painter.drawText(graphLeft + 12, textY, QString("%1  %2 ms")
+                         .arg(QString(stageName(static_cast<ProfileStage>(s))), -10)
+                         .arg(averageMs[s], 0, 'f', 2));
+    }
+    // Per entry, summed over the frames shown
+    int shown = 0;
+    for (const auto& [index, counters] : entries) {
+        if (++shown > 8) break;
+        textY += lineHeight;
+        painter.drawText(graphLeft, textY, QString("#%1  %2 samples, %3 vertices, %4 KiB")
+                         .arg(index).arg(counters.samples).arg(counters.vertices).arg(counters.bytes / 1024));
+    }
+    painter.end();
+}
+
 void GLCanvas::set3DMode(bool enabled) {
     is3DMode_ = enabled;
     if (enabled) {
@@ -757,7 +1379,16 @@ void GLCanvas::set3DMode(bool enabled) {
     update();
 }
 
-void GLCanvas::updateCamera() {
+void GLCanvas::setCamera(float yaw, float pitch, float distance, const QVector3D& target) {
+    cameraYaw_ = yaw;
+    cameraPitch_ = pitch;
+    cameraDistance_ = distance;
+    cameraTarget_ = target;
+    updateCamera();
+    update();
+}
+
+QVector3D GLCanvas::cameraEye() const {
     float yawRad = static_cast<float>(cameraYaw_ * M_PI / 180.0);
     float pitchRad = static_cast<float>(cameraPitch_ * M_PI / 180.0);
 
@@ -766,9 +1397,33 @@ void GLCanvas::updateCamera() {
         cameraDistance_ * std::sin(pitchRad),
         cameraDistance_ * std::cos(pitchRad) * std::cos(yawRad)
     );
+    return cameraPos + cameraTarget_;
+}
+
+QMatrix4x4 GLCanvas::viewProjection3D() const {
+    QMatrix4x4 projection;
+    float aspect = static_cast<float>(width()) / static_cast<float>(std::max(height(), 1));
+    projection.perspective(45.0f, aspect, 0.1f, 100.0f);
+    return projection * viewMatrix_ * modelMatrix_;
+}
+
+ChunkView GLCanvas::chunkView() const {
+    ChunkView view;
+    QMatrix4x4 m = viewProjection3D();
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 4; ++col) view.viewProj[row * 4 + col] = m(row, col);
+    }
+    view.target[0] = cameraTarget_.x();
+    view.target[1] = cameraTarget_.y();
+    view.target[2] = cameraTarget_.z();
+    // A few camera distances, within the far plane
+    view.radius = std::clamp(3.0 * cameraDistance_, kSurfaceChunkSize, 90.0);
+    return view;
+}
 
+void GLCanvas::updateCamera() {
     viewMatrix_.setToIdentity();
-    viewMatrix_.lookAt(cameraPos + cameraTarget_, cameraTarget_, QVector3D(0, 1, 0));
+    viewMatrix_.lookAt(cameraEye(), cameraTarget_, QVector3D(0, 1, 0));
 
     modelMatrix_.setToIdentity();
 }
@@ -795,7 +1450,7 @@ void GLCanvas::draw3DAxes() {
     };
 
     axesVBO_.bind();
-    axesVBO_.allocate(axisVertices.data(), static_cast<int>(axisVertices.size() * sizeof(float)));
+    uploadBuffer(axesVBO_, axisVertices.data(), static_cast<int>(axisVertices.size() * sizeof(float)));
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
@@ -818,11 +1473,7 @@ void GLCanvas::draw3DAxes() {
     lineShader_->release();
 }
 
-void GLCanvas::drawSurface3D(const PlotEntry& entry) {
-    if (entry.vertices3D.empty()) return;
-
-    // Ensure we have enough VBOs
-    size_t idx = &entry - plotEntries_.data();
+void GLCanvas::ensure3DBuffers(size_t idx) {
     while (plot3DVBOs_.size() <= idx) {
         plot3DVBOs_.emplace_back(QOpenGLBuffer::VertexBuffer);
         plot3DVBOs_.back().create();
@@ -831,6 +1482,25 @@ void GLCanvas::drawSurface3D(const PlotEntry& entry) {
         plot3DIBOs_.emplace_back(QOpenGLBuffer::IndexBuffer);
         plot3DIBOs_.back().create();
     }
+    if (curveRuns_.size() <= idx) {
+        curveRuns_.resize(idx + 1);
+    }
+    if (raw3DUploaded_.size() <= idx) {
+        raw3DUploaded_.resize(idx + 1, 0);
+    }
+}
+
+void GLCanvas::drawSurface3D(const PlotEntry& entry) {
+    if (entry.plotType == PlotType::Surface3D && isGPUEvaluated(entry) && drawSurfaceGPU(entry)) return;
+    if (entry.plotType == PlotType::Implicit3D && isGPUEvaluated(entry) && drawImplicit3DGPU(entry)) return;
+    if (!entry.packedMeshes3D.empty()) {
+        drawPackedMeshes(entry);
+        return;
+    }
+    if (entry.vertices3D.empty()) return;
+
+    size_t idx = &entry - plotEntries_.data();
+    ensure3DBuffers(idx);
 
     QMatrix4x4 projection;
     float aspect = static_cast<float>(width()) / static_cast<float>(height());
@@ -847,9 +1517,16 @@ void GLCanvas::drawSurface3D(const PlotEntry& entry) {
     entry.color.toRGB(r, g, b);
     surface3DShader_->setUniformValue("color", QVector4D(r, g, b, 0.9f));
 
+    // Upload only after setPlotEntries replaced the data
+    bool upload = !raw3DUploaded_[idx];
+    raw3DUploaded_[idx] = 1;
+
     auto& vbo = plot3DVBOs_[idx];
     vbo.bind();
-    vbo.allocate(entry.vertices3D.data(), static_cast<int>(entry.vertices3D.size() * sizeof(float)));
+    if (upload) {
+        uploadBuffer(vbo, entry.vertices3D.data(), static_cast<int>(entry.vertices3D.size() * sizeof(float)),
+                     static_cast<int>(idx));
+    }
 
     // Position attribute (location 0)
     glEnableVertexAttribArray(0);
@@ -862,7 +1539,10 @@ void GLCanvas::drawSurface3D(const PlotEntry& entry) {
     if (!entry.indices3D.empty()) {
         auto& ibo = plot3DIBOs_[idx];
         ibo.bind();
-        ibo.allocate(entry.indices3D.data(), static_cast<int>(entry.indices3D.size() * sizeof(unsigned int)));
+        if (upload) {
+            uploadBuffer(ibo, entry.indices3D.data(), static_cast<int>(entry.indices3D.size() * sizeof(unsigned int)),
+                         static_cast<int>(idx));
+        }
         glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(entry.indices3D.size()), GL_UNSIGNED_INT, nullptr);
         ibo.release();
     } else {
@@ -876,13 +1556,391 @@ void GLCanvas::drawSurface3D(const PlotEntry& entry) {
     surface3DShader_->release();
 }
 
+void GLCanvas::drawPackedMeshes(const PlotEntry& entry) {
+    int idx = static_cast<int>(&entry - plotEntries_.data());
+    QMatrix4x4 mvp = viewProjection3D();
+
+    float r, g, b;
+    entry.color.toRGB(r, g, b);
+
+    packedSurfaceShader_->bind();
+    packedSurfaceShader_->setUniformValue("mvp", mvp);
+    packedSurfaceShader_->setUniformValue("model", modelMatrix_);
+    packedSurfaceShader_->setUniformValue("lightDir", QVector3D(1.0f, 1.0f, 1.0f));
+    packedSurfaceShader_->setUniformValue("color", QVector4D(r, g, b, 0.9f));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    for (const auto& meshPtr : entry.packedMeshes3D) {
+        const PackedMesh& mesh = *meshPtr;
+        if (mesh.indexCount() == 0) continue;
+        packedSurfaceShader_->setUniformValue("posCenter", QVector3D(mesh.center[0], mesh.center[1], mesh.center[2]));
+        packedSurfaceShader_->setUniformValue("posExtent", QVector3D(mesh.extent[0], mesh.extent[1], mesh.extent[2]));
+
+        // Uploaded once per revision; tiles shared between entries or kept
+        // across setPlotEntries calls are not re-uploaded
+        auto [it, upload] = packedBuffers_.try_emplace(mesh.revision);
+        PackedBuffers& buffers = it->second;
+        buffers.lastFrame = frameCounter_;
+        if (upload) {
+            buffers.vbo.create();
+            buffers.ibo.create();
+        }
+        buffers.vbo.bind();
+        buffers.ibo.bind();
+        if (upload) {
+            uploadBuffer(buffers.vbo, mesh.vertices.data(), static_cast<int>(mesh.vertices.size()), idx);
+            if (!mesh.indices16.empty()) {
+                uploadBuffer(buffers.ibo, mesh.indices16.data(), static_cast<int>(mesh.indices16.size() * sizeof(uint16_t)), idx);
+            } else {
+                uploadBuffer(buffers.ibo, mesh.indices32.data(), static_cast<int>(mesh.indices32.size() * sizeof(uint32_t)), idx);
+            }
+        }
+
+        if (mesh.positions16) {
+            glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, mesh.stride, nullptr);
+        } else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, mesh.stride, nullptr);
+        }
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, mesh.stride, reinterpret_cast<void*>(static_cast<uintptr_t>(mesh.normalOffset)));
+
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount()),
+                       mesh.indices16.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, nullptr);
+        buffers.ibo.release();
+        buffers.vbo.release();
+    }
+
+    glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+    packedSurfaceShader_->release();
+}
+
+void GLCanvas::evictPackedBuffers() {
+    for (auto it = packedBuffers_.begin(); it != packedBuffers_.end();) {
+        if (it->second.lastFrame != frameCounter_) {
+            it->second.vbo.destroy();
+            it->second.ibo.destroy();
+            it = packedBuffers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::string GLCanvas::buildSurfaceVertexSource(const PlotEntry& entry) {
+    GLSLCompiler compiler(kShaderDialect);
+    std::string function;
+    compiler.compileFunction("f", entry.compiledExpr, {"x", "y"}, "", function);
+
+    std::string uniforms = "uniform mat4 mvp;\nuniform mat4 model;\nuniform vec2 origin;\nuniform float tileSize;\n"
+                           "uniform float gradStep;\n";
+    for (const auto& param : entry.parameters) {
+        uniforms += "uniform float " + param.name + ";\n";
+    }
+
+    // Math (x, y, z) maps to GL (x, z, y), matching the CPU surface mesh.
+    // The shared [0,1]^2 grid is placed on one tile per draw.
+    // The normal comes from a central-difference gradient of f.
+    std::string body = R"(
+void main() {
+    float x = origin.x + tileSize * aGrid.x;
+    float y = origin.y + tileSize * aGrid.y;
+    float z = f(x, y);
+    float dzdx = (f(x + gradStep, y) - f(x - gradStep, y)) / (2.0 * gradStep);
+    float dzdy = (f(x, y + gradStep) - f(x, y - gradStep)) / (2.0 * gradStep);
+    bool finite = abs(z) < 1.0e30 && abs(dzdx) < 1.0e30 && abs(dzdy) < 1.0e30;
+    vValid = finite ? 1.0 : 0.0;
+    vec3 pos = vec3(x, finite ? z : 0.0, y);
+    vNormal = mat3(model) * normalize(vec3(-dzdx, 1.0, -dzdy));
+    gl_Position = mvp * vec4(pos, 1.0);
+}
+)";
+
+#ifdef WASM_BUILD
+    return R"(#version 300 es
+precision highp float;
+in vec2 aGrid;
+out vec3 vNormal;
+out float vValid;
+)" + uniforms + compiler.helperSource() + function + body;
+#else
+    return R"(
+#ifdef GL_ES
+precision highp float;
+#endif
+attribute vec2 aGrid;
+varying vec3 vNormal;
+varying float vValid;
+)" + uniforms + compiler.helperSource() + function + body;
+#endif
+}
+
+void GLCanvas::ensureSurfaceGrid(int resolution) {
+    if (resolution == surfaceGridResolution_) return;
+
+    // (resolution+1)^2 vertices in [0,1]^2, two triangles per cell
+    int n = resolution + 1;
+    std::vector<float> grid;
+    grid.reserve(static_cast<size_t>(n) * n * 2);
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            grid.push_back(static_cast<float>(i) / resolution);
+            grid.push_back(static_cast<float>(j) / resolution);
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    indices.reserve(static_cast<size_t>(resolution) * resolution * 6);
+    for (int j = 0; j < resolution; ++j) {
+        for (int i = 0; i < resolution; ++i) {
+            unsigned int v00 = j * n + i;
+            unsigned int v10 = v00 + 1;
+            unsigned int v01 = v00 + n;
+            unsigned int v11 = v01 + 1;
+            indices.insert(indices.end(), {v00, v10, v01, v10, v11, v01});
+        }
+    }
+
+    if (!surfaceGridVBO_.isCreated()) surfaceGridVBO_.create();
+    if (!surfaceGridIBO_.isCreated()) surfaceGridIBO_.create();
+    surfaceGridVBO_.bind();
+    uploadBuffer(surfaceGridVBO_, grid.data(), static_cast<int>(grid.size() * sizeof(float)));
+    surfaceGridVBO_.release();
+    surfaceGridIBO_.bind();
+    uploadBuffer(surfaceGridIBO_, indices.data(), static_cast<int>(indices.size() * sizeof(unsigned int)));
+    surfaceGridIBO_.release();
+
+    surfaceGridResolution_ = resolution;
+    surfaceGridIndexCount_ = static_cast<int>(indices.size());
+}
+
+bool GLCanvas::drawSurfaceGPU(const PlotEntry& entry) {
+    QOpenGLShaderProgram* program = cachedProgram(entryProgram(entry));
+    if (!program) {
+        if (!fallbackRequested_) {
+            fallbackRequested_ = true;
+            emit gpuFallbackRequired();
+        }
+        return false;
+    }
+
+    // Same tiles as the CPU path, generated per frame around the target
+    std::vector<ChunkCoord> tiles = visibleChunks(chunkView(), kSurfaceChunkSize, kMaxSurfaceChunks);
+    if (tiles.empty()) return true;
+
+    // Ten times the CPU grid density per tile, lowered (in steps of 16, so
+    // the shared grid is not rebuilt on every zoom) to fit the vertex budget
+    int resolution = std::clamp(static_cast<int>(kSurfaceGridBase * precisionMultiplier_), 16, kMaxSurfaceGrid);
+    int budget = static_cast<int>(std::sqrt(static_cast<double>(kMaxSurfaceTileVertices) / tiles.size())) - 1;
+    resolution = std::max(16, std::min(resolution, budget) / 16 * 16);
+    ensureSurfaceGrid(resolution);
+    float tileSize = static_cast<float>(kSurfaceChunkSize);
+
+    QMatrix4x4 mvp = viewProjection3D();
+
+    float r, g, b;
+    entry.color.toRGB(r, g, b);
+
+    program->bind();
+    program->setUniformValue("mvp", mvp);
+    program->setUniformValue("model", modelMatrix_);
+    program->setUniformValue("lightDir", QVector3D(1.0f, 1.0f, 1.0f));
+    program->setUniformValue("color", QVector4D(r, g, b, 0.9f));
+    program->setUniformValue("tileSize", tileSize);
+    program->setUniformValue("gradStep", tileSize / resolution);
+    for (const auto& param : entry.parameters) {
+        program->setUniformValue(param.name.c_str(), static_cast<float>(param.value));
+    }
+
+    surfaceGridVBO_.bind();
+    surfaceGridIBO_.bind();
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+    for (const ChunkCoord& tile : tiles) {
+        program->setUniformValue("origin", QVector2D(tile.i * tileSize, tile.j * tileSize));
+        glDrawElements(GL_TRIANGLES, surfaceGridIndexCount_, GL_UNSIGNED_INT, nullptr);
+    }
+    glDisableVertexAttribArray(0);
+    surfaceGridIBO_.release();
+    surfaceGridVBO_.release();
+    program->release();
+    return true;
+}
+
+std::string GLCanvas::buildRaymarchFragmentSource(const PlotEntry& entry) {
+    GLSLCompiler compiler(kShaderDialect);
+    std::string function;
+    compiler.compileFunction("f", entry.compiledExpr, {"x", "y", "z"}, "", function);
+
+    std::string uniforms = "uniform mat4 invViewProj;\nuniform mat4 viewProj;\n"
+                           "uniform vec4 color;\nuniform vec3 lightDir;\n";
+    for (const auto& param : entry.parameters) {
+        uniforms += "uniform float " + param.name + ";\n";
+    }
+
+    // Each pixel's ray runs from the near plane to the far plane. The step is
+    // |f|/|grad f| (a first-order distance estimate), bounded below by the
+    // pixel footprint and above by a fraction of the distance travelled so
+    // a bad estimate cannot jump across a thin sheet. A sign change between
+    // samples is refined by bisection.
+    std::string body = R"(
+float fp(vec3 p) { return f(p.x, p.y, p.z); }
+
+vec3 gradient(vec3 p, float h) {
+    return vec3(fp(p + vec3(h, 0.0, 0.0)) - fp(p - vec3(h, 0.0, 0.0)),
+                fp(p + vec3(0.0, h, 0.0)) - fp(p - vec3(0.0, h, 0.0)),
+                fp(p + vec3(0.0, 0.0, h)) - fp(p - vec3(0.0, 0.0, h))) / (2.0 * h);
+}
+
+void main() {
+    vec4 nearH = invViewProj * vec4(vPos, -1.0, 1.0);
+    vec4 farH = invViewProj * vec4(vPos, 1.0, 1.0);
+    vec3 origin = nearH.xyz / nearH.w;
+    vec3 ray = farH.xyz / farH.w - origin;
+    float tMax = length(ray);
+    vec3 dir = ray / tMax;
+
+    float t = 0.0;
+    float v = fp(origin);
+    float tHit = -1.0;
+    for (int i = 0; i < 256; ++i) {
+        if (t >= tMax) break;
+        vec3 p = origin + dir * t;
+        float h = 0.001 + 0.001 * t;
+        vec3 g = (vec3(fp(p + vec3(h, 0.0, 0.0)), fp(p + vec3(0.0, h, 0.0)), fp(p + vec3(0.0, 0.0, h))) - v) / h;
+        float estimate = abs(v) / max(length(g), 1.0e-6);
+        float stepLen = clamp(0.5 * estimate, 0.001 + 0.002 * t, 0.05 + 0.05 * t);
+        float tNext = min(t + stepLen, tMax);
+        float vNext = fp(origin + dir * tNext);
+        if (abs(v) < 1.0e30 && abs(vNext) < 1.0e30 && v * vNext <= 0.0) {
+            float a = t;
+            float b = tNext;
+            for (int k = 0; k < 12; ++k) {
+                float m = 0.5 * (a + b);
+                float vm = fp(origin + dir * m);
+                if (v * vm <= 0.0) { b = m; } else { a = m; v = vm; }
+            }
+            tHit = 0.5 * (a + b);
+            break;
+        }
+        t = tNext;
+        v = vNext;
+    }
+    if (tHit < 0.0) discard;
+
+    vec3 hit = origin + dir * tHit;
+    vec3 norm = normalize(gradient(hit, 0.001 + 0.001 * tHit));
+    float diff = abs(dot(norm, normalize(lightDir)));
+    float ambient = 0.3;
+    float lighting = ambient + (1.0 - ambient) * diff;
+
+#ifdef FRAG_DEPTH
+    vec4 clip = viewProj * vec4(hit, 1.0);
+    FRAG_DEPTH = 0.5 * clip.z / clip.w + 0.5;
+#endif
+)";
+
+#ifdef WASM_BUILD
+    return R"(#version 300 es
+precision highp float;
+#define FRAG_DEPTH gl_FragDepth
+in vec2 vPos;
+out vec4 FragColor;
+)" + uniforms + compiler.helperSource() + function + body + R"(    FragColor = vec4(color.rgb * lighting, color.a);
+}
+)";
+#else
+    // GLSL ES 1.00 has no gl_FragDepth; GL_EXT_frag_depth adds
+    // gl_FragDepthEXT. Without it the surface keeps the quad's depth and is
+    // not occluded correctly by the axes or other 3D entries.
+    return R"(
+#ifdef GL_ES
+#extension GL_EXT_frag_depth : enable
+precision highp float;
+#ifdef GL_EXT_frag_depth
+#define FRAG_DEPTH gl_FragDepthEXT
+#endif
+#else
+#define FRAG_DEPTH gl_FragDepth
+#endif
+varying vec2 vPos;
+)" + uniforms + compiler.helperSource() + function + body + R"(    gl_FragColor = vec4(color.rgb * lighting, color.a);
+}
+)";
+#endif
+}
+
+bool GLCanvas::drawImplicit3DGPU(const PlotEntry& entry) {
+    QOpenGLShaderProgram* program = cachedProgram(entryProgram(entry));
+    if (!program) {
+        if (!fallbackRequested_) {
+            fallbackRequested_ = true;
+            emit gpuFallbackRequired();
+        }
+        return false;
+    }
+
+    QMatrix4x4 projection;
+    float aspect = static_cast<float>(width()) / static_cast<float>(height());
+    projection.perspective(45.0f, aspect, 0.1f, 100.0f);
+    QMatrix4x4 viewProj = projection * viewMatrix_ * modelMatrix_;
+
+    float r, g, b;
+    entry.color.toRGB(r, g, b);
+
+    program->bind();
+    program->setUniformValue("viewProj", viewProj);
+    program->setUniformValue("invViewProj", viewProj.inverted());
+    program->setUniformValue("lightDir", QVector3D(1.0f, 1.0f, 1.0f));
+    program->setUniformValue("color", QVector4D(r, g, b, 0.9f));
+    for (const auto& param : entry.parameters) {
+        program->setUniformValue(param.name.c_str(), static_cast<float>(param.value));
+    }
+
+    quadVBO_.bind();
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(0);
+    quadVBO_.release();
+    program->release();
+    return true;
+}
+
 void GLCanvas::drawParametric3D(const PlotEntry& entry) {
     if (entry.vertices3D.empty()) return;
 
     size_t idx = &entry - plotEntries_.data();
-    while (plot3DVBOs_.size() <= idx) {
-        plot3DVBOs_.emplace_back(QOpenGLBuffer::VertexBuffer);
-        plot3DVBOs_.back().create();
+    ensure3DBuffers(idx);
+
+    auto& vbo = plot3DVBOs_[idx];
+    auto& runs = curveRuns_[idx];
+    vbo.bind();
+    if (!raw3DUploaded_[idx]) {
+        // NaN-separated runs, each with its end points repeated once so every
+        // segment has a neighbour on both sides: p0 p0 p1 ... pn pn
+        std::vector<float> padded;
+        padded.reserve(entry.vertices3D.size() + 12);
+        runs.clear();
+        const float* points = entry.vertices3D.data();
+        size_t count = entry.vertices3D.size() / 3;
+        for (size_t i = 0; i < count;) {
+            if (!std::isfinite(points[i * 3])) {
+                ++i;
+                continue;
+            }
+            size_t end = i;
+            while (end < count && std::isfinite(points[end * 3])) ++end;
+            if (end - i > 1) {
+                padded.insert(padded.end(), points + i * 3, points + i * 3 + 3);
+                runs.emplace_back(static_cast<int>(padded.size() / 3), static_cast<int>(end - i));
+                padded.insert(padded.end(), points + i * 3, points + end * 3);
+                padded.insert(padded.end(), points + end * 3 - 3, points + end * 3);
+            }
+            i = end;
+        }
+        uploadBuffer(vbo, padded.data(), static_cast<int>(padded.size() * sizeof(float)), static_cast<int>(idx));
+        raw3DUploaded_[idx] = 1;
     }
 
     QMatrix4x4 projection;
@@ -891,26 +1949,69 @@ void GLCanvas::drawParametric3D(const PlotEntry& entry) {
 
     QMatrix4x4 mvp = projection * viewMatrix_ * modelMatrix_;
 
-    lineShader_->bind();
-    lineShader_->setUniformValue("projection", mvp);
-
     float r, g, b;
     entry.color.toRGB(r, g, b);
-    lineShader_->setUniformValue("color", QVector4D(r, g, b, 1.0f));
 
-    auto& vbo = plot3DVBOs_[idx];
-    vbo.bind();
-    vbo.allocate(entry.vertices3D.data(), static_cast<int>(entry.vertices3D.size() * sizeof(float)));
+    if (instancedTubes_ && tubeShader_->isLinked()) {
+        QOpenGLExtraFunctions* gl = context()->extraFunctions();
+        tubeShader_->bind();
+        tubeShader_->setUniformValue("mvp", mvp);
+        tubeShader_->setUniformValue("model", modelMatrix_);
+        tubeShader_->setUniformValue("eye", cameraEye());
+        tubeShader_->setUniformValue("radius", kTubeRadiusPerThickness * entry.thickness);
+        tubeShader_->setUniformValue("lightDir", QVector3D(1.0f, 1.0f, 1.0f));
+        tubeShader_->setUniformValue("color", QVector4D(r, g, b, 1.0f));
+
+        tubeRingVBO_.bind();
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+        tubeRingVBO_.release();
+
+        // prev/start/end/next are the same points shifted by one, advanced
+        // once per instance
+        vbo.bind();
+        for (GLuint attr = 1; attr <= 4; ++attr) {
+            glEnableVertexAttribArray(attr);
+            gl->glVertexAttribDivisor(attr, 1);
+        }
+        for (const auto& run : runs) {
+            for (GLuint attr = 1; attr <= 4; ++attr) {
+                size_t offset = (static_cast<size_t>(run.first) + attr - 2) * 3 * sizeof(float);
+                glVertexAttribPointer(attr, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                                      reinterpret_cast<const void*>(offset));
+            }
+            gl->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (kTubeSides + 1), run.second - 1);
+        }
+        // The VAO is shared with every other draw
+        for (GLuint attr = 1; attr <= 4; ++attr) {
+            gl->glVertexAttribDivisor(attr, 0);
+            glDisableVertexAttribArray(attr);
+        }
+        glDisableVertexAttribArray(0);
+        vbo.release();
+        tubeShader_->release();
+        return;
+    }
+
+    // Without instancing: flat-shaded line strips (constant normal facing the light)
+    surface3DShader_->bind();
+    surface3DShader_->setUniformValue("mvp", mvp);
+    surface3DShader_->setUniformValue("model", modelMatrix_);
+    surface3DShader_->setUniformValue("lightDir", QVector3D(1.0f, 1.0f, 1.0f));
+    surface3DShader_->setUniformValue("color", QVector4D(r, g, b, 1.0f));
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+    glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);
 
     glLineWidth(entry.thickness);
-    glDrawArrays(GL_LINE_STRIP, 0, static_cast<GLsizei>(entry.vertices3D.size() / 3));
+    for (const auto& run : runs) {
+        glDrawArrays(GL_LINE_STRIP, run.first, run.second);
+    }
 
     glDisableVertexAttribArray(0);
     vbo.release();
-    lineShader_->release();
+    surface3DShader_->release();
 }
 
 } // namespace ArchMaths
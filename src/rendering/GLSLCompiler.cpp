@@ -0,0 +1,326 @@
+#include "rendering/GLSLCompiler.h"
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+namespace ArchMaths {
+
+namespace {
+
+// Builtin name -> argument count, for every function ExpressionEvaluator knows
+const std::unordered_map<std::string, size_t>& supportedFunctions() {
+    static const std::unordered_map<std::string, size_t> functions = {
+        {"sin", 1}, {"cos", 1}, {"tan", 1}, {"asin", 1}, {"acos", 1}, {"atan", 1}, {"atan2", 2},
+        {"sinh", 1}, {"cosh", 1}, {"tanh", 1}, {"asinh", 1}, {"acosh", 1}, {"atanh", 1},
+        {"exp", 1}, {"log", 1}, {"ln", 1}, {"log10", 1}, {"log2", 1},
+        {"sqrt", 1}, {"cbrt", 1}, {"pow", 2},
+        {"floor", 1}, {"ceil", 1}, {"round", 1}, {"frac", 1},
+        {"abs", 1}, {"sign", 1}, {"min", 2}, {"max", 2}, {"mod", 2}
+    };
+    return functions;
+}
+
+bool findUnsupported(const ExprNodePtr& node, std::string& name) {
+    if (!node) return false;
+    switch (node->type) {
+        case NodeType::Number:
+        case NodeType::Variable:
+            return false;
+        case NodeType::BinaryOp:
+            return findUnsupported(node->left, name) || findUnsupported(node->right, name);
+        case NodeType::UnaryOp:
+            return findUnsupported(node->left, name);
+        case NodeType::Function: {
+            auto it = supportedFunctions().find(node->name);
+            if (it == supportedFunctions().end() || it->second != node->args.size()) {
+                name = node->name;
+                return true;
+            }
+            for (const auto& arg : node->args) {
+                if (findUnsupported(arg, name)) return true;
+            }
+            return false;
+        }
+        default:
+            name = "?";
+            return true;
+    }
+}
+
+bool isIdentifierOrLiteral(const std::string& s) {
+    for (char c : s) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') return false;
+    }
+    return !s.empty();
+}
+
+} // namespace
+
+GLSLCompiler::GLSLCompiler(GLSLDialect dialect)
+    : dialect_(dialect) {}
+
+bool GLSLCompiler::isSupported(const ExprNodePtr& expr) {
+    std::string name;
+    return expr && !findUnsupported(expr, name);
+}
+
+std::string GLSLCompiler::formatFloat(double value) {
+    if (!std::isfinite(value)) {
+        return value < 0 ? "(-1.0e30)" : "1.0e30";
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    std::string s = buf;
+    // GLSL needs a decimal point or exponent to make it a float literal
+    if (s.find_first_of(".e") == std::string::npos) s += ".0";
+    if (value < 0) s = "(" + s + ")";
+    return s;
+}
+
+void GLSLCompiler::use(Helper helper) {
+    usedHelpers_ |= helper;
+    // Helper dependencies
+    if (helper == HelperFmod) usedHelpers_ |= HelperTrunc;
+}
+
+bool GLSLCompiler::isConstant(const ExprNodePtr& node) const {
+    return node && node->type == NodeType::Number;
+}
+
+int GLSLCompiler::intern(const ExprNodePtr& node) {
+    std::vector<int> children;
+    std::string key;
+
+    switch (node->type) {
+        case NodeType::Number: {
+            char buf[40];
+            std::snprintf(buf, sizeof(buf), "n%a", node->value);
+            key = buf;
+            break;
+        }
+        case NodeType::Variable:
+            key = "v" + node->name;
+            break;
+        case NodeType::BinaryOp:
+            children = {intern(node->left), intern(node->right)};
+            key = "b" + node->op;
+            break;
+        case NodeType::UnaryOp:
+            children = {intern(node->left)};
+            key = "u" + node->op;
+            break;
+        case NodeType::Function:
+            for (const auto& arg : node->args) children.push_back(intern(arg));
+            key = "f" + node->name;
+            break;
+        default:
+            key = "?";
+            break;
+    }
+
+    // Fold operators whose operands are all constants
+    if (!children.empty()) {
+        bool allConstant = true;
+        for (int child : children) {
+            if (!isConstant(interned_[child].node)) { allConstant = false; break; }
+        }
+        if (allConstant) {
+            auto folded = std::make_shared<ExprNode>(*node);
+            if (node->type == NodeType::Function) {
+                for (size_t i = 0; i < children.size(); ++i) folded->args[i] = interned_[children[i]].node;
+            } else {
+                folded->left = interned_[children[0]].node;
+                if (children.size() > 1) folded->right = interned_[children[1]].node;
+            }
+            try {
+                double value = folder_.evaluate(folded, {});
+                if (std::isfinite(value)) return intern(ExprNode::makeNumber(value));
+            } catch (...) {
+                // Leave it to the GPU
+            }
+        }
+    }
+
+    for (int child : children) key += ":" + std::to_string(child);
+
+    auto it = keyToId_.find(key);
+    if (it != keyToId_.end()) return it->second;
+
+    Interned entry;
+    entry.node = node;
+    entry.children = std::move(children);
+    interned_.push_back(std::move(entry));
+    int id = static_cast<int>(interned_.size()) - 1;
+    keyToId_[key] = id;
+    return id;
+}
+
+std::string GLSLCompiler::emitNode(int id, std::string& statements) {
+    Interned& entry = interned_[id];
+    const ExprNodePtr& node = entry.node;
+
+    if (node->type == NodeType::Number) return formatFloat(node->value);
+    if (node->type == NodeType::Variable) return node->name;
+    if (!entry.temp.empty()) return entry.temp;
+
+    std::vector<std::string> args;
+    for (int child : entry.children) args.push_back(emitNode(child, statements));
+
+    std::string expr;
+    switch (node->type) {
+        case NodeType::BinaryOp:
+            expr = node->op == "^" ? emitPower(entry.children[1], args[0], args[1], statements)
+                                   : "(" + args[0] + node->op + args[1] + ")";
+            break;
+        case NodeType::UnaryOp:
+            expr = node->op == "-" ? "(-" + args[0] + ")" : args[0];
+            break;
+        case NodeType::Function:
+            expr = node->name == "pow" ? emitPower(entry.children[1], args[0], args[1], statements)
+                                       : emitFunctionCall(node, args);
+            break;
+        default:
+            expr = "0.0";
+            break;
+    }
+
+    if (entry.uses >= 2) {
+        entry.temp = "am_t" + std::to_string(tempCounter_++);
+        statements += "    float " + entry.temp + " = " + expr + ";\n";
+        return entry.temp;
+    }
+    return expr;
+}
+
+std::string GLSLCompiler::emitPower(int exponentId, const std::string& base,
+                                    const std::string& exponent, std::string& statements) {
+    // GLSL pow() is undefined for negative bases, so small integer powers are
+    // expanded and everything else goes through am_pow (std::pow semantics)
+    const ExprNodePtr& exponentNode = interned_[exponentId].node;
+    if (exponentNode->type == NodeType::Number) {
+        double n = exponentNode->value;
+        if (n == std::floor(n) && std::abs(n) <= 4.0) {
+            int k = static_cast<int>(std::abs(n));
+            std::string factor = base;
+            if (k > 1 && !isIdentifierOrLiteral(base)) {
+                // The base is repeated, so evaluate it once
+                factor = "am_t" + std::to_string(tempCounter_++);
+                statements += "    float " + factor + " = " + base + ";\n";
+            }
+            std::string product = k > 0 ? factor : "1.0";
+            for (int i = 1; i < k; ++i) product += "*" + factor;
+            return n < 0 ? "(1.0/(" + product + "))" : "(" + product + ")";
+        }
+        if (n == 0.5) return "sqrt(" + base + ")";
+    }
+    use(HelperPow);
+    return "am_pow(" + base + "," + exponent + ")";
+}
+
+std::string GLSLCompiler::emitFunctionCall(const ExprNodePtr& node, const std::vector<std::string>& args) {
+    const std::string& fn = node->name;
+    bool native300 = dialect_ == GLSLDialect::GLSL300ES;
+
+    auto call = [&](const std::string& name) {
+        std::string s = name + "(";
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (i > 0) s += ",";
+            s += args[i];
+        }
+        return s + ")";
+    };
+    auto helper = [&](Helper h, const std::string& name) {
+        use(h);
+        return call(name);
+    };
+
+    if (fn == "ln") return call("log");
+    if (fn == "log10") return "(log(" + args[0] + ")*0.4342944819)";
+    if (fn == "frac") return call("fract");
+    if (fn == "atan2") return call("atan");
+    if (fn == "mod") return helper(HelperFmod, "am_fmod");
+    if (fn == "round") return helper(HelperRound, "am_round");
+    if (fn == "cbrt") return helper(HelperCbrt, "am_cbrt");
+
+    if (!native300) {
+        if (fn == "sinh") return helper(HelperSinh, "am_sinh");
+        if (fn == "cosh") return helper(HelperCosh, "am_cosh");
+        if (fn == "tanh") return helper(HelperTanh, "am_tanh");
+        if (fn == "asinh") return helper(HelperAsinh, "am_asinh");
+        if (fn == "acosh") return helper(HelperAcosh, "am_acosh");
+        if (fn == "atanh") return helper(HelperAtanh, "am_atanh");
+    }
+
+    // Same name and semantics in GLSL
+    return call(fn);
+}
+
+std::string GLSLCompiler::helperSource() const {
+    std::string src;
+    if (usedHelpers_ & HelperTrunc) {
+        src += dialect_ == GLSLDialect::GLSL300ES
+            ? "float am_trunc(float x) { return trunc(x); }\n"
+            : "float am_trunc(float x) { return x < 0.0 ? -floor(-x) : floor(x); }\n";
+    }
+    if (usedHelpers_ & HelperFmod)  src += "float am_fmod(float a, float b) { return a - b * am_trunc(a / b); }\n";
+    if (usedHelpers_ & HelperRound) src += "float am_round(float x) { return x < 0.0 ? -floor(0.5 - x) : floor(x + 0.5); }\n";
+    if (usedHelpers_ & HelperCbrt)  src += "float am_cbrt(float x) { return x < 0.0 ? -pow(-x, 1.0 / 3.0) : pow(x, 1.0 / 3.0); }\n";
+    if (usedHelpers_ & HelperPow) {
+        src += "float am_pow(float a, float b) {\n"
+               "    if (a >= 0.0 || floor(b) != b) return pow(a, b);\n"
+               "    float r = pow(-a, b);\n"
+               "    return mod(b, 2.0) == 0.0 ? r : -r;\n"
+               "}\n";
+    }
+    if (usedHelpers_ & HelperSinh)  src += "float am_sinh(float x) { return 0.5 * (exp(x) - exp(-x)); }\n";
+    if (usedHelpers_ & HelperCosh)  src += "float am_cosh(float x) { return 0.5 * (exp(x) + exp(-x)); }\n";
+    if (usedHelpers_ & HelperTanh)  src += "float am_tanh(float x) { float e = exp(-2.0 * abs(x)); return sign(x) * (1.0 - e) / (1.0 + e); }\n";
+    if (usedHelpers_ & HelperAsinh) src += "float am_asinh(float x) { return sign(x) * log(abs(x) + sqrt(x * x + 1.0)); }\n";
+    if (usedHelpers_ & HelperAcosh) src += "float am_acosh(float x) { return log(x + sqrt(x * x - 1.0)); }\n";
+    if (usedHelpers_ & HelperAtanh) src += "float am_atanh(float x) { return 0.5 * log((1.0 + x) / (1.0 - x)); }\n";
+    return src;
+}
+
+bool GLSLCompiler::compileFunction(const std::string& name, const ExprNodePtr& expr,
+                                   const std::vector<std::string>& argNames,
+                                   const std::string& prelude, std::string& out) {
+    errorMessage_.clear();
+    std::string unsupported;
+    if (!expr) {
+        errorMessage_ = "空表达式";
+        return false;
+    }
+    if (findUnsupported(expr, unsupported)) {
+        errorMessage_ = "GPU不支持的函数: " + unsupported;
+        return false;
+    }
+
+    keyToId_.clear();
+    interned_.clear();
+    tempCounter_ = 0;
+
+    int root = intern(expr);
+
+    // Count references in the deduplicated DAG; children of a shared subtree
+    // are counted once, since the subtree itself becomes the temporary
+    std::function<void(int)> countUses = [&](int id) {
+        if (++interned_[id].uses > 1) return;
+        for (int child : interned_[id].children) countUses(child);
+    };
+    countUses(root);
+
+    std::string statements;
+    std::string result = emitNode(root, statements);
+
+    std::string signature;
+    for (size_t i = 0; i < argNames.size(); ++i) {
+        if (i > 0) signature += ", ";
+        signature += "float " + argNames[i];
+    }
+
+    out = "float " + name + "(" + signature + ") {\n" + prelude + statements +
+          "    return " + result + ";\n}\n";
+    return true;
+}
+
+} // namespace ArchMaths
@@ -0,0 +1,350 @@
+#include "session/SessionFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include "math/ExprHash.h"
+#include "mesh/SurfaceMesh.h"
+
+namespace ArchMaths {
+
+namespace {
+
+constexpr char kMagic[4] = {'A', 'M', 'S', 'S'};
+
+constexpr uint32_t tag(const char (&name)[5]) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(name[0])) |
+           static_cast<uint32_t>(static_cast<unsigned char>(name[1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(name[2])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(name[3])) << 24;
+}
+
+constexpr uint32_t kViewTag = tag("VIEW");
+constexpr uint32_t kVariablesTag = tag("VARS");
+constexpr uint32_t kEntriesTag = tag("ENTR");
+constexpr uint32_t kGeometryTag = tag("GEOM");
+
+// 几何记录的类型
+constexpr uint8_t kRawGeometry = 0;     // vertices (x,y,z,nx,ny,nz or x,y,z) + indices
+constexpr uint8_t kPackedGeometry = 1;  // PackedMesh (Surface3D tile)
+
+// Indices past the vertex data would reach the GPU as out-of-range reads
+template <typename T>
+bool indicesInRange(const std::vector<T>& indices, uint64_t vertexCount) {
+    return indices.empty() || *std::max_element(indices.begin(), indices.end()) < vertexCount;
+}
+
+class Writer {
+public:
+    template <typename T>
+    void put(T value) {
+        static_assert(std::is_trivially_copyable<T>::value, "plain values only");
+        putBytes(&value, sizeof(T));
+    }
+    void putBytes(const void* data, size_t size) {
+        if (size == 0) return;
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+    void putString(const std::string& s) {
+        put(static_cast<uint32_t>(s.size()));
+        putBytes(s.data(), s.size());
+    }
+    template <typename T>
+    void putArray(const std::vector<T>& values) {
+        put(static_cast<uint64_t>(values.size()));
+        putBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    std::vector<unsigned char> buffer;
+};
+
+// Bounds-checked cursor; after the first overrun every read fails
+class Reader {
+public:
+    Reader(const unsigned char* data, size_t size) : p_(data), end_(data + size) {}
+
+    template <typename T>
+    bool get(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "plain values only");
+        return getBytes(&value, sizeof(T));
+    }
+    bool getBytes(void* out, size_t size) {
+        if (!ok_ || size > remaining()) return ok_ = false;
+        // An empty vector's data() may be null, which memcpy does not allow
+        if (size == 0) return true;
+        std::memcpy(out, p_, size);
+        p_ += size;
+        return true;
+    }
+    bool getString(std::string& s) {
+        uint32_t size = 0;
+        if (!get(size) || size > remaining()) return ok_ = false;
+        s.assign(reinterpret_cast<const char*>(p_), size);
+        p_ += size;
+        return true;
+    }
+    template <typename T>
+    bool getArray(std::vector<T>& values) {
+        uint64_t count = 0;
+        if (!get(count) || count > remaining() / sizeof(T)) return ok_ = false;
+        values.resize(static_cast<size_t>(count));
+        return getBytes(values.data(), values.size() * sizeof(T));
+    }
+    bool skip(size_t size) {
+        if (!ok_ || size > remaining()) return ok_ = false;
+        p_ += size;
+        return true;
+    }
+
+    const unsigned char* position() const { return p_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+    bool ok() const { return ok_; }
+
+private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+    bool ok_ = true;
+};
+
+void writeSection(std::ofstream& out, uint32_t sectionTag, uint32_t count, const Writer& payload) {
+    uint64_t length = payload.buffer.size();
+    out.write(reinterpret_cast<const char*>(&sectionTag), sizeof(sectionTag));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(reinterpret_cast<const char*>(payload.buffer.data()), static_cast<std::streamsize>(length));
+    static const char padding[8] = {};
+    out.write(padding, static_cast<std::streamsize>((8 - length % 8) % 8));
+}
+
+void writeGeometry(Writer& out, const SessionGeometry& item) {
+    const CachedGeometry& geometry = *item.geometry;
+    Writer record;
+    if (geometry.packed) {
+        const PackedMesh& mesh = *geometry.packed;
+        record.put(kPackedGeometry);
+        record.put(static_cast<uint64_t>(mesh.vertexCount));
+        record.put(static_cast<int32_t>(mesh.stride));
+        record.put(static_cast<int32_t>(mesh.normalOffset));
+        record.put(static_cast<uint8_t>(mesh.positions16));
+        record.putBytes(mesh.center, sizeof(mesh.center));
+        record.putBytes(mesh.extent, sizeof(mesh.extent));
+        record.putArray(mesh.vertices);
+        record.putArray(mesh.indices16);
+        record.putArray(mesh.indices32);
+    } else {
+        record.put(kRawGeometry);
+        record.putArray(geometry.vertices);
+        record.putArray(geometry.indices);
+    }
+    out.put(item.key);
+    out.put(HashBuilder().add(record.buffer.data(), record.buffer.size()).value());
+    out.put(static_cast<uint64_t>(record.buffer.size()));
+    out.putBytes(record.buffer.data(), record.buffer.size());
+}
+
+std::shared_ptr<const CachedGeometry> readGeometryRecord(Reader& in) {
+    uint8_t kind = 0;
+    if (!in.get(kind)) return nullptr;
+    auto geometry = std::make_shared<CachedGeometry>();
+    if (kind == kRawGeometry) {
+        if (!in.getArray(geometry->vertices) || !in.getArray(geometry->indices)) return nullptr;
+        // Indexed meshes interleave position and normal
+        if (!geometry->indices.empty() &&
+            (geometry->vertices.size() % 6 != 0 || !indicesInRange(geometry->indices, geometry->vertices.size() / 6))) {
+            return nullptr;
+        }
+        return geometry;
+    }
+    if (kind != kPackedGeometry) return nullptr;
+
+    auto mesh = std::make_shared<PackedMesh>();
+    uint64_t vertexCount = 0;
+    int32_t stride = 0, normalOffset = 0;
+    uint8_t positions16 = 0;
+    if (!in.get(vertexCount) || !in.get(stride) || !in.get(normalOffset) || !in.get(positions16) ||
+        !in.getBytes(mesh->center, sizeof(mesh->center)) || !in.getBytes(mesh->extent, sizeof(mesh->extent)) ||
+        !in.getArray(mesh->vertices) || !in.getArray(mesh->indices16) || !in.getArray(mesh->indices32)) {
+        return nullptr;
+    }
+    // The position (3 floats, or 4 snorm16 with padding) comes first and the
+    // packed normal must follow it inside the stride
+    const int32_t positionBytes = positions16 ? 8 : 12;
+    if (stride < positionBytes + 4 || normalOffset < positionBytes || normalOffset > stride - 4 ||
+        mesh->vertices.size() != vertexCount * static_cast<uint64_t>(stride) ||
+        !indicesInRange(mesh->indices16, vertexCount) || !indicesInRange(mesh->indices32, vertexCount)) {
+        return nullptr;
+    }
+    mesh->vertexCount = static_cast<size_t>(vertexCount);
+    mesh->stride = stride;
+    mesh->normalOffset = normalOffset;
+    mesh->positions16 = positions16 != 0;
+    mesh->revision = SurfaceMesh::newRevision();
+    geometry->packed = std::move(mesh);
+    return geometry;
+}
+
+bool readView(Reader& in, SessionView& view) {
+    uint8_t mode3D = 0;
+    bool ok = in.get(view.offsetX) && in.get(view.offsetY) && in.get(view.scale) && in.get(view.precision) &&
+              in.get(mode3D) && in.get(view.yaw) && in.get(view.pitch) && in.get(view.distance) &&
+              in.getBytes(view.target, sizeof(view.target));
+    view.mode3D = mode3D != 0;
+    if (!ok) return false;
+    // 精度和缩放最终会被转换成整数采样数, NaN 或 0 在那里是未定义行为
+    const double values[] = {view.offsetX, view.offsetY, view.scale, view.precision, view.yaw, view.pitch,
+                             view.distance, view.target[0], view.target[1], view.target[2]};
+    for (double value : values) {
+        if (!std::isfinite(value)) return false;
+    }
+    return view.scale > 0.0 && view.precision > 0.0 && view.distance > 0.0;
+}
+
+bool readEntry(Reader& in, SessionEntry& entry) {
+    uint8_t visible = 1;
+    uint32_t parameterCount = 0;
+    if (!in.getString(entry.expression) || !in.get(entry.color.h) || !in.get(entry.color.s) ||
+        !in.get(entry.color.b) || !in.get(entry.color.a) || !in.get(entry.thickness) || !in.get(visible) ||
+        !in.get(parameterCount)) {
+        return false;
+    }
+    entry.visible = visible != 0;
+    for (uint32_t i = 0; i < parameterCount; ++i) {
+        ParameterInfo param;
+        if (!in.getString(param.name) || !in.get(param.value) || !in.get(param.minValue) ||
+            !in.get(param.maxValue)) {
+            return false;
+        }
+        entry.parameters.push_back(std::move(param));
+    }
+    return true;
+}
+
+} // namespace
+
+bool SessionFile::write(const std::string& path, const Session& session) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+
+    Writer view;
+    view.put(session.view.offsetX);
+    view.put(session.view.offsetY);
+    view.put(session.view.scale);
+    view.put(session.view.precision);
+    view.put(static_cast<uint8_t>(session.view.mode3D));
+    view.put(session.view.yaw);
+    view.put(session.view.pitch);
+    view.put(session.view.distance);
+    view.putBytes(session.view.target, sizeof(session.view.target));
+
+    Writer variables;
+    for (const auto& [name, value] : session.variables) {
+        variables.putString(name);
+        variables.put(value);
+    }
+
+    Writer entries;
+    for (const SessionEntry& entry : session.entries) {
+        entries.putString(entry.expression);
+        entries.put(entry.color.h);
+        entries.put(entry.color.s);
+        entries.put(entry.color.b);
+        entries.put(entry.color.a);
+        entries.put(entry.thickness);
+        entries.put(static_cast<uint8_t>(entry.visible));
+        entries.put(static_cast<uint32_t>(entry.parameters.size()));
+        for (const ParameterInfo& param : entry.parameters) {
+            entries.putString(param.name);
+            entries.put(param.value);
+            entries.put(param.minValue);
+            entries.put(param.maxValue);
+        }
+    }
+
+    Writer geometry;
+    uint32_t geometryCount = 0;
+    for (const SessionGeometry& item : session.geometry) {
+        if (!item.geometry) continue;
+        writeGeometry(geometry, item);
+        ++geometryCount;
+    }
+
+    uint32_t sectionCount = geometryCount > 0 ? 4 : 3;
+    out.write(kMagic, sizeof(kMagic));
+    uint32_t header[3] = {kVersion, sectionCount, 0};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    writeSection(out, kViewTag, 1, view);
+    writeSection(out, kVariablesTag, static_cast<uint32_t>(session.variables.size()), variables);
+    writeSection(out, kEntriesTag, static_cast<uint32_t>(session.entries.size()), entries);
+    if (geometryCount > 0) writeSection(out, kGeometryTag, geometryCount, geometry);
+    return static_cast<bool>(out);
+}
+
+bool SessionFile::read(const unsigned char* data, size_t size, Session& session, std::string& error) {
+    session = Session();
+    Reader in(data, size);
+    char magic[4];
+    uint32_t header[3];
+    if (!in.getBytes(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+        !in.getBytes(header, sizeof(header))) {
+        error = "不是 Arch Maths 会话文件";
+        return false;
+    }
+    if (header[0] > kVersion) {
+        error = "会话文件版本 " + std::to_string(header[0]) + " 比本程序新";
+        return false;
+    }
+
+    for (uint32_t s = 0; s < header[1]; ++s) {
+        uint32_t sectionTag = 0, count = 0;
+        uint64_t length = 0;
+        if (!in.get(sectionTag) || !in.get(count) || !in.get(length) || length > in.remaining()) {
+            error = "会话文件被截断";
+            return false;
+        }
+        Reader section(in.position(), static_cast<size_t>(length));
+        in.skip(std::min<size_t>(static_cast<size_t>(length + (8 - length % 8) % 8), in.remaining()));
+
+        bool ok = true;
+        if (sectionTag == kViewTag) {
+            ok = readView(section, session.view);
+        } else if (sectionTag == kVariablesTag) {
+            for (uint32_t i = 0; i < count && ok; ++i) {
+                std::pair<std::string, double> variable;
+                ok = section.getString(variable.first) && section.get(variable.second);
+                if (ok) session.variables.push_back(std::move(variable));
+            }
+        } else if (sectionTag == kEntriesTag) {
+            for (uint32_t i = 0; i < count && ok; ++i) {
+                SessionEntry entry;
+                ok = readEntry(section, entry);
+                if (ok) session.entries.push_back(std::move(entry));
+            }
+        } else if (sectionTag == kGeometryTag) {
+            // Geometry is only a cache: a bad record is skipped, a broken
+            // record length ends the section
+            for (uint32_t i = 0; i < count; ++i) {
+                uint64_t key = 0, checksum = 0, recordLength = 0;
+                if (!section.get(key) || !section.get(checksum) || !section.get(recordLength) ||
+                    recordLength > section.remaining()) {
+                    break;
+                }
+                const unsigned char* record = section.position();
+                section.skip(static_cast<size_t>(recordLength));
+                if (HashBuilder().add(record, static_cast<size_t>(recordLength)).value() != checksum) continue;
+                Reader recordReader(record, static_cast<size_t>(recordLength));
+                if (auto geometry = readGeometryRecord(recordReader)) {
+                    session.geometry.push_back(SessionGeometry{key, std::move(geometry)});
+                }
+            }
+        }
+        if (!ok) {
+            error = "会话文件已损坏";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace ArchMaths
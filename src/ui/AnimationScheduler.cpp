@@ -0,0 +1,99 @@
+#include "ui/AnimationScheduler.h"
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+
+namespace ArchMaths {
+
+// Phase advance per frame: a full sweep takes 2π / 0.05 frames (~4 s)
+static constexpr double kPhasePerFrame = 0.05;
+
+AnimationScheduler::AnimationScheduler(QObject* parent)
+    : QObject(parent)
+    , timer_(new QTimer(this))
+{
+    timer_->setTimerType(Qt::PreciseTimer);
+    timer_->setInterval(kFrameIntervalMs);
+    connect(timer_, &QTimer::timeout, this, &AnimationScheduler::onTick);
+}
+
+void AnimationScheduler::play(int entry, const QString& name, double value, double minValue, double maxValue) {
+    stop(entry, name);
+    if (!timer_->isActive()) {
+        clock_.start();
+        frame_ = 0;
+        timer_->start();
+    }
+
+    // Start where the slider is, moving up
+    double span = maxValue - minValue;
+    double s = span > 0.0 ? std::clamp(2.0 * (value - minValue) / span - 1.0, -1.0, 1.0) : 0.0;
+    tracks_.push_back(Track{entry, name, minValue, maxValue, std::asin(s), frame_});
+}
+
+void AnimationScheduler::stop(int entry, const QString& name) {
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(),
+                                 [&](const Track& t) { return t.entry == entry && t.name == name; }),
+                  tracks_.end());
+    stopTimerIfIdle();
+}
+
+void AnimationScheduler::stopEntry(int entry) {
+    tracks_.erase(std::remove_if(tracks_.begin(), tracks_.end(),
+                                 [&](const Track& t) { return t.entry == entry; }),
+                  tracks_.end());
+    stopTimerIfIdle();
+}
+
+void AnimationScheduler::removeEntry(int entry) {
+    stopEntry(entry);
+    for (auto& track : tracks_) {
+        if (track.entry > entry) --track.entry;
+    }
+}
+
+void AnimationScheduler::clear() {
+    tracks_.clear();
+    timer_->stop();
+}
+
+bool AnimationScheduler::isAnimating(int entry) const {
+    return std::any_of(tracks_.begin(), tracks_.end(), [&](const Track& t) { return t.entry == entry; });
+}
+
+std::vector<int> AnimationScheduler::animatedEntries() const {
+    std::vector<int> entries;
+    for (const auto& track : tracks_) entries.push_back(track.entry);
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    return entries;
+}
+
+std::vector<std::pair<QString, double>> AnimationScheduler::valuesAt(int entry, qint64 frame) const {
+    std::vector<std::pair<QString, double>> values;
+    for (const auto& track : tracks_) {
+        if (track.entry == entry) values.emplace_back(track.name, valueAt(track, frame));
+    }
+    return values;
+}
+
+double AnimationScheduler::valueAt(const Track& track, qint64 frame) {
+    double phase = track.phase + kPhasePerFrame * static_cast<double>(frame - track.startFrame);
+    double t = (std::sin(phase) + 1.0) / 2.0; // 0 to 1
+    return track.minValue + t * (track.maxValue - track.minValue);
+}
+
+void AnimationScheduler::onTick() {
+    // Frames follow the wall clock, so a slow frame skips ahead instead of
+    // slowing the animation down
+    qint64 now = clock_.elapsed() / kFrameIntervalMs;
+    if (now == frame_) return;
+    frame_ = now;
+    emit frame(frame_);
+}
+
+void AnimationScheduler::stopTimerIfIdle() {
+    if (tracks_.empty()) timer_->stop();
+}
+
+} // namespace ArchMaths
@@ -119,6 +119,8 @@ void EntryWidget::updateParameterSliders(const std::vector<ParameterInfo>& param
         );
         connect(slider, &ParameterSlider::valueChanged,
                 this, &EntryWidget::onParameterValueChanged);
+        connect(slider, &ParameterSlider::playToggled,
+                this, &EntryWidget::onParameterPlayToggled);
         parameterSliders_.push_back(slider);
         slidersLayout_->addWidget(slider);
     }
@@ -182,4 +184,17 @@ void EntryWidget::onParameterValueChanged(const QString& name, double value) {
     emit parameterChanged(index_, name, value);
 }
 
+void EntryWidget::onParameterPlayToggled(const QString& name, bool playing, double minVal, double maxVal) {
+    emit parameterPlayToggled(index_, name, playing, minVal, maxVal);
+}
+
+void EntryWidget::setParameterValue(const QString& name, double value) {
+    for (auto* slider : parameterSliders_) {
+        if (slider->name() == name) {
+            slider->setValue(value);
+            break;
+        }
+    }
+}
+
 } // namespace ArchMaths
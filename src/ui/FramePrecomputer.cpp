@@ -0,0 +1,109 @@
+#include "ui/FramePrecomputer.h"
+
+namespace ArchMaths {
+
+FramePrecomputer::FramePrecomputer() {
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+    worker_ = std::thread([this]() { run(); });
+#endif
+    // Without threads nothing is ever precomputed and every frame is
+    // computed when it is shown
+}
+
+FramePrecomputer::~FramePrecomputer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+        queue_.clear();
+    }
+    wake_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+void FramePrecomputer::request(int entry, int64_t frame, Job job) {
+    if (!worker_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(entry);
+        if (it == entries_.end()) {
+            it = entries_.emplace(entry, EntryFrames{}).first;
+            it->second.generation = nextGeneration_++;
+        }
+        EntryFrames& frames = it->second;
+        if (frames.pending.count(frame) || frames.done.count(frame)) return;
+        frames.pending.insert(frame);
+        queue_.push_back(Task{entry, frame, frames.generation, std::move(job)});
+    }
+    wake_.notify_one();
+}
+
+bool FramePrecomputer::isRequested(int entry, int64_t frame) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(entry);
+    return it != entries_.end() && (it->second.pending.count(frame) || it->second.done.count(frame));
+}
+
+bool FramePrecomputer::take(int entry, int64_t frame, PlotFrame& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(entry);
+    if (it == entries_.end()) return false;
+    auto done = it->second.done.find(frame);
+    if (done == it->second.done.end()) return false;
+    out = std::move(done->second);
+    it->second.done.erase(done);
+    return true;
+}
+
+void FramePrecomputer::discardBefore(int entry, int64_t frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(entry);
+    if (it == entries_.end()) return;
+    // Queued tasks of dropped frames are skipped by the worker
+    it->second.pending.erase(it->second.pending.begin(), it->second.pending.lower_bound(frame));
+    it->second.done.erase(it->second.done.begin(), it->second.done.lower_bound(frame));
+}
+
+void FramePrecomputer::discard(int entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(entry);
+}
+
+void FramePrecomputer::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    queue_.clear();
+}
+
+void FramePrecomputer::run() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return quit_ || !queue_.empty(); });
+            if (quit_) return;
+            task = std::move(queue_.front());
+            queue_.pop_front();
+            auto it = entries_.find(task.entry);
+            if (it == entries_.end() || it->second.generation != task.generation ||
+                !it->second.pending.count(task.frame)) {
+                continue;
+            }
+        }
+
+        PlotFrame frame;
+        try {
+            task.job(frame);
+        } catch (...) {
+            frame = PlotFrame{};
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(task.entry);
+        if (it != entries_.end() && it->second.generation == task.generation &&
+            it->second.pending.erase(task.frame)) {
+            it->second.done.emplace(task.frame, std::move(frame));
+        }
+    }
+}
+
+} // namespace ArchMaths
@@ -43,9 +43,6 @@ void ParameterSlider::setupUI() {
     connect(spinBox_, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
             this, &ParameterSlider::onSpinBoxChanged);
 
-    animTimer_ = new QTimer(this);
-    connect(animTimer_, &QTimer::timeout, this, &ParameterSlider::onAnimationTick);
-
     layout->addWidget(nameLabel_);
     layout->addWidget(playBtn_);
     layout->addWidget(slider_, 1);
@@ -90,19 +87,7 @@ void ParameterSlider::onSpinBoxChanged(double val) {
 void ParameterSlider::onPlayClicked() {
     playing_ = !playing_;
     playBtn_->setText(playing_ ? "⏸" : "▶");
-    if (playing_) {
-        animTimer_->start(33); // ~30 FPS
-    } else {
-        animTimer_->stop();
-    }
-}
-
-void ParameterSlider::onAnimationTick() {
-    animPhase_ += 0.05;
-    double t = (std::sin(animPhase_) + 1.0) / 2.0; // 0 to 1
-    double newVal = minVal_ + t * (maxVal_ - minVal_);
-    setValue(newVal);
-    emit valueChanged(name_, newVal);
+    emit playToggled(name_, playing_, minVal_, maxVal_);
 }
 
 void ParameterSlider::expandRangeIfNeeded(double val) {
@@ -3,6 +3,8 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QScrollArea>
+#include <QSignalBlocker>
+#include <cmath>
 
 namespace ArchMaths {
 
@@ -66,6 +68,8 @@ void SidePanel::addEntry(const PlotEntry& entry) {
             this, &SidePanel::entryVisibilityChanged);
     connect(widget, &EntryWidget::parameterChanged,
             this, &SidePanel::entryParameterChanged);
+    connect(widget, &EntryWidget::parameterPlayToggled,
+            this, &SidePanel::entryParameterPlayToggled);
     connect(widget, &EntryWidget::colorClicked,
             this, &SidePanel::entryColorChanged);
 
@@ -81,6 +85,18 @@ void SidePanel::updateEntry(int index, const PlotEntry& entry) {
     }
 }
 
+void SidePanel::setParameterValue(int index, const QString& name, double value) {
+    if (index >= 0 && index < static_cast<int>(entryWidgets_.size())) {
+        entryWidgets_[index]->setParameterValue(name, value);
+    }
+}
+
+void SidePanel::setPrecision(double multiplier) {
+    QSignalBlocker blocker(precisionSlider_);
+    precisionSlider_->setValue(static_cast<int>(std::round(multiplier * 10.0)));
+    precisionLabel_->setText(QString("精度: %1x").arg(multiplier, 0, 'f', 1));
+}
+
 void SidePanel::removeEntry(int index) {
     if (index >= 0 && index < static_cast<int>(entryWidgets_.size())) {
         EntryWidget* widget = entryWidgets_[index];